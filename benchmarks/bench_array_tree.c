@@ -0,0 +1,145 @@
+/* Compares the pointer based redBlackTree with the index based arrayTree on the same key set.
+*
+*  gcc -O2 benchmarks/bench_array_tree.c src/red_black_tree.c src/array_tree.c -I./src -o bench_array_tree
+*  ./bench_array_tree [keys]      (defaults to 10M keys)
+*
+*  Each variant runs in its own child process so the peak RSS column only covers that variant.
+*/
+
+#include "red_black_tree.h"
+#include "array_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef struct phaseTimes {
+    uint64_t insertNs;
+    uint64_t searchNs;
+    uint64_t extremaNs;
+    uint64_t deleteNs;
+    long checksum; // keeps the searches from being optimized away
+} phaseTimes;
+
+static void runPointerTree(const int *keys, const int *probes, long count, phaseTimes *times) {
+    redBlackTree *tree = initializeTree();
+
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        rbInsert(tree, keys[i]);
+    }
+    times->insertNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        times->checksum += rbTreeSearch(tree, probes[i])->key;
+    }
+    times->searchNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        times->checksum += rbMinimum(tree, tree->root)->key + rbMaximum(tree, tree->root)->key;
+    }
+    times->extremaNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i += 2) {
+        rbDelete(tree, rbTreeSearch(tree, keys[i]));
+    }
+    times->deleteNs = benchNow() - start;
+
+    destroyTree(tree);
+}
+
+static void runArrayTree(const int *keys, const int *probes, long count, phaseTimes *times) {
+    arrayTree *tree = atInitializeTree();
+
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        atInsert(tree, keys[i]);
+    }
+    times->insertNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        times->checksum += tree->nodes[atTreeSearch(tree, probes[i])].key;
+    }
+    times->searchNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        times->checksum += tree->nodes[atMinimum(tree, tree->root)].key + tree->nodes[atMaximum(tree, tree->root)].key;
+    }
+    times->extremaNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i += 2) {
+        atDelete(tree, atTreeSearch(tree, keys[i]));
+    }
+    times->deleteNs = benchNow() - start;
+
+    atDestroyTree(tree);
+}
+
+int main(int argc, char *argv[]) {
+    const long count = (argc > 1) ? strtol(argv[1], NULL, 10) : 10000000;
+    if (count <= 1) {
+        fprintf(stderr, "usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    int *keys = (int*)malloc((size_t)count * sizeof(int));
+    int *probes = (int*)malloc((size_t)count * sizeof(int));
+    if (keys == NULL || probes == NULL) {
+        fprintf(stderr, "could not allocate the key arrays\n");
+        free(keys);
+        free(probes);
+        return 1;
+    }
+
+    // random keys, and the same keys probed in a different random order
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < count; i++) {
+        keys[i] = (int)(benchRandom(&seed) >> 33);
+    }
+    for (long i = 0; i < count; i++) {
+        probes[i] = keys[benchRandom(&seed) % (uint64_t)count];
+    }
+
+    printf("variant,keys,node_bytes,insert_ns_per_op,search_ns_per_op,min_max_ns_per_op,delete_ns_per_op,peak_rss_kb\n");
+    fflush(stdout);
+
+    for (int variant = 0; variant < 2; variant++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+
+        if (pid == 0) {
+            phaseTimes times = {0};
+            if (variant == 0) {
+                runPointerTree(keys, probes, count, &times);
+            } else {
+                runArrayTree(keys, probes, count, &times);
+            }
+
+            printf("%s,%ld,%zu,%.1f,%.1f,%.1f,%.1f,%ld\n", (variant == 0) ? "pointer" : "array", count,
+                   (variant == 0) ? sizeof(treeNode) : sizeof(arrayNode),
+                   (double)times.insertNs / (double)count, (double)times.searchNs / (double)count,
+                   (double)times.extremaNs / (double)count, (double)times.deleteNs / (double)(count / 2),
+                   benchPeakRssKb());
+            fprintf(stderr, "checksum %ld\n", times.checksum);
+            fflush(stdout);
+            _exit(0);
+        }
+
+        waitpid(pid, NULL, 0);
+    }
+
+    free(keys);
+    free(probes);
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef BENCH_COMMON
+#define BENCH_COMMON
+
+/* NOTE: helpers shared by the benchmark programs. Everything is static so each benchmark stays a single
+*  translation unit that is compiled together with the tree sources it measures. */
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * @brief Reads a monotonic clock.
+ *
+ * @return The current time in nanoseconds.
+*/
+static inline uint64_t benchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Reads the peak resident set size of the calling process.
+ *
+ * @return The peak RSS in kilobytes.
+*/
+static inline long benchPeakRssKb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * @brief xorshift64* pseudo random generator, so runs are reproducible across libcs.
+ *
+ * @param *state The generator state, must be non-zero.
+ *
+ * @return The next pseudo random 64-bit value.
+*/
+static inline uint64_t benchRandom(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+#endif
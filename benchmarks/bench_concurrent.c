@@ -0,0 +1,203 @@
+/* Read scaling of concurrentTree against a redBlackTree behind one global mutex and behind a pthread rwlock.
+*
+*  gcc -O2 -pthread benchmarks/bench_concurrent.c src/red_black_tree.c src/concurrent_tree.c -I./src -o bench_concurrent
+*  ./bench_concurrent [max threads] [keys] [milliseconds]      (defaults to 32 threads, 1M keys and 1000 ms per run)
+*
+*  Every thread does 95% lookups and 5% writes (half inserts, half deletes) on random keys from twice the key range,
+*  so about half of the lookups hit. The thread count doubles from 1 up to the maximum, and each row gives the total
+*  throughput over all threads in millions of operations per second.
+*/
+
+#include "red_black_tree.h"
+#include "concurrent_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+enum { USE_GLOBAL_MUTEX, USE_RWLOCK, USE_CONCURRENT_TREE, VARIANT_COUNT };
+static const char *VARIANTS[VARIANT_COUNT] = {"global_mutex", "rwlock", "concurrent_tree"};
+
+typedef struct sharedTree {
+    int variant;
+    redBlackTree *tree; // USE_GLOBAL_MUTEX and USE_RWLOCK
+    pthread_mutex_t mutex;
+    pthread_rwlock_t rwlock;
+    concurrentTree *concurrent; // USE_CONCURRENT_TREE
+    int keyRange;
+    int stop;
+} sharedTree;
+
+typedef struct worker {
+    pthread_t thread;
+    sharedTree *shared;
+    uint64_t seed;
+    unsigned long operations;
+    unsigned long hits; // read back so the lookups are not optimized away
+} worker;
+
+static bool lockedContains(sharedTree *shared, int key) {
+    if (shared->variant == USE_GLOBAL_MUTEX) {
+        pthread_mutex_lock(&shared->mutex);
+    } else {
+        pthread_rwlock_rdlock(&shared->rwlock);
+    }
+
+    const bool found = rbTreeSearch(shared->tree, key) != shared->tree->nil;
+
+    if (shared->variant == USE_GLOBAL_MUTEX) {
+        pthread_mutex_unlock(&shared->mutex);
+    } else {
+        pthread_rwlock_unlock(&shared->rwlock);
+    }
+    return found;
+}
+
+static void lockedWrite(sharedTree *shared, int key, bool insert) {
+    if (shared->variant == USE_GLOBAL_MUTEX) {
+        pthread_mutex_lock(&shared->mutex);
+    } else {
+        pthread_rwlock_wrlock(&shared->rwlock);
+    }
+
+    if (insert) {
+        rbInsert(shared->tree, key);
+    } else {
+        treeNode *node = rbTreeSearch(shared->tree, key);
+        if (node != shared->tree->nil) {
+            rbDelete(shared->tree, node);
+        }
+    }
+
+    if (shared->variant == USE_GLOBAL_MUTEX) {
+        pthread_mutex_unlock(&shared->mutex);
+    } else {
+        pthread_rwlock_unlock(&shared->rwlock);
+    }
+}
+
+static void *runWorker(void *argument) {
+    worker *self = (worker*)argument;
+    sharedTree *shared = self->shared;
+    unsigned long operations = 0;
+    unsigned long hits = 0;
+
+    // check the stop flag every 64 operations, so reading it does not show up in the measurement
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) {
+        for (int i = 0; i < 64; i++) {
+            const uint64_t r = benchRandom(&self->seed);
+            const int key = (int)((r >> 32) % (uint64_t)shared->keyRange);
+            const unsigned mix = (unsigned)(r % 100);
+
+            if (mix < 95) {
+                const bool found = (shared->variant == USE_CONCURRENT_TREE) ? ctContains(shared->concurrent, key)
+                                                                        : lockedContains(shared, key);
+                hits += found;
+            } else if (shared->variant == USE_CONCURRENT_TREE) {
+                if (mix < 98) {
+                    ctInsert(shared->concurrent, key);
+                } else {
+                    ctDelete(shared->concurrent, key);
+                }
+            } else {
+                lockedWrite(shared, key, mix < 98);
+            }
+        }
+        operations += 64;
+    }
+
+    self->operations = operations;
+    self->hits = hits;
+    return NULL;
+}
+
+static void measure(int variant, int threads, long keyCount, long milliseconds) {
+    sharedTree shared;
+    shared.variant = variant;
+    shared.keyRange = (int)(keyCount * 2);
+    shared.stop = 0;
+    shared.tree = NULL;
+    shared.concurrent = NULL;
+    pthread_mutex_init(&shared.mutex, NULL);
+    pthread_rwlock_init(&shared.rwlock, NULL);
+
+    // the even keys below keyRange in ascending order, so half of the random lookups hit. Both kinds of tree are
+    // filled with rbInsert(), so their nodes have the same layout in memory
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    if (variant == USE_CONCURRENT_TREE) {
+        shared.concurrent = ctInitializeTree();
+        for (long i = 0; i < keyCount && shared.concurrent != NULL; i++) {
+            ctInsert(shared.concurrent, (int)(2 * i));
+        }
+    } else {
+        shared.tree = initializeTree();
+        for (long i = 0; i < keyCount && shared.tree != NULL; i++) {
+            rbInsert(shared.tree, (int)(2 * i));
+        }
+    }
+
+    worker *workers = (worker*)malloc((size_t)threads * sizeof(worker));
+    if (workers == NULL || (shared.tree == NULL && shared.concurrent == NULL)) {
+        fprintf(stderr, "could not set up the %s run\n", VARIANTS[variant]);
+        free(workers);
+        return;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].shared = &shared;
+        workers[i].seed = benchRandom(&seed) | 1;
+        workers[i].operations = 0;
+    }
+
+    const uint64_t start = benchNow();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]);
+    }
+    usleep((useconds_t)(milliseconds * 1000));
+    __atomic_store_n(&shared.stop, 1, __ATOMIC_RELAXED);
+
+    unsigned long operations = 0;
+    unsigned long hits = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        operations += workers[i].operations;
+        hits += workers[i].hits;
+    }
+    const uint64_t ns = benchNow() - start;
+
+    printf("%s,%d,%.2f,%.3f\n", VARIANTS[variant], threads, (double)operations * 1000.0 / (double)ns,
+           (double)hits / (double)operations);
+
+    free(workers);
+    if (shared.concurrent != NULL) {
+        ctDestroyTree(shared.concurrent);
+    } else {
+        destroyTree(shared.tree);
+    }
+    pthread_mutex_destroy(&shared.mutex);
+    pthread_rwlock_destroy(&shared.rwlock);
+}
+
+int main(int argc, char *argv[]) {
+    const int maxThreads = (argc > 1) ? atoi(argv[1]) : 32;
+    const long keyCount = (argc > 2) ? atol(argv[2]) : 1000000;
+    const long milliseconds = (argc > 3) ? atol(argv[3]) : 1000;
+
+    if (maxThreads < 1 || keyCount < 1 || keyCount > 1000000000L || milliseconds < 1) {
+        fprintf(stderr, "usage: %s [max threads] [keys] [milliseconds]\n", argv[0]);
+        return 1;
+    }
+
+    printf("# %ld keys, 95%% lookups, %ld online cpus\n", keyCount, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("variant,threads,mops_per_s,hit_rate\n");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        for (int variant = 0; variant < VARIANT_COUNT; variant++) {
+            measure(variant, threads, keyCount, milliseconds);
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
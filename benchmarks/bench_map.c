@@ -0,0 +1,80 @@
+/* Lookup latency of a generated rb_map.h map with int keys against rbTreeSearch() on the same keys.
+*
+*  gcc -O2 benchmarks/bench_map.c src/red_black_tree.c -I./src -o bench_map
+*  ./bench_map [keys] [lookups]      (defaults to 4M keys and 4M lookups)
+*
+*  Both trees get the same keys in the same order, so they have the same shape, and both are searched for the same
+*  probes (nine hits for every miss). A small cache-resident size is measured first.
+*/
+
+#include "red_black_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RB_MAP_NAME intMap
+#define RB_MAP_KEY int
+#define RB_MAP_VALUE int
+#include "rb_map.h"
+
+static void measure(long keyCount, long lookupCount) {
+    int *keys = (int*)malloc((size_t)keyCount * sizeof(int));
+    int *probes = (int*)malloc((size_t)lookupCount * sizeof(int));
+    redBlackTree *tree = initializeTree();
+    intMap *map = intMapInitialize();
+    if (keys == NULL || probes == NULL || tree == NULL || map == NULL) {
+        fprintf(stderr, "could not allocate the benchmark data\n");
+        exit(1);
+    }
+
+    // distinct random keys, since the map keeps only one node per key
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < keyCount; i++) {
+        keys[i] = (int)(benchRandom(&seed) >> 33);
+        if (intMapPut(map, keys[i], (int)i)) {
+            rbInsert(tree, keys[i]);
+        }
+    }
+    for (long i = 0; i < lookupCount; i++) {
+        probes[i] = (i % 10 == 0) ? (int)(benchRandom(&seed) >> 33) : keys[benchRandom(&seed) % (uint64_t)keyCount];
+    }
+
+    // the checksums keep the searches from being optimized away, and show both found the same keys
+    long treeHits = 0;
+    uint64_t start = benchNow();
+    for (long i = 0; i < lookupCount; i++) {
+        treeHits += (rbTreeSearch(tree, probes[i]) != tree->nil);
+    }
+    const uint64_t treeNs = benchNow() - start;
+
+    long mapHits = 0;
+    start = benchNow();
+    for (long i = 0; i < lookupCount; i++) {
+        mapHits += (intMapGet(map, probes[i]) != NULL);
+    }
+    const uint64_t mapNs = benchNow() - start;
+
+    printf("%ld keys: rbTreeSearch %.1f ns/lookup, intMapGet %.1f ns/lookup (%ld and %ld hits)\n", keyCount,
+           (double)treeNs / (double)lookupCount, (double)mapNs / (double)lookupCount, treeHits, mapHits);
+
+    intMapDestroy(map);
+    destroyTree(tree);
+    free(keys);
+    free(probes);
+}
+
+int main(int argc, char *argv[]) {
+    const long keyCount = (argc > 1) ? atol(argv[1]) : 4L << 20;
+    const long lookupCount = (argc > 2) ? atol(argv[2]) : 4L << 20;
+
+    if (keyCount < 1 || keyCount > (1L << 30) || lookupCount < 1) {
+        fprintf(stderr, "usage: %s [keys] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    measure(1024, lookupCount);
+    measure(keyCount, lookupCount);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+/* Compares the slab node pool against one malloc() per node.
+*
+*  gcc -O2 benchmarks/bench_node_pool.c src/red_black_tree.c -I./src -o bench_pool
+*  gcc -O2 -DRB_MALLOC_NODES benchmarks/bench_node_pool.c src/red_black_tree.c -I./src -o bench_malloc
+*  ./bench_pool [keys] && ./bench_malloc [keys]
+*/
+
+#include "red_black_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef RB_MALLOC_NODES
+#define ALLOCATOR "malloc"
+#else
+#define ALLOCATOR "pool"
+#endif
+
+int main(int argc, char *argv[]) {
+    const long count = (argc > 1) ? strtol(argv[1], NULL, 10) : 1000000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    int *keys = (int*)malloc((size_t)count * sizeof(int));
+    if (keys == NULL) {
+        fprintf(stderr, "could not allocate the key array\n");
+        return 1;
+    }
+
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < count; i++) {
+        keys[i] = (int)(benchRandom(&seed) >> 33);
+    }
+
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        free(keys);
+        return 1;
+    }
+
+    // bulk load
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        rbInsert(tree, keys[i]);
+    }
+    const uint64_t insertNs = benchNow() - start;
+    const long loadedRss = benchPeakRssKb();
+
+    // delete half of the keys and insert them again, which exercises node recycling
+    start = benchNow();
+    for (long i = 0; i < count; i += 2) {
+        rbDelete(tree, rbTreeSearch(tree, keys[i]));
+    }
+    for (long i = 0; i < count; i += 2) {
+        rbInsert(tree, keys[i]);
+    }
+    const uint64_t churnNs = benchNow() - start;
+
+    start = benchNow();
+    destroyTree(tree);
+    const uint64_t destroyNs = benchNow() - start;
+
+    printf("allocator,keys,insert_ns_per_op,inserts_per_sec,churn_ns_per_op,destroy_ms,peak_rss_kb\n");
+    printf("%s,%ld,%.1f,%.0f,%.1f,%.2f,%ld\n", ALLOCATOR, count,
+           (double)insertNs / (double)count, (double)count * 1e9 / (double)insertNs,
+           (double)churnNs / (double)count, (double)destroyNs / 1e6, loadedRss);
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,382 @@
+/* Replays a trace of tree operations against red_black_tree.c, reporting throughput, latency percentiles and memory.
+*
+*  gcc -O2 benchmarks/bench_replay.c src/red_black_tree.c -I./src -o bench_replay
+*  ./bench_replay [trace|-] [--histogram]       replay a trace file (stdin when it is missing or -)
+*  ./bench_replay --binary text binary          convert a text trace to the binary format
+*  ./bench_replay --generate operations         write a random text trace (50% search, 30% insert, 15% delete,
+*                                               5% range) to stdout, to try the tool out
+*
+*  A text trace has one operation per line, and blank lines and lines starting with # are skipped:
+*    i <key>        rbInsert()
+*    d <key>        rbDelete() of a node holding the key, if there is one
+*    s <key>        rbTreeSearch()
+*    r <lo> <hi>    rbRange(), counting the nodes visited
+*  A binary trace starts with the 8 bytes of TRACE_MAGIC, then holds the operation letter as one byte followed by
+*  its keys as 4-byte integers in the byte order of the machine. The format is detected from the first byte, and
+*  either is read as a stream, so traces larger than memory work.
+*
+*  Every operation is timed on its own with benchNow(), so the latencies include the cost of reading the clock
+*  (about 20 ns), while the throughput line counts the whole replay, parsing included. Latencies go into log-linear
+*  histograms with 16 buckets per power of two, so a reported percentile is at most 1/16 above the true one.
+*/
+
+#include "red_black_tree.h"
+#include "bench_common.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC "RBTRACE" // 8 bytes with the terminating zero
+#define LINE_LENGTH 256
+#define STREAM_BUFFER (1 << 20)
+
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define BUCKETS (64 * SUB_BUCKETS)
+
+enum { OP_INSERT, OP_DELETE, OP_SEARCH, OP_RANGE, OP_COUNT };
+
+static const char OP_LETTERS[OP_COUNT] = {'i', 'd', 's', 'r'};
+static const char *OP_NAMES[OP_COUNT] = {"insert", "delete", "search", "range"};
+
+typedef struct histogram {
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sumNs;
+    uint64_t maxNs;
+} histogram;
+
+typedef struct operation {
+    int op;
+    int key;
+    int hi; // only for OP_RANGE
+} operation;
+
+// values below SUB_BUCKETS get a bucket each, above that every power of two is split into SUB_BUCKETS buckets
+static size_t bucketOf(uint64_t ns) {
+    if (ns < SUB_BUCKETS) {
+        return (size_t)ns;
+    }
+    const int msb = 63 - __builtin_clzll(ns);
+    const int shift = msb - SUB_BUCKET_BITS;
+    return (size_t)(shift + 1) * SUB_BUCKETS + (size_t)((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+// the largest value that falls into a bucket
+static uint64_t bucketLimit(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const int shift = (int)(bucket / SUB_BUCKETS) - 1;
+    const uint64_t sub = bucket % SUB_BUCKETS;
+    return (((uint64_t)SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+static void record(histogram *h, uint64_t ns) {
+    h->counts[bucketOf(ns)]++;
+    h->total++;
+    h->sumNs += ns;
+    h->maxNs = (ns > h->maxNs) ? ns : h->maxNs;
+}
+
+static uint64_t percentile(const histogram *h, double fraction) {
+    const uint64_t rank = (uint64_t)(fraction * (double)h->total + 0.5);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank && seen > 0) {
+            const uint64_t limit = bucketLimit(b);
+            return (limit < h->maxNs) ? limit : h->maxNs;
+        }
+    }
+    return h->maxNs;
+}
+
+static void merge(histogram *into, const histogram *from) {
+    for (size_t b = 0; b < BUCKETS; b++) {
+        into->counts[b] += from->counts[b];
+    }
+    into->total += from->total;
+    into->sumNs += from->sumNs;
+    into->maxNs = (from->maxNs > into->maxNs) ? from->maxNs : into->maxNs;
+}
+
+static void printRow(const char *name, const histogram *h) {
+    if (h->total == 0) {
+        return;
+    }
+    printf("%-8s %12llu %10.1f %10llu %10llu %10llu %12llu\n", name, (unsigned long long)h->total,
+           (double)h->sumNs / (double)h->total, (unsigned long long)percentile(h, 0.5),
+           (unsigned long long)percentile(h, 0.99), (unsigned long long)percentile(h, 0.999),
+           (unsigned long long)h->maxNs);
+}
+
+static int opOfLetter(int letter) {
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (OP_LETTERS[op] == letter) {
+            return op;
+        }
+    }
+    return -1;
+}
+
+// reads the next text operation, returning 1 for an operation, 0 at the end and -1 for a malformed line
+static int readText(FILE *in, operation *out, long *line) {
+    char buffer[LINE_LENGTH];
+    while (fgets(buffer, sizeof(buffer), in) != NULL) {
+        (*line)++;
+        char *p = buffer;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') {
+            continue;
+        }
+
+        out->op = opOfLetter(*p);
+        char *end;
+        const long key = strtol(p + 1, &end, 10);
+        if (out->op < 0 || end == p + 1 || key < INT32_MIN || key > INT32_MAX) {
+            return -1;
+        }
+        out->key = (int)key;
+
+        if (out->op == OP_RANGE) {
+            p = end;
+            const long hi = strtol(p, &end, 10);
+            if (end == p || hi < INT32_MIN || hi > INT32_MAX) {
+                return -1;
+            }
+            out->hi = (int)hi;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// reads the next binary operation, with the same results as readText()
+static int readBinary(FILE *in, operation *out) {
+    const int letter = getc(in);
+    if (letter == EOF) {
+        return 0;
+    }
+    out->op = opOfLetter(letter);
+    int32_t keys[2];
+    const size_t needed = (out->op == OP_RANGE) ? 2 : 1;
+    if (out->op < 0 || fread(keys, sizeof(int32_t), needed, in) != needed) {
+        return -1;
+    }
+    out->key = keys[0];
+    out->hi = (needed == 2) ? keys[1] : 0;
+    return 1;
+}
+
+/* detects the format from the first byte, which is always pushed back, since a text trace never starts with the 'R'
+*  of TRACE_MAGIC. Returns -1 for a binary trace with a broken magic, and leaves a binary trace after its magic
+*/
+static int isBinaryTrace(FILE *in) {
+    const int first = getc(in);
+    if (first != TRACE_MAGIC[0]) {
+        ungetc(first, in);
+        return 0;
+    }
+
+    char magic[sizeof(TRACE_MAGIC)];
+    magic[0] = (char)first;
+    const size_t rest = sizeof(magic) - 1;
+    return (fread(magic + 1, 1, rest, in) == rest && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0) ? 1 : -1;
+}
+
+static bool countNode(treeNode *node, void *context) {
+    (void)node;
+    (*(size_t*)context)++;
+    return true;
+}
+
+static int replay(FILE *in, bool showHistogram) {
+    static char streamBuffer[STREAM_BUFFER];
+    setvbuf(in, streamBuffer, _IOFBF, sizeof(streamBuffer));
+    const int format = isBinaryTrace(in);
+    if (format < 0) {
+        fprintf(stderr, "the trace is neither text nor a binary trace\n");
+        return 1;
+    }
+    const bool binary = (format == 1);
+
+    static histogram histograms[OP_COUNT];
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        return 1;
+    }
+
+    operation op;
+    long line = 0;
+    uint64_t misses = 0, visited = 0;
+    int status;
+    const uint64_t start = benchNow();
+
+    while ((status = binary ? readBinary(in, &op) : readText(in, &op, &line)) == 1) {
+        const uint64_t before = benchNow();
+        switch (op.op) {
+            case OP_INSERT:
+                rbInsert(tree, op.key);
+                break;
+            case OP_DELETE: {
+                treeNode *node = rbTreeSearch(tree, op.key);
+                if (node != tree->nil) {
+                    rbDelete(tree, node);
+                } else {
+                    misses++;
+                }
+                break;
+            }
+            case OP_SEARCH:
+                misses += (rbTreeSearch(tree, op.key) == tree->nil);
+                break;
+            default: {
+                size_t count = 0;
+                rbRange(tree, op.key, op.hi, countNode, &count);
+                visited += count;
+                break;
+            }
+        }
+        record(&histograms[op.op], benchNow() - before);
+    }
+    const double seconds = (double)(benchNow() - start) / 1e9;
+
+    if (status < 0) {
+        if (binary) {
+            fprintf(stderr, "truncated or unknown operation in the binary trace\n");
+        } else {
+            fprintf(stderr, "malformed operation on line %ld\n", line);
+        }
+        destroyTree(tree);
+        return 1;
+    }
+
+    histogram all;
+    memset(&all, 0, sizeof(all));
+    for (int i = 0; i < OP_COUNT; i++) {
+        merge(&all, &histograms[i]);
+    }
+
+    printf("%-8s %12s %10s %10s %10s %10s %12s\n", "op", "count", "mean_ns", "p50_ns", "p99_ns", "p999_ns",
+           "max_ns");
+    for (int i = 0; i < OP_COUNT; i++) {
+        printRow(OP_NAMES[i], &histograms[i]);
+    }
+    printRow("all", &all);
+
+    printf("\n%llu operations in %.3f s (%.0f ops/s), %llu searches and deletes missed, %llu nodes visited by ranges\n",
+           (unsigned long long)all.total, seconds, (seconds > 0) ? (double)all.total / seconds : 0.0,
+           (unsigned long long)misses, (unsigned long long)visited);
+    printf("final tree: %d nodes, black height %d, peak RSS %ld KB\n", size(tree, tree->root),
+           rbBlackHeight(tree), benchPeakRssKb());
+
+    if (showHistogram) {
+        printf("\nbucket_limit_ns,count\n");
+        for (size_t b = 0; b < BUCKETS; b++) {
+            if (all.counts[b] > 0) {
+                printf("%llu,%llu\n", (unsigned long long)bucketLimit(b), (unsigned long long)all.counts[b]);
+            }
+        }
+    }
+
+    destroyTree(tree);
+    return 0;
+}
+
+static int convert(const char *textPath, const char *binaryPath) {
+    FILE *in = fopen(textPath, "r"); // flawfinder: ignore (the user chooses the trace)
+    FILE *out = fopen(binaryPath, "wb"); // flawfinder: ignore (the user chooses the output)
+    if (in == NULL || out == NULL) {
+        fprintf(stderr, "could not open the traces\n");
+        return 1;
+    }
+
+    bool written = (fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), out) == sizeof(TRACE_MAGIC));
+    operation op;
+    long line = 0, count = 0;
+    int status;
+    while (written && (status = readText(in, &op, &line)) == 1) {
+        const int32_t keys[2] = {op.key, op.hi};
+        const size_t needed = (op.op == OP_RANGE) ? 2 : 1;
+        written = (putc(OP_LETTERS[op.op], out) != EOF) && (fwrite(keys, sizeof(int32_t), needed, out) == needed);
+        count++;
+    }
+    fclose(in);
+    if (fclose(out) != 0 || !written) {
+        fprintf(stderr, "could not write the binary trace\n");
+        return 1;
+    }
+    if (status < 0) {
+        fprintf(stderr, "malformed operation on line %ld\n", line);
+        return 1;
+    }
+
+    fprintf(stderr, "converted %ld operations\n", count);
+    return 0;
+}
+
+static int generate(long count) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    const uint64_t range = (uint64_t)count + 1;
+    for (long i = 0; i < count; i++) {
+        const uint64_t random = benchRandom(&seed);
+        const int key = (int)((random >> 8) % range);
+        const unsigned pick = (unsigned)(random % 100);
+        if (pick < 50) {
+            printf("s %d\n", key);
+        } else if (pick < 80) {
+            printf("i %d\n", key);
+        } else if (pick < 95) {
+            printf("d %d\n", key);
+        } else {
+            printf("r %d %d\n", key, key + 100);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--binary") == 0) {
+        return convert(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "--generate") == 0 && atol(argv[2]) > 0) {
+        return generate(atol(argv[2]));
+    }
+
+    const char *path = NULL;
+    bool showHistogram = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--histogram") == 0) {
+            showHistogram = true;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else if (path == NULL && strcmp(argv[i], "-") == 0) {
+            path = "-";
+        } else {
+            fprintf(stderr, "usage: %s [trace|-] [--histogram]\n"
+                            "       %s --binary text binary\n"
+                            "       %s --generate operations\n", argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *in = stdin;
+    if (path != NULL && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb"); // flawfinder: ignore (the user chooses the trace)
+        if (in == NULL) {
+            fprintf(stderr, "could not open %s\n", path);
+            return 1;
+        }
+    }
+
+    const int result = replay(in, showHistogram);
+    if (in != stdin) {
+        fclose(in);
+    }
+    return result;
+}
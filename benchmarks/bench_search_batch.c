@@ -0,0 +1,91 @@
+/* Per-key lookup latency of rbTreeSearchBatch() against a loop over rbTreeSearch().
+*
+*  gcc -O2 benchmarks/bench_search_batch.c src/red_black_tree.c -I./src -o bench_search_batch
+*  ./bench_search_batch [keys] [lookups]      (defaults to 16M keys, ~640 MB of nodes, and 4M lookups)
+*
+*  Pick a key count whose nodes (sizeof(treeNode) bytes each) are well beyond the last level cache. A small
+*  cache-resident tree is measured first for contrast.
+*/
+
+#include "red_black_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void measure(long keyCount, long lookupCount) {
+    int *keys = (int*)malloc((size_t)keyCount * sizeof(int));
+    int *probes = (int*)malloc((size_t)lookupCount * sizeof(int));
+    treeNode **found = (treeNode**)malloc((size_t)lookupCount * sizeof(treeNode*));
+    if (keys == NULL || probes == NULL || found == NULL) {
+        fprintf(stderr, "could not allocate the key arrays\n");
+        free(keys);
+        free(probes);
+        free(found);
+        return;
+    }
+
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < keyCount; i++) {
+        keys[i] = (int)(benchRandom(&seed) >> 33);
+    }
+    // nine hits for every miss
+    for (long i = 0; i < lookupCount; i++) {
+        probes[i] = (i % 10 == 0) ? (int)(benchRandom(&seed) >> 33) : keys[benchRandom(&seed) % (uint64_t)keyCount];
+    }
+
+    redBlackTree *tree = rbBuildFromSorted(keys, (size_t)keyCount);
+    if (tree == NULL) {
+        free(keys);
+        free(probes);
+        free(found);
+        return;
+    }
+
+    long checksum = 0;
+
+    uint64_t start = benchNow();
+    for (long i = 0; i < lookupCount; i++) {
+        found[i] = rbTreeSearch(tree, probes[i]);
+    }
+    const uint64_t scalarNs = benchNow() - start;
+    for (long i = 0; i < lookupCount; i++) {
+        checksum += found[i]->key;
+    }
+
+    start = benchNow();
+    rbTreeSearchBatch(tree, probes, (size_t)lookupCount, found);
+    const uint64_t batchNs = benchNow() - start;
+    for (long i = 0; i < lookupCount; i++) {
+        checksum -= found[i]->key;
+    }
+
+    printf("%ld,%.1f,%ld,%d,%.1f,%.1f,%.2f\n", keyCount, (double)keyCount * sizeof(treeNode) / (1024.0 * 1024.0),
+           lookupCount, RB_SEARCH_GROUP, (double)scalarNs / (double)lookupCount,
+           (double)batchNs / (double)lookupCount, (double)scalarNs / (double)batchNs);
+
+    // both loops must have found the same nodes
+    if (checksum != 0) {
+        fprintf(stderr, "batched results differ from rbTreeSearch()\n");
+    }
+
+    destroyTree(tree);
+    free(keys);
+    free(probes);
+    free(found);
+}
+
+int main(int argc, char *argv[]) {
+    const long keyCount = (argc > 1) ? strtol(argv[1], NULL, 10) : 16L * 1024 * 1024;
+    const long lookupCount = (argc > 2) ? strtol(argv[2], NULL, 10) : 4L * 1024 * 1024;
+    if (keyCount <= 0 || lookupCount <= 0) {
+        fprintf(stderr, "usage: %s [keys] [lookups]\n", argv[0]);
+        return 1;
+    }
+
+    printf("keys,tree_mb,lookups,group,scalar_ns_per_key,batch_ns_per_key,speedup\n");
+    measure(65536, lookupCount);
+    measure(keyCount, lookupCount);
+
+    return 0;
+}
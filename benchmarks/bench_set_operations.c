@@ -0,0 +1,105 @@
+/* Merging two trees with rbUnion(), and inserting an unsorted batch with rbInsertBatch(), against rbInsert().
+*
+*  gcc -O2 -pthread benchmarks/bench_set_operations.c src/red_black_tree.c src/bulk_operations.c -I./src -o bench_set
+*  ./bench_set [keys] [max threads]      (defaults to 1M keys per tree and 8 threads)
+*
+*  Both trees hold random keys. The first row inserts the second tree's keys one by one in order, the next rows
+*  run rbUnion() with the thread count doubling from 1 up to the maximum. The trees are built separately, so each
+*  union first moves the second tree's nodes into the first tree's pool (see rbSharePool()), and that is timed too.
+*  The last rows do the same for an array of random keys, inserted one by one and then with rbInsertBatch().
+*/
+
+#include "red_black_tree.h"
+#include "bulk_operations.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static redBlackTree *randomTree(long keyCount, uint64_t *seed) {
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        fprintf(stderr, "could not allocate the benchmark data\n");
+        exit(1);
+    }
+
+    for (long i = 0; i < keyCount; i++) {
+        rbInsert(tree, (int)(benchRandom(seed) >> 33));
+    }
+    return tree;
+}
+
+// merges two fresh random trees with the given number of threads, or with rbInsert() for 0 threads
+static void measure(long keyCount, int threads) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    redBlackTree *tree = randomTree(keyCount, &seed);
+    redBlackTree *other = randomTree(keyCount, &seed);
+
+    const uint64_t start = benchNow();
+    if (threads == 0) {
+        for (treeNode *node = rbMinimum(other, other->root); node != other->nil; node = rbNext(other, node)) {
+            rbInsert(tree, node->key);
+        }
+        destroyTree(other);
+    } else if (!rbUnion(tree, other, threads)) {
+        exit(1);
+    }
+    const uint64_t ns = benchNow() - start;
+
+    printf("%-13s %2d threads: %8.1f ms, %d keys\n", (threads == 0) ? "rbInsert" : "rbUnion", (threads == 0) ? 1 : threads,
+           (double)ns / 1e6, size(tree, tree->root));
+
+    destroyTree(tree);
+}
+
+// inserts an array of random keys into a random tree with the given number of threads, or with rbInsert() for 0
+static void measureBatch(long keyCount, int threads) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    redBlackTree *tree = randomTree(keyCount, &seed);
+    int *keys = (int*)malloc((size_t)keyCount * sizeof(int));
+    if (keys == NULL) {
+        fprintf(stderr, "could not allocate the benchmark data\n");
+        exit(1);
+    }
+    for (long i = 0; i < keyCount; i++) {
+        keys[i] = (int)(benchRandom(&seed) >> 33);
+    }
+
+    const uint64_t start = benchNow();
+    if (threads == 0) {
+        for (long i = 0; i < keyCount; i++) {
+            rbInsert(tree, keys[i]);
+        }
+    } else if (!rbInsertBatch(tree, keys, (size_t)keyCount, threads)) {
+        exit(1);
+    }
+    const uint64_t ns = benchNow() - start;
+
+    printf("%-13s %2d threads: %8.1f ms, %d keys\n", (threads == 0) ? "rbInsert" : "rbInsertBatch",
+           (threads == 0) ? 1 : threads, (double)ns / 1e6, size(tree, tree->root));
+
+    free(keys);
+    destroyTree(tree);
+}
+
+int main(int argc, char *argv[]) {
+    const long keyCount = (argc > 1) ? atol(argv[1]) : 1L << 20;
+    const int maxThreads = (argc > 2) ? atoi(argv[2]) : 8;
+
+    if (keyCount < 1 || keyCount > (1L << 29) || maxThreads < 1) {
+        fprintf(stderr, "usage: %s [keys] [max threads]\n", argv[0]);
+        return 1;
+    }
+
+    measure(keyCount, 0);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        measure(keyCount, threads);
+    }
+
+    measureBatch(keyCount, 0);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        measureBatch(keyCount, threads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* Saving a tree to a snapshot, opening the snapshot with mmap(), searching it in place and loading it back.
+*
+*  gcc -O2 benchmarks/bench_snapshot.c src/red_black_tree.c src/tree_serialization.c -I./src -o bench_snapshot
+*  ./bench_snapshot [keys] [file]      (defaults to 16M keys and bench_snapshot.rbt, which is removed afterwards)
+*
+*  The tree is built from every other integer with rbBuildFromSorted(), and 1M probes (half of them hits) are
+*  searched with rbTreeSearch() in the tree and with rbSnapshotContains() in the mapped file. The file is still in
+*  the page cache when it is opened, so the lookup numbers are for warm pages.
+*/
+
+#include "red_black_tree.h"
+#include "tree_serialization.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PROBES (1L << 20)
+
+int main(int argc, char *argv[]) {
+    const long keyCount = (argc > 1) ? atol(argv[1]) : 16L << 20;
+    const char *path = (argc > 2) ? argv[2] : "bench_snapshot.rbt";
+
+    if (keyCount < 1 || keyCount > (long)RB_SNAPSHOT_MAX_NODES) {
+        fprintf(stderr, "usage: %s [keys] [file]\n", argv[0]);
+        return 1;
+    }
+
+    int *keys = (int*)malloc((size_t)keyCount * sizeof(int));
+    int *probes = (int*)malloc(PROBES * sizeof(int));
+    if (keys == NULL || probes == NULL) {
+        fprintf(stderr, "could not allocate the benchmark data\n");
+        return 1;
+    }
+    for (long i = 0; i < keyCount; i++) {
+        keys[i] = (int)(2 * i);
+    }
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < PROBES; i++) {
+        probes[i] = (int)(benchRandom(&seed) % (uint64_t)(2 * keyCount));
+    }
+
+    redBlackTree *tree = rbBuildFromSorted(keys, (size_t)keyCount);
+    if (tree == NULL) {
+        return 1;
+    }
+
+    uint64_t start = benchNow();
+    if (!rbSaveTree(tree, path)) {
+        return 1;
+    }
+    const double saveMs = (double)(benchNow() - start) / 1e6;
+
+    start = benchNow();
+    rbSnapshot *snapshot = rbOpenSnapshot(path);
+    if (snapshot == NULL) {
+        return 1;
+    }
+    const double openUs = (double)(benchNow() - start) / 1e3;
+
+    // the hit counts keep the searches from being optimized away, and show both found the same keys
+    long treeHits = 0;
+    start = benchNow();
+    for (long i = 0; i < PROBES; i++) {
+        treeHits += (rbTreeSearch(tree, probes[i]) != tree->nil);
+    }
+    const double treeNs = (double)(benchNow() - start) / PROBES;
+
+    long snapshotHits = 0;
+    start = benchNow();
+    for (long i = 0; i < PROBES; i++) {
+        snapshotHits += rbSnapshotContains(snapshot, probes[i]);
+    }
+    const double snapshotNs = (double)(benchNow() - start) / PROBES;
+    rbCloseSnapshot(snapshot);
+
+    start = benchNow();
+    redBlackTree *loaded = rbLoadTree(path);
+    if (loaded == NULL) {
+        return 1;
+    }
+    const double loadMs = (double)(benchNow() - start) / 1e6;
+
+    printf("%ld keys, %.1f MB file\n", keyCount,
+           (double)(sizeof(rbSnapshotHeader) + (size_t)keyCount * sizeof(rbPackedNode)) / 1e6);
+    printf("rbSaveTree %.1f ms, rbOpenSnapshot %.1f us, rbLoadTree %.1f ms\n", saveMs, openUs, loadMs);
+    printf("rbTreeSearch %.1f ns/lookup, rbSnapshotContains %.1f ns/lookup (%ld and %ld hits)\n", treeNs, snapshotNs,
+           treeHits, snapshotHits);
+
+    remove(path);
+    destroyTree(loaded);
+    destroyTree(tree);
+    free(keys);
+    free(probes);
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+/* Microbenchmark suite for the operations of red_black_tree.c.
+*
+*  gcc -O2 -DRB_ENABLE_STATS benchmarks/bench_suite.c src/red_black_tree.c -I./src -lm -o bench_suite
+*  ./bench_suite [max_keys] [csv|json] > results.csv
+*
+*  Tree sizes sweep the powers of ten from 1K up to max_keys (10M by default, 100M needs about 5 GB of memory)
+*  for four key distributions:
+*    sequential  0, 1, 2, ...
+*    random      uniform 31-bit keys
+*    zipfian     ranks drawn with skew 0.99 (YCSB style), scattered over the key space, so with many duplicates
+*    adversarial outside-in order (0, n-1, 1, n-2, ...), which keeps both spines of the tree rotating
+*
+*  Every size and distribution runs in a child process, so peak_rss_kb covers that configuration only. The
+*  output has one row per operation, as CSV or as JSON Lines. Without RB_ENABLE_STATS the rotation column is -1.
+*/
+
+#include "red_black_tree.h"
+#include "bench_common.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LOOKUP_LIMIT 1000000 // searches and extrema calls per configuration are capped to keep big sizes quick
+#define RANGE_LENGTH 100 // nodes per rbRange() scan, whatever the key distribution
+
+static const char *DISTRIBUTIONS[] = {"sequential", "random", "zipfian", "adversarial"};
+
+static bool jsonOutput = false;
+
+static void fillZipfian(int *keys, long count, uint64_t *seed) {
+    // Gray et al., "Quickly Generating Billion-Record Synthetic Databases"
+    const double theta = 0.99;
+    double zetaN = 0.0;
+    for (long i = 1; i <= count; i++) {
+        zetaN += 1.0 / pow((double)i, theta);
+    }
+    const double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+    const double alpha = 1.0 / (1.0 - theta);
+    const double eta = (1.0 - pow(2.0 / (double)count, 1.0 - theta)) / (1.0 - zeta2 / zetaN);
+
+    for (long i = 0; i < count; i++) {
+        const double u = (double)(benchRandom(seed) >> 11) / 9007199254740992.0;
+        const double uz = u * zetaN;
+        uint64_t rank;
+
+        if (uz < 1.0) {
+            rank = 0;
+        } else if (uz < zeta2) {
+            rank = 1;
+        } else {
+            rank = (uint64_t)((double)count * pow(eta * u - eta + 1.0, alpha));
+        }
+
+        // scatter the ranks so popular keys do not sit next to each other
+        keys[i] = (int)((rank * 2654435761ULL) & 0x7FFFFFFFULL);
+    }
+}
+
+static void fillKeys(int *keys, long count, int distribution) {
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    switch (distribution) {
+        case 0:
+            for (long i = 0; i < count; i++) {
+                keys[i] = (int)i;
+            }
+            break;
+        case 1:
+            for (long i = 0; i < count; i++) {
+                keys[i] = (int)(benchRandom(&seed) >> 33);
+            }
+            break;
+        case 2:
+            fillZipfian(keys, count, &seed);
+            break;
+        default:
+            for (long i = 0; i < count; i++) {
+                keys[i] = (i % 2 == 0) ? (int)(i / 2) : (int)(count - 1 - i / 2);
+            }
+            break;
+    }
+}
+
+// rbRange() callback that ends the scan once *context (a long) reaches zero
+static bool countDown(treeNode *node, void *context) {
+    (void)node;
+    return --*(long*)context > 0;
+}
+
+static unsigned long long rotationCount(const redBlackTree *tree) {
+    rbStats stats;
+    rbGetStats(tree, &stats);
+    return stats.leftRotations + stats.rightRotations;
+}
+
+static void printRow(long count, int distribution, const char *operation, long ops, uint64_t ns,
+                     unsigned long long rotations) {
+    const double nsPerOp = (double)ns / (double)ops;
+#ifdef RB_ENABLE_STATS
+    const double rotationsPerOp = (double)rotations / (double)ops;
+#else
+    (void)rotations;
+    const double rotationsPerOp = -1.0;
+#endif
+
+    if (jsonOutput) {
+        printf("{\"keys\":%ld,\"distribution\":\"%s\",\"operation\":\"%s\",\"ops\":%ld,\"ns_per_op\":%.2f,"
+               "\"rotations_per_op\":%.4f,\"peak_rss_kb\":%ld}\n", count, DISTRIBUTIONS[distribution], operation, ops,
+               nsPerOp, rotationsPerOp, benchPeakRssKb());
+    } else {
+        printf("%ld,%s,%s,%ld,%.2f,%.4f,%ld\n", count, DISTRIBUTIONS[distribution], operation, ops, nsPerOp,
+               rotationsPerOp, benchPeakRssKb());
+    }
+}
+
+static void runConfiguration(long count, int distribution) {
+    int *keys = (int*)malloc((size_t)count * sizeof(int));
+    int *probes = (int*)malloc((size_t)count * sizeof(int));
+    if (keys == NULL || probes == NULL) {
+        fprintf(stderr, "could not allocate the key arrays for %ld keys\n", count);
+        free(keys);
+        free(probes);
+        return;
+    }
+    fillKeys(keys, count, distribution);
+
+    // searches and deletions visit the keys in a random order (a shuffled copy, so no key is deleted twice)
+    memcpy(probes, keys, (size_t)count * sizeof(int));
+    uint64_t seed = 0xD1B54A32D192ED03ULL;
+    for (long i = count - 1; i > 0; i--) {
+        const long j = (long)(benchRandom(&seed) % (uint64_t)(i + 1));
+        const int swap = probes[i];
+        probes[i] = probes[j];
+        probes[j] = swap;
+    }
+
+    const long lookups = (count < LOOKUP_LIMIT) ? count : LOOKUP_LIMIT;
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        free(keys);
+        free(probes);
+        return;
+    }
+    volatile long sink = 0;
+
+    unsigned long long rotations = rotationCount(tree);
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        rbInsert(tree, keys[i]);
+    }
+    printRow(count, distribution, "rbInsert", count, benchNow() - start, rotationCount(tree) - rotations);
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++) {
+        sink += rbTreeSearch(tree, probes[i])->key;
+    }
+    printRow(count, distribution, "rbTreeSearch", lookups, benchNow() - start, 0);
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++) {
+        sink += rbMinimum(tree, tree->root)->key;
+    }
+    printRow(count, distribution, "rbMinimum", lookups, benchNow() - start, 0);
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++) {
+        sink += rbMaximum(tree, tree->root)->key;
+    }
+    printRow(count, distribution, "rbMaximum", lookups, benchNow() - start, 0);
+
+    // an in-order walk of the whole tree, ns per node
+    start = benchNow();
+    for (treeNode *x = rbMinimum(tree, tree->root); x != tree->nil; x = rbNext(tree, x)) {
+        sink += x->key;
+    }
+    printRow(count, distribution, "rbNext", count, benchNow() - start, 0);
+
+    // scans of up to RANGE_LENGTH nodes from random starting keys, ns per node reported
+    const long scans = (lookups + RANGE_LENGTH - 1) / RANGE_LENGTH;
+    long scanned = 0;
+    start = benchNow();
+    for (long i = 0; i < scans; i++) {
+        long remaining = RANGE_LENGTH;
+        scanned += (long)rbRange(tree, probes[i], INT_MAX, countDown, &remaining);
+    }
+    if (scanned > 0) {
+        printRow(count, distribution, "rbRange", scanned, benchNow() - start, 0);
+    }
+
+    start = benchNow();
+    sink += height(tree, tree->root);
+    printRow(count, distribution, "height", 1, benchNow() - start, 0);
+
+    start = benchNow();
+    for (long i = 0; i < lookups; i++) {
+        sink += size(tree, tree->root);
+    }
+    printRow(count, distribution, "size", lookups, benchNow() - start, 0);
+
+    // delete half of the nodes, each found by key the way callers do it
+    const long deletions = count / 2;
+    rotations = rotationCount(tree);
+    start = benchNow();
+    for (long i = 0; i < deletions; i++) {
+        rbDelete(tree, rbTreeSearch(tree, probes[i]));
+    }
+    if (deletions > 0) {
+        printRow(count, distribution, "rbDelete", deletions, benchNow() - start, rotationCount(tree) - rotations);
+    }
+
+    start = benchNow();
+    destroyTree(tree);
+    printRow(count, distribution, "destroyTree", 1, benchNow() - start, 0);
+
+    free(keys);
+    free(probes);
+}
+
+int main(int argc, char *argv[]) {
+    const long maxKeys = (argc > 1) ? strtol(argv[1], NULL, 10) : 10000000;
+    if (maxKeys < 1000 || (argc > 2 && strcmp(argv[2], "csv") != 0 && strcmp(argv[2], "json") != 0)) {
+        fprintf(stderr, "usage: %s [max_keys >= 1000] [csv|json]\n", argv[0]);
+        return 1;
+    }
+    jsonOutput = (argc > 2 && strcmp(argv[2], "json") == 0);
+
+    if (!jsonOutput) {
+        printf("keys,distribution,operation,ops,ns_per_op,rotations_per_op,peak_rss_kb\n");
+    }
+    fflush(stdout);
+
+    for (long count = 1000; count <= maxKeys; count *= 10) {
+        for (int distribution = 0; distribution < 4; distribution++) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+
+            if (pid == 0) {
+                runConfiguration(count, distribution);
+                fflush(stdout);
+                _exit(0);
+            }
+
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "configuration %ld/%s did not finish\n", count, DISTRIBUTIONS[distribution]);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/* Compares the bottom-up redBlackTree (parent pointers, CLRS fixups) with the single pass topDownTree.
+*
+*  gcc -O2 benchmarks/bench_top_down.c src/red_black_tree.c src/top_down_tree.c -I./src -o bench_top_down
+*  ./bench_top_down [keys]      (defaults to 1M keys)
+*
+*  Each variant runs in its own child process so the peak RSS column only covers that variant.
+*/
+
+#include "red_black_tree.h"
+#include "top_down_tree.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef struct phaseTimes {
+    uint64_t insertNs;
+    uint64_t searchNs;
+    uint64_t deleteNs;
+    long checksum; // keeps the searches from being optimized away
+} phaseTimes;
+
+static void runBottomUp(const int *keys, long count, phaseTimes *times) {
+    redBlackTree *tree = initializeTree();
+
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        rbInsert(tree, keys[i]);
+    }
+    times->insertNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = count - 1; i >= 0; i--) {
+        times->checksum += rbTreeSearch(tree, keys[i])->key;
+    }
+    times->searchNs = benchNow() - start;
+
+    // deleting by key, which is what topDownTree offers
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        rbDelete(tree, rbTreeSearch(tree, keys[i]));
+    }
+    times->deleteNs = benchNow() - start;
+
+    destroyTree(tree);
+}
+
+static void runTopDown(const int *keys, long count, phaseTimes *times) {
+    topDownTree *tree = tdInitializeTree();
+
+    uint64_t start = benchNow();
+    for (long i = 0; i < count; i++) {
+        tdInsert(tree, keys[i]);
+    }
+    times->insertNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = count - 1; i >= 0; i--) {
+        times->checksum += tdTreeSearch(tree, keys[i])->key;
+    }
+    times->searchNs = benchNow() - start;
+
+    start = benchNow();
+    for (long i = 0; i < count; i++) {
+        tdDelete(tree, keys[i]);
+    }
+    times->deleteNs = benchNow() - start;
+
+    tdDestroyTree(tree);
+}
+
+int main(int argc, char *argv[]) {
+    const long count = (argc > 1) ? strtol(argv[1], NULL, 10) : 1000000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    int *keys = (int*)malloc((size_t)count * sizeof(int));
+    if (keys == NULL) {
+        fprintf(stderr, "could not allocate the key array\n");
+        return 1;
+    }
+
+    // random keys, then sequential keys (the case that rotates the most on insertion)
+    printf("variant,distribution,keys,node_bytes,insert_ns_per_op,search_ns_per_op,delete_ns_per_op,peak_rss_kb\n");
+    fflush(stdout);
+
+    for (int distribution = 0; distribution < 2; distribution++) {
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        for (long i = 0; i < count; i++) {
+            keys[i] = (distribution == 0) ? (int)(benchRandom(&seed) >> 33) : (int)i;
+        }
+
+        for (int variant = 0; variant < 2; variant++) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                break;
+            }
+
+            if (pid == 0) {
+                phaseTimes times = {0};
+                if (variant == 0) {
+                    runBottomUp(keys, count, &times);
+                } else {
+                    runTopDown(keys, count, &times);
+                }
+
+                printf("%s,%s,%ld,%zu,%.1f,%.1f,%.1f,%ld\n", (variant == 0) ? "bottom_up" : "top_down",
+                       (distribution == 0) ? "random" : "sequential", count,
+                       (variant == 0) ? sizeof(treeNode) : sizeof(tdNode),
+                       (double)times.insertNs / (double)count, (double)times.searchNs / (double)count,
+                       (double)times.deleteNs / (double)count, benchPeakRssKb());
+                fprintf(stderr, "checksum %ld\n", times.checksum);
+                fflush(stdout);
+                _exit(0);
+            }
+
+            waitpid(pid, NULL, 0);
+        }
+    }
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* Steady-state write throughput of the write-ahead log for several group commit sizes, and recovery time.
+*
+*  gcc -O2 benchmarks/bench_wal.c src/red_black_tree.c src/tree_serialization.c src/write_ahead_log.c -I./src -o bench_wal
+*  ./bench_wal [operations] [file]      (defaults to 1M operations and bench_wal.log, which is removed afterwards)
+*
+*  Each run applies the same random mix of 80% inserts and 20% deletes of keys drawn from a range of 1M, first to a
+*  plain tree and then through the log with groupCommit records per fsync. Every group size shares the fsync of a
+*  group among its records, so the numbers depend on how fast the disk syncs; a group size of 1 is only run for the
+*  first 10K operations. Recovery replays the log of the last run into an empty tree, then again after a checkpoint
+*  with the snapshot loaded and only the records after it replayed.
+*/
+
+#include "red_black_tree.h"
+#include "tree_serialization.h"
+#include "write_ahead_log.h"
+#include "bench_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_RANGE (1 << 20)
+#define SYNC_EACH_LIMIT 10000L // operations measured with an fsync per record
+#define RECOVERY_GROUP 4096 // group size of the logs opened by recovery
+
+static const size_t groupSizes[] = {1, 16, 256, 4096, 65536};
+
+// applies the operations to tree, through log unless it is NULL
+static void apply(redBlackTree *tree, writeAheadLog *log, const int *keys, long count) {
+    for (long i = 0; i < count; i++) {
+        const int key = keys[i];
+        if (key < 0) {
+            if (log != NULL) {
+                walDelete(log, tree, -key - 1);
+            } else {
+                treeNode *node = rbTreeSearch(tree, -key - 1);
+                if (node != tree->nil) {
+                    rbDelete(tree, node);
+                }
+            }
+        } else if (log != NULL) {
+            walInsert(log, tree, key);
+        } else {
+            rbInsert(tree, key);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const long count = (argc > 1) ? atol(argv[1]) : 1L << 20;
+    const char *logPath = (argc > 2) ? argv[2] : "bench_wal.log";
+
+    if (count < 1) {
+        fprintf(stderr, "usage: %s [operations] [file]\n", argv[0]);
+        return 1;
+    }
+
+    char *snapshotPath = (char*)malloc(strlen(logPath) + sizeof(".rbt"));
+    int *keys = (int*)malloc((size_t)count * sizeof(int));
+    if (keys == NULL || snapshotPath == NULL) {
+        fprintf(stderr, "could not allocate the benchmark data\n");
+        return 1;
+    }
+    sprintf(snapshotPath, "%s.rbt", logPath);
+
+    // a negative entry -k - 1 deletes k
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (long i = 0; i < count; i++) {
+        const uint64_t random = benchRandom(&seed);
+        const int key = (int)(random % KEY_RANGE);
+        keys[i] = ((random >> 40) % 5 == 0) ? -key - 1 : key;
+    }
+
+    redBlackTree *tree = initializeTree();
+    uint64_t start = benchNow();
+    apply(tree, NULL, keys, count);
+    const double memoryNs = (double)(benchNow() - start) / (double)count;
+    destroyTree(tree);
+    printf("%-12s %10s %12s %12s %10s\n", "group", "ops", "ns/op", "ops/s", "fsyncs");
+    printf("%-12s %10ld %12.1f %12.0f %10d\n", "in-memory", count, memoryNs, 1e9 / memoryNs, 0);
+
+    for (size_t g = 0; g < sizeof(groupSizes) / sizeof(groupSizes[0]); g++) {
+        const long ops = (groupSizes[g] == 1 && count > SYNC_EACH_LIMIT) ? SYNC_EACH_LIMIT : count;
+        remove(logPath);
+        writeAheadLog *log = NULL;
+        tree = walRecover(snapshotPath, logPath, groupSizes[g], &log);
+        if (tree == NULL) {
+            return 1;
+        }
+
+        start = benchNow();
+        apply(tree, log, keys, ops);
+        walSync(log);
+        const double ns = (double)(benchNow() - start) / (double)ops;
+        printf("%-12zu %10ld %12.1f %12.0f %10llu\n", groupSizes[g], ops, ns, 1e9 / ns,
+               (unsigned long long)log->syncs);
+
+        walClose(log);
+        destroyTree(tree);
+    }
+
+    // the log of the last run holds every operation
+    writeAheadLog *log = NULL;
+    start = benchNow();
+    tree = walRecover(snapshotPath, logPath, RECOVERY_GROUP, &log);
+    const double replayMs = (double)(benchNow() - start) / 1e6;
+    if (tree == NULL) {
+        return 1;
+    }
+    printf("\nrecovery from the log alone: %ld operations in %.1f ms (%.1f ns/operation), %d keys\n",
+           count, replayMs, replayMs * 1e6 / (double)count, size(tree, tree->root));
+
+    // checkpoint, log the last tenth again, and recover from the snapshot plus that tail
+    start = benchNow();
+    walCheckpoint(log, tree, snapshotPath);
+    const double checkpointMs = (double)(benchNow() - start) / 1e6;
+    const long tail = count / 10;
+    apply(tree, log, keys, tail);
+    walClose(log);
+    destroyTree(tree);
+
+    start = benchNow();
+    tree = walRecover(snapshotPath, logPath, RECOVERY_GROUP, &log);
+    const double snapshotMs = (double)(benchNow() - start) / 1e6;
+    if (tree == NULL) {
+        return 1;
+    }
+    printf("checkpoint in %.1f ms, recovery from the snapshot and %ld operations in %.1f ms, %d keys\n",
+           checkpointMs, tail, snapshotMs, size(tree, tree->root));
+    printf("peak RSS: %ld KB\n", benchPeakRssKb());
+
+    walClose(log);
+    destroyTree(tree);
+    remove(logPath);
+    remove(snapshotPath);
+    free(snapshotPath);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,382 @@
+#include "array_tree.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+
+#define AT_MIN_CAPACITY 64u
+
+static inline uint32_t parentOf(const arrayNode *nodes, uint32_t i) {
+    return nodes[i].parentAndColor & ~AT_COLOR_BIT;
+}
+
+static inline void setParent(arrayNode *nodes, uint32_t i, uint32_t parent) {
+    nodes[i].parentAndColor = (nodes[i].parentAndColor & AT_COLOR_BIT) | parent;
+}
+
+static inline bool isBlackAt(const arrayNode *nodes, uint32_t i) {
+    return (nodes[i].parentAndColor & AT_COLOR_BIT) != 0;
+}
+
+static inline void setBlack(arrayNode *nodes, uint32_t i) {
+    nodes[i].parentAndColor |= AT_COLOR_BIT;
+}
+
+static inline void setRed(arrayNode *nodes, uint32_t i) {
+    nodes[i].parentAndColor &= ~AT_COLOR_BIT;
+}
+
+arrayTree *atInitializeTree(void) {
+    arrayTree *tree = (arrayTree*)malloc(sizeof(arrayTree));
+    if (tree == NULL) {
+        fprintf(stderr, "tree was not allocated and the new tree was not created\n");
+        return NULL;
+    }
+
+    tree->nodes = (arrayNode*)malloc(AT_MIN_CAPACITY * sizeof(arrayNode));
+    if (tree->nodes == NULL) {
+        fprintf(stderr, "node array was not allocated and the new tree was not created\n");
+        free(tree);
+        return NULL;
+    }
+
+    // slot 0 is the sentinel: BLACK, pointing at itself
+    tree->nodes[AT_NIL].key = -1;
+    tree->nodes[AT_NIL].left = AT_NIL;
+    tree->nodes[AT_NIL].right = AT_NIL;
+    tree->nodes[AT_NIL].parentAndColor = AT_COLOR_BIT | AT_NIL;
+
+    tree->root = AT_NIL;
+    tree->capacity = AT_MIN_CAPACITY;
+    tree->used = 1;
+    tree->freeList = AT_NIL;
+    tree->count = 0;
+
+    return tree;
+}
+
+// returns a free slot, growing the array if needed, or AT_NIL if that fails
+static uint32_t allocateSlot(arrayTree *tree) {
+    if (tree->freeList != AT_NIL) {
+        const uint32_t slot = tree->freeList;
+        tree->freeList = tree->nodes[slot].left;
+        return slot;
+    }
+
+    if (tree->used == tree->capacity) {
+        if (tree->capacity > AT_MAX_NODES / 2) {
+            return AT_NIL;
+        }
+
+        const uint32_t capacity = tree->capacity * 2;
+        arrayNode *nodes = (arrayNode*)realloc(tree->nodes, (size_t)capacity * sizeof(arrayNode));
+        if (nodes == NULL) {
+            return AT_NIL;
+        }
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+
+    return tree->used++;
+}
+
+static void leftRotateAt(arrayTree *tree, uint32_t x) {
+    arrayNode *n = tree->nodes;
+    const uint32_t y = n[x].right;
+    const uint32_t xParent = parentOf(n, x);
+
+    n[x].right = n[y].left; // turn y's left subtree into x's right subtree
+    if (n[y].left != AT_NIL) {
+        setParent(n, n[y].left, x);
+    }
+
+    setParent(n, y, xParent); // x's parent becomes y's parent
+    if (xParent == AT_NIL) {
+        tree->root = y;
+    } else if (x == n[xParent].left) {
+        n[xParent].left = y;
+    } else {
+        n[xParent].right = y;
+    }
+
+    n[y].left = x;
+    setParent(n, x, y);
+}
+
+static void rightRotateAt(arrayTree *tree, uint32_t x) {
+    arrayNode *n = tree->nodes;
+    const uint32_t y = n[x].left;
+    const uint32_t xParent = parentOf(n, x);
+
+    n[x].left = n[y].right; // turn y's right subtree into x's left subtree
+    if (n[y].right != AT_NIL) {
+        setParent(n, n[y].right, x);
+    }
+
+    setParent(n, y, xParent); // x's parent becomes y's parent
+    if (xParent == AT_NIL) {
+        tree->root = y;
+    } else if (x == n[xParent].left) {
+        n[xParent].left = y;
+    } else {
+        n[xParent].right = y;
+    }
+
+    n[y].right = x;
+    setParent(n, x, y);
+}
+
+static void insertFixup(arrayTree *tree, uint32_t z) {
+    arrayNode *n = tree->nodes;
+
+    while (!isBlackAt(n, parentOf(n, z))) {
+        uint32_t p = parentOf(n, z);
+        const uint32_t g = parentOf(n, p);
+
+        // same cases as rbInsertFixup(), with the side of z's parent deciding the mirror image
+        if (p == n[g].left) {
+            const uint32_t y = n[g].right; // z's uncle
+
+            if (!isBlackAt(n, y)) {
+                setBlack(n, p);
+                setBlack(n, y);
+                setRed(n, g);
+                z = g;
+            } else {
+                if (z == n[p].right) {
+                    z = p;
+                    leftRotateAt(tree, z);
+                    p = parentOf(n, z);
+                }
+                setBlack(n, p);
+                setRed(n, g);
+                rightRotateAt(tree, g);
+            }
+        } else {
+            const uint32_t y = n[g].left;
+
+            if (!isBlackAt(n, y)) {
+                setBlack(n, p);
+                setBlack(n, y);
+                setRed(n, g);
+                z = g;
+            } else {
+                if (z == n[p].left) {
+                    z = p;
+                    rightRotateAt(tree, z);
+                    p = parentOf(n, z);
+                }
+                setBlack(n, p);
+                setRed(n, g);
+                leftRotateAt(tree, g);
+            }
+        }
+    }
+    setBlack(n, tree->root);
+}
+
+uint32_t atInsert(arrayTree *tree, const int data) {
+    const uint32_t z = allocateSlot(tree);
+    if (z == AT_NIL) {
+        fprintf(stderr, "The memory allocation failed. The value has not been inserted\n");
+        return AT_NIL;
+    }
+
+    arrayNode *n = tree->nodes; // only valid now that the array has grown
+    uint32_t x = tree->root;
+    uint32_t y = AT_NIL;
+
+    while (x != AT_NIL) {
+        y = x;
+        x = (data < n[x].key) ? n[x].left : n[x].right;
+    }
+
+    n[z].key = data;
+    n[z].left = AT_NIL;
+    n[z].right = AT_NIL;
+    n[z].parentAndColor = y; // RED, since the color bit is clear
+
+    if (y == AT_NIL) {
+        tree->root = z;
+    } else if (data < n[y].key) {
+        n[y].left = z;
+    } else {
+        n[y].right = z;
+    }
+
+    insertFixup(tree, z);
+    tree->count++;
+
+    return z;
+}
+
+uint32_t atMinimum(const arrayTree *tree, uint32_t node) {
+    while (tree->nodes[node].left != AT_NIL) {
+        node = tree->nodes[node].left;
+    }
+    return node;
+}
+
+uint32_t atMaximum(const arrayTree *tree, uint32_t node) {
+    while (tree->nodes[node].right != AT_NIL) {
+        node = tree->nodes[node].right;
+    }
+    return node;
+}
+
+static void transplant(arrayTree *tree, uint32_t u, uint32_t v) {
+    arrayNode *n = tree->nodes;
+    const uint32_t uParent = parentOf(n, u);
+
+    if (uParent == AT_NIL) {
+        tree->root = v;
+    } else if (u == n[uParent].left) {
+        n[uParent].left = v;
+    } else {
+        n[uParent].right = v;
+    }
+
+    setParent(n, v, uParent); // may write the sentinel's parent, which deleteFixup() relies on
+}
+
+static void deleteFixup(arrayTree *tree, uint32_t x) {
+    arrayNode *n = tree->nodes;
+
+    while (x != tree->root && isBlackAt(n, x)) {
+        const uint32_t p = parentOf(n, x);
+
+        // same four cases as rbDeleteFixup()
+        if (x == n[p].left) {
+            uint32_t w = n[p].right;
+
+            if (!isBlackAt(n, w)) {
+                setBlack(n, w);
+                setRed(n, p);
+                leftRotateAt(tree, p);
+                w = n[p].right;
+            }
+
+            if (isBlackAt(n, n[w].left) && isBlackAt(n, n[w].right)) {
+                setRed(n, w);
+                x = p;
+            } else {
+                if (isBlackAt(n, n[w].right)) {
+                    setBlack(n, n[w].left);
+                    setRed(n, w);
+                    rightRotateAt(tree, w);
+                    w = n[p].right;
+                }
+
+                if (isBlackAt(n, p)) {
+                    setBlack(n, w);
+                } else {
+                    setRed(n, w);
+                }
+                setBlack(n, p);
+                setBlack(n, n[w].right);
+                leftRotateAt(tree, p);
+                x = tree->root;
+            }
+        } else {
+            uint32_t w = n[p].left;
+
+            if (!isBlackAt(n, w)) {
+                setBlack(n, w);
+                setRed(n, p);
+                rightRotateAt(tree, p);
+                w = n[p].left;
+            }
+
+            if (isBlackAt(n, n[w].right) && isBlackAt(n, n[w].left)) {
+                setRed(n, w);
+                x = p;
+            } else {
+                if (isBlackAt(n, n[w].left)) {
+                    setBlack(n, n[w].right);
+                    setRed(n, w);
+                    leftRotateAt(tree, w);
+                    w = n[p].left;
+                }
+
+                if (isBlackAt(n, p)) {
+                    setBlack(n, w);
+                } else {
+                    setRed(n, w);
+                }
+                setBlack(n, p);
+                setBlack(n, n[w].left);
+                rightRotateAt(tree, p);
+                x = tree->root;
+            }
+        }
+    }
+    setBlack(n, x);
+}
+
+void atDelete(arrayTree *tree, uint32_t z) {
+    arrayNode *n = tree->nodes;
+    uint32_t y = z;
+    bool yOriginalBlack = isBlackAt(n, y);
+    uint32_t x;
+
+    if (n[z].left == AT_NIL) {
+        x = n[z].right;
+        transplant(tree, z, n[z].right);
+    } else if (n[z].right == AT_NIL) {
+        x = n[z].left;
+        transplant(tree, z, n[z].left);
+    } else {
+        y = atMinimum(tree, n[z].right); // z's successor
+        yOriginalBlack = isBlackAt(n, y);
+        x = n[y].right;
+
+        if (y != n[z].right) {
+            transplant(tree, y, n[y].right);
+            n[y].right = n[z].right;
+            setParent(n, n[y].right, y);
+        } else {
+            setParent(n, x, y);
+        }
+
+        transplant(tree, z, y);
+        n[y].left = n[z].left;
+        setParent(n, n[y].left, y);
+        if (isBlackAt(n, z)) {
+            setBlack(n, y);
+        } else {
+            setRed(n, y);
+        }
+    }
+
+    if (yOriginalBlack) {
+        deleteFixup(tree, x);
+    }
+
+    // recycle z's slot
+    n[z].left = tree->freeList;
+    tree->freeList = z;
+    tree->count--;
+}
+
+uint32_t atTreeSearch(const arrayTree *tree, int key) {
+    const arrayNode *n = tree->nodes;
+    uint32_t x = tree->root;
+
+    while (x != AT_NIL && key != n[x].key) {
+        x = (key < n[x].key) ? n[x].left : n[x].right;
+    }
+
+    return x;
+}
+
+Color atColor(const arrayTree *tree, uint32_t node) {
+    return isBlackAt(tree->nodes, node) ? BLACK : RED;
+}
+
+uint32_t atParent(const arrayTree *tree, uint32_t node) {
+    return parentOf(tree->nodes, node);
+}
+
+void atDestroyTree(arrayTree *tree) {
+    free(tree->nodes);
+    free(tree);
+}
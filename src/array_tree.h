@@ -0,0 +1,143 @@
+#ifndef ARRAY_TREE
+#define ARRAY_TREE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "red_black_tree.h"
+
+/* NOTE: arrayTree is a cache-dense variant of redBlackTree. All nodes live in one growable array and refer to
+*  each other by 32-bit index instead of by pointer, and the color is packed into the top bit of the parent
+*  index, so a node is 16 bytes instead of 40. Index 0 is the sentinel (the nil node).
+*
+*  Indices stay valid while the array grows, but arrayNode pointers do not: re-read tree->nodes after any
+*  insertion.
+*/
+
+#define AT_NIL 0u
+#define AT_COLOR_BIT 0x80000000u // set when the node is BLACK
+#define AT_MAX_NODES 0x7FFFFFFFu
+
+typedef struct arrayNode {
+    int key;
+    uint32_t left;
+    uint32_t right;
+    uint32_t parentAndColor; // parent index in the low 31 bits, color in the top bit
+} arrayNode;
+
+typedef struct arrayTree {
+    arrayNode *nodes;
+    uint32_t root;
+    uint32_t capacity; // slots allocated in nodes
+    uint32_t used; // slots handed out so far, including the sentinel
+    uint32_t freeList; // slots released by atDelete(), linked through their left index
+    uint32_t count; // number of keys in the tree
+} arrayTree;
+
+/**
+ * @brief Initializes an empty arrayTree whose only slot is the sentinel.
+ *
+ * Runs in O(1).
+ *
+ * @return Returns a pointer to an arrayTree struct, unless memory allocation failed in which case an error
+ * message is printed and NULL is returned.
+*/
+arrayTree *atInitializeTree(void);
+
+/**
+ * @brief Inserts a RED node with the given key like rbInsert(), then restores the Red-Black properties.
+ *
+ * Runs in O(log(n)), plus an amortized O(1) for growing the node array.
+ *
+ * @param *tree The arrayTree the key is inserted into.
+ * @param data The key of the new node.
+ *
+ * @return The index of the new node, or AT_NIL if the array could not grow (an error message is printed and the
+ * key is not inserted).
+*/
+uint32_t atInsert(arrayTree *tree, const int data);
+
+/**
+ * @brief Deletes the node at index z like rbDelete(), then restores the Red-Black properties. The slot is
+ * reused by a later atInsert().
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The arrayTree being deleted from.
+ * @param z The index of the node to be deleted.
+ *
+ * @return Nothing.
+*/
+void atDelete(arrayTree *tree, uint32_t z);
+
+/**
+ * @brief Searches an arrayTree for a node containing the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The arrayTree being searched.
+ * @param key The value being searched for.
+ *
+ * @return The index of a node holding key, or AT_NIL if the key is not in the tree.
+*/
+uint32_t atTreeSearch(const arrayTree *tree, int key);
+
+/**
+ * @brief Finds the node with the min value in the subtree rooted at the given index.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The arrayTree being searched in.
+ * @param node The index of the subtree root, tree->root for the overall min value.
+ *
+ * @return The index of the node with the minimum value.
+*/
+uint32_t atMinimum(const arrayTree *tree, uint32_t node);
+
+/**
+ * @brief Finds the node with the max value in the subtree rooted at the given index.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The arrayTree being searched in.
+ * @param node The index of the subtree root, tree->root for the overall max value.
+ *
+ * @return The index of the node with the maximum value.
+*/
+uint32_t atMaximum(const arrayTree *tree, uint32_t node);
+
+/**
+ * @brief Finds the color of the node at the given index.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The arrayTree the node belongs to.
+ * @param node The index of the node being examined.
+ *
+ * @return The color of the node.
+*/
+Color atColor(const arrayTree *tree, uint32_t node);
+
+/**
+ * @brief Finds the parent of the node at the given index.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The arrayTree the node belongs to.
+ * @param node The index of the node being examined.
+ *
+ * @return The index of the parent, AT_NIL for the root.
+*/
+uint32_t atParent(const arrayTree *tree, uint32_t node);
+
+/**
+ * @brief Frees the node array and the arrayTree itself.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The arrayTree being destroyed.
+ *
+ * @return Nothing.
+*/
+void atDestroyTree(arrayTree *tree);
+
+#endif
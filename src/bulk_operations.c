@@ -0,0 +1,629 @@
+#include "bulk_operations.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "pthread.h"
+
+/* a Red-Black subtree that has been cut loose from the tree, with a BLACK root (or nil) and its black height,
+*  i.e. the number of BLACK nodes on every path from the root down to nil, nil excluded
+*/
+typedef struct piece {
+    treeNode *root;
+    int blackHeight;
+} piece;
+
+// the whole tree as a piece
+static piece wholeTree(const redBlackTree *tree) {
+    piece result = {tree->root, tree->blackHeight};
+    return result;
+}
+
+// makes a piece the whole tree
+static void setTree(redBlackTree *tree, piece whole) {
+    tree->root = whole.root;
+    tree->blackHeight = whole.blackHeight;
+    tree->modifications++;
+}
+
+/* silences the observer of the tree for a bulk operation. Its rotations and joins would report most of the nodes
+*  they pass, and runSetOperation() runs them on several threads, so the observer is told once by resumeObserver()
+*  that the whole tree changed instead
+*/
+static rbObserver suspendObserver(redBlackTree *tree) {
+    rbObserver observer = tree->observer;
+    tree->observer = NULL;
+    return observer;
+}
+
+static void resumeObserver(redBlackTree *tree, rbObserver observer) {
+    tree->observer = observer;
+    if (observer != NULL) {
+        observer(tree->observerContext, RB_TREE_RESET, NULL);
+    }
+}
+
+// cuts node off its parent and blackens it, which raises the black height of a RED root by one
+static piece detach(redBlackTree *tree, treeNode *node, int blackHeight) {
+    piece result = {node, blackHeight};
+
+    if (node != tree->nil) {
+        node->parent = tree->nil;
+        if (node->color == RED) {
+            node->color = BLACK;
+            result.blackHeight++;
+        }
+    }
+
+    return result;
+}
+
+/* joins left, the node middle and right into one piece, where every key of left is <= middle's key and every key
+*  of right is >= it. middle is hung RED at the point of the taller piece's spine where the shorter piece's black
+*  height is reached, and rbInsertFixup() repairs a RED-RED pair from there. Runs in O(difference of the black
+*  heights + 1).
+*/
+static piece join(redBlackTree *tree, piece left, treeNode *middle, piece right) {
+    treeNode *nil = tree->nil;
+    const size_t joinedSize = left.root->subtreeSize + right.root->subtreeSize + 1;
+
+    if (left.blackHeight == right.blackHeight) {
+        middle->left = left.root;
+        middle->right = right.root;
+        middle->parent = nil;
+        middle->color = BLACK;
+        middle->subtreeSize = joinedSize;
+        if (left.root != nil) {
+            left.root->parent = middle;
+        }
+        if (right.root != nil) {
+            right.root->parent = middle;
+        }
+
+        piece result = {middle, left.blackHeight + 1};
+        return result;
+    }
+
+    // dir is the side of the taller piece that the shorter one is hung from: 1 walks down left's right spine
+    const int dir = (left.blackHeight > right.blackHeight);
+    piece taller = dir ? left : right;
+    piece shorter = dir ? right : left;
+
+    treeNode *parent = nil;
+    treeNode *y = taller.root;
+    int height = taller.blackHeight;
+
+    // nil counts as BLACK with black height 0, so this always stops
+    while (y->color != BLACK || height != shorter.blackHeight) {
+        height -= (y->color == BLACK);
+        parent = y;
+        y = dir ? y->right : y->left;
+    }
+
+    middle->color = RED;
+    middle->parent = parent;
+    if (dir) {
+        middle->left = y;
+        middle->right = shorter.root;
+        parent->right = middle;
+    } else {
+        middle->left = shorter.root;
+        middle->right = y;
+        parent->left = middle;
+    }
+    if (y != nil) {
+        y->parent = middle;
+    }
+    if (shorter.root != nil) {
+        shorter.root->parent = middle;
+    }
+
+    // middle and the shorter piece are new descendants of everything above them
+    middle->subtreeSize = y->subtreeSize + shorter.root->subtreeSize + 1;
+    for (treeNode *ancestor = parent; ancestor != nil; ancestor = ancestor->parent) {
+        ancestor->subtreeSize += shorter.root->subtreeSize + 1;
+    }
+
+    // the fixup works on the whole tree, so the taller piece stands in for it while it runs
+    setTree(tree, taller);
+    rbInsertFixup(tree, middle);
+
+    return wholeTree(tree);
+}
+
+/* splits the subtree at x (whose black height, counting x, is blackHeight) into the nodes that go left and the
+*  nodes that go right of pivot: keys < pivot go left, or keys <= pivot when inclusive is set. Each node on the
+*  search path is joined back into one side together with the subtree hanging off its other side. The black
+*  heights of those joins shrink on the way up, so their costs add up to O(log(n)).
+*/
+static void split(redBlackTree *tree, treeNode *x, int blackHeight, int pivot, bool inclusive, piece *left,
+                  piece *right) {
+    if (x == tree->nil) {
+        left->root = right->root = tree->nil;
+        left->blackHeight = right->blackHeight = 0;
+        return;
+    }
+
+    const int childHeight = blackHeight - (x->color == BLACK);
+    treeNode *leftChild = x->left;
+    treeNode *rightChild = x->right;
+    piece rest;
+
+    if (inclusive ? x->key <= pivot : x->key < pivot) {
+        // x and everything on its left go left, only its right subtree still has to be split
+        split(tree, rightChild, childHeight, pivot, inclusive, &rest, right);
+        *left = join(tree, detach(tree, leftChild, childHeight), x, rest);
+    } else {
+        split(tree, leftChild, childHeight, pivot, inclusive, left, &rest);
+        *right = join(tree, rest, x, detach(tree, rightChild, childHeight));
+    }
+}
+
+// removes the node with the smallest key from a piece, returning it in *first and what is left of the piece
+static piece splitFirst(redBlackTree *tree, piece whole, treeNode **first) {
+    treeNode *x = whole.root;
+    const int childHeight = whole.blackHeight - 1;
+
+    if (x->left == tree->nil) {
+        *first = x;
+        return detach(tree, x->right, childHeight);
+    }
+
+    piece rest = splitFirst(tree, detach(tree, x->left, childHeight), first);
+    return join(tree, rest, x, detach(tree, x->right, childHeight));
+}
+
+// joins two pieces without a middle node, every key of left being <= every key of right
+static piece concatenate(redBlackTree *tree, piece left, piece right) {
+    if (right.root == tree->nil) {
+        return left;
+    }
+    if (left.root == tree->nil) {
+        return right;
+    }
+
+    treeNode *first;
+    piece rest = splitFirst(tree, right, &first);
+    return join(tree, left, first, rest);
+}
+
+// deletes middle, which join() just used to glue the piece together
+static piece deleteJoinNode(redBlackTree *tree, piece joined, treeNode *middle) {
+    setTree(tree, joined);
+    rbDelete(tree, middle);
+
+    return wholeTree(tree);
+}
+
+// first index in the sorted keys[0, count) whose key is >= key (or > key when inclusive is set)
+static size_t searchKeys(const int *keys, size_t count, int key, bool inclusive) {
+    size_t lo = 0;
+    size_t hi = count;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (inclusive ? keys[mid] <= key : keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+// removes the nodes whose key is in the sorted keys from subtree, and returns what remains
+static piece difference(redBlackTree *tree, piece subtree, const int *keys, size_t count) {
+    if (subtree.root == tree->nil || count == 0) {
+        return subtree;
+    }
+
+    treeNode *x = subtree.root;
+    const int childHeight = subtree.blackHeight - 1; // the root of a piece is BLACK
+    const size_t lower = searchKeys(keys, count, x->key, false);
+    const size_t upper = searchKeys(keys, count, x->key, true);
+
+    // equal keys can sit on either side of x, so the keys equal to x's go down both sides
+    piece left = difference(tree, detach(tree, x->left, childHeight), keys, upper);
+    piece right = difference(tree, detach(tree, x->right, childHeight), keys + lower, count - lower);
+
+    piece joined = join(tree, left, x, right);
+    if (lower < upper) {
+        joined = deleteJoinNode(tree, joined, x);
+    }
+
+    return joined;
+}
+
+size_t rbEraseRange(redBlackTree *tree, int lo, int hi) {
+    if (lo > hi) {
+        return 0;
+    }
+
+    // splitting has a cost, so leave the tree alone when nothing is in the range
+    treeNode *first = rbLowerBound(tree, lo);
+    if (first == tree->nil || first->key > hi) {
+        return 0;
+    }
+
+    rbObserver observer = suspendObserver(tree);
+    piece below;
+    piece rest;
+    piece range;
+    piece above;
+    split(tree, tree->root, tree->blackHeight, lo, false, &below, &rest);
+    split(tree, rest.root, rest.blackHeight, hi, true, &range, &above);
+
+    const size_t erased = range.root->subtreeSize;
+
+    // keep the root of the range as the middle node for joining the outer pieces, and release the rest in bulk
+    treeNode *middle = range.root;
+    destroyTreeHelper(tree, middle->left);
+    destroyTreeHelper(tree, middle->right);
+
+    setTree(tree, deleteJoinNode(tree, join(tree, below, middle, above), middle));
+    resumeObserver(tree, observer);
+
+    return erased;
+}
+
+size_t rbDeleteBatch(redBlackTree *tree, const int *keys, size_t count) {
+    if (count == 0 || tree->root == tree->nil) {
+        return 0;
+    }
+
+    int *sorted = (int*)malloc(count * sizeof(int));
+    if (sorted == NULL) {
+        fprintf(stderr, "The memory allocation failed. No keys have been deleted\n");
+        return 0;
+    }
+
+    memcpy(sorted, keys, count * sizeof(int));
+    if (!rbSortKeys(sorted, count)) {
+        fprintf(stderr, "The memory allocation failed. No keys have been deleted\n");
+        free(sorted);
+        return 0;
+    }
+
+    const size_t before = tree->root->subtreeSize;
+    rbObserver observer = suspendObserver(tree);
+    setTree(tree, difference(tree, wholeTree(tree), sorted, count));
+    resumeObserver(tree, observer);
+
+    free(sorted);
+
+    return before - tree->root->subtreeSize;
+}
+
+redBlackTree *rbSplit(redBlackTree *tree, int key) {
+    redBlackTree *upper = initializeSharedTree(tree);
+    if (upper == NULL) {
+        return NULL;
+    }
+
+    rbObserver observer = suspendObserver(tree);
+    piece left;
+    piece right;
+    split(tree, tree->root, tree->blackHeight, key, true, &left, &right);
+    setTree(tree, left);
+    setTree(upper, right);
+    resumeObserver(tree, observer);
+
+    return upper;
+}
+
+bool rbJoin(redBlackTree *tree, redBlackTree *other) {
+    if (tree == other) {
+        fprintf(stderr, "A tree can not be joined with itself\n");
+        return false;
+    }
+
+    if (tree->root != tree->nil && other->root != other->nil &&
+        rbMaximum(tree, tree->root)->key > rbMinimum(other, other->root)->key) {
+        fprintf(stderr, "The keys of the trees overlap. The trees have not been joined\n");
+        return false;
+    }
+
+    if (!rbSharePool(tree, other)) {
+        return false;
+    }
+
+    rbObserver observer = suspendObserver(tree);
+    piece left = wholeTree(tree);
+    piece right = wholeTree(other);
+    other->root = other->nil;
+
+    setTree(tree, concatenate(tree, left, right));
+    resumeObserver(tree, observer);
+    destroyTree(other);
+
+    return true;
+}
+
+typedef enum setOperation {SET_UNION, SET_INTERSECT, SET_DIFFERENCE} setOperation;
+
+/* the state of one thread of a set operation. Each thread runs the fixups of its joins on a copy of the tree
+*  struct with a root of its own, and holds on to the subtrees it removes instead of releasing them, since the
+*  node pool is not thread safe. They are released once all threads are done.
+*/
+typedef struct worker {
+    redBlackTree *tree;
+    treeNode *released; // detached subtrees, linked through the parent pointers of their roots
+    treeNode *releasedTail;
+    int threads; // threads this worker may hand subproblems to, itself included
+} worker;
+
+typedef struct task {
+    worker worker;
+    redBlackTree view;
+    setOperation operation;
+    piece a;
+    piece b;
+    piece result;
+} task;
+
+static void *runTask(void *argument);
+
+// holds a detached subtree until releaseDeferred()
+static void defer(worker *w, treeNode *node) {
+    if (node == w->tree->nil) {
+        return;
+    }
+
+    node->parent = NULL;
+    if (w->released == NULL) {
+        w->released = node;
+    } else {
+        w->releasedTail->parent = node;
+    }
+    w->releasedTail = node;
+}
+
+// releases every subtree a worker (and the threads it started) removed
+static void releaseDeferred(redBlackTree *tree, worker *w) {
+    treeNode *node = w->released;
+    while (node != NULL) {
+        treeNode *next = node->parent;
+        destroyTreeHelper(tree, node);
+        node = next;
+    }
+    w->released = w->releasedTail = NULL;
+}
+
+// adds the counters a thread collected in its copy of the tree to the tree's own
+static void mergeStats(redBlackTree *tree, const redBlackTree *view) {
+#ifdef RB_ENABLE_STATS
+    tree->stats.leftRotations += view->stats.leftRotations;
+    tree->stats.rightRotations += view->stats.rightRotations;
+    for (int i = 0; i < 3; i++) {
+        tree->stats.insertCases[i] += view->stats.insertCases[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        tree->stats.deleteCases[i] += view->stats.deleteCases[i];
+    }
+    tree->stats.insertFixupIterations += view->stats.insertFixupIterations;
+    tree->stats.deleteFixupIterations += view->stats.deleteFixupIterations;
+    tree->stats.searches += view->stats.searches;
+    tree->stats.searchPathLength += view->stats.searchPathLength;
+#else
+    (void)tree;
+    (void)view;
+#endif
+}
+
+// inserts a lone node into a piece the way rbInsert() does, which beats a split once only one node is left
+static piece insertInto(redBlackTree *tree, piece whole, treeNode *node) {
+    treeNode *nil = tree->nil;
+    treeNode *parent = nil;
+
+    for (treeNode *x = whole.root; x != nil; x = (node->key < x->key) ? x->left : x->right) {
+        x->subtreeSize++;
+        parent = x;
+    }
+
+    node->parent = parent;
+    node->left = nil;
+    node->right = nil;
+    node->color = RED;
+    node->subtreeSize = 1;
+    if (parent == nil) {
+        whole.root = node;
+    } else if (node->key < parent->key) {
+        parent->left = node;
+    } else {
+        parent->right = node;
+    }
+
+    setTree(tree, whole);
+    rbInsertFixup(tree, node);
+
+    return wholeTree(tree);
+}
+
+/* combines the pieces a and b of two trees sharing a node pool. b is taken apart at its root m, a is split at m's
+*  key, the halves are combined recursively and joined again, with or without m and a's nodes equal to m. Runs in
+*  O(m log(n / m + 1)) for pieces of n and m nodes, and the two halves can run on different threads.
+*/
+static piece combine(worker *w, setOperation operation, piece a, piece b) {
+    redBlackTree *tree = w->tree;
+    treeNode *nil = tree->nil;
+
+    if (a.root == nil || b.root == nil) {
+        if (operation == SET_UNION) {
+            return (a.root == nil) ? b : a;
+        }
+
+        // nothing of a is in an empty b, and an empty a has nothing to remove; the rest of both goes
+        defer(w, b.root);
+        if (operation == SET_INTERSECT) {
+            defer(w, a.root);
+            a.root = nil;
+            a.blackHeight = 0;
+        }
+        return a;
+    }
+
+    treeNode *m = b.root;
+    if (operation == SET_UNION && m->subtreeSize == 1) {
+        return insertInto(tree, a, m);
+    }
+
+    const int childHeight = b.blackHeight - 1;
+    piece bLeft = detach(tree, m->left, childHeight);
+    piece bRight = detach(tree, m->right, childHeight);
+    const size_t work = a.root->subtreeSize + b.root->subtreeSize;
+
+    // union keeps a's nodes equal to m's key on the left, the other operations cut them out as a piece of their own
+    piece aLeft;
+    piece aEqual = {nil, 0};
+    piece aRight;
+    if (operation == SET_UNION) {
+        split(tree, a.root, a.blackHeight, m->key, true, &aLeft, &aRight);
+    } else {
+        piece rest;
+        split(tree, a.root, a.blackHeight, m->key, false, &aLeft, &rest);
+        split(tree, rest.root, rest.blackHeight, m->key, true, &aEqual, &aRight);
+    }
+
+    piece left;
+    piece right;
+    task side;
+    pthread_t thread;
+    bool spawned = false;
+
+    // the thread started for the left half gets half of the threads left, and the right half runs here with the rest
+    const int threads = w->threads;
+    const int handed = threads / 2;
+    if (handed > 0 && work >= RB_PARALLEL_GRAIN) {
+        side.view = *tree;
+        rbResetStats(&side.view);
+        side.worker.tree = &side.view;
+        side.worker.released = side.worker.releasedTail = NULL;
+        side.worker.threads = handed;
+        side.operation = operation;
+        side.a = aLeft;
+        side.b = bLeft;
+
+        // if no thread can be started the left half simply runs here
+        spawned = (pthread_create(&thread, NULL, runTask, &side) == 0);
+    }
+
+    if (spawned) {
+        w->threads = threads - handed;
+    } else {
+        left = combine(w, operation, aLeft, bLeft);
+    }
+    right = combine(w, operation, aRight, bRight);
+    w->threads = threads;
+
+    if (spawned) {
+        pthread_join(thread, NULL);
+        left = side.result;
+        mergeStats(tree, &side.view);
+        if (side.worker.released != NULL) {
+            if (w->released == NULL) {
+                w->released = side.worker.released;
+            } else {
+                w->releasedTail->parent = side.worker.released;
+            }
+            w->releasedTail = side.worker.releasedTail;
+        }
+    }
+
+    if (operation == SET_UNION) {
+        return join(tree, left, m, right);
+    }
+
+    m->left = m->right = nil;
+    defer(w, m);
+    if (operation == SET_INTERSECT) {
+        left = concatenate(tree, left, aEqual);
+    } else {
+        defer(w, aEqual.root);
+    }
+    return concatenate(tree, left, right);
+}
+
+static void *runTask(void *argument) {
+    task *side = (task*)argument;
+    side->result = combine(&side->worker, side->operation, side->a, side->b);
+    return NULL;
+}
+
+// runs a set operation on tree with the nodes of other, which is destroyed
+static bool runSetOperation(redBlackTree *tree, redBlackTree *other, int threads, setOperation operation) {
+    if (tree == other) {
+        fprintf(stderr, "A tree can not be combined with itself\n");
+        return false;
+    }
+
+    if (!rbSharePool(tree, other)) {
+        return false;
+    }
+
+    // the views of the worker threads are copies of tree, so they are silent as well
+    rbObserver observer = suspendObserver(tree);
+    worker w = {tree, NULL, NULL, (threads < 1) ? 1 : threads};
+    piece a = wholeTree(tree);
+    piece b = wholeTree(other);
+    other->root = other->nil;
+
+    setTree(tree, combine(&w, operation, a, b));
+    releaseDeferred(tree, &w);
+    resumeObserver(tree, observer);
+    destroyTree(other);
+
+    return true;
+}
+
+bool rbUnion(redBlackTree *tree, redBlackTree *other, int threads) {
+    return runSetOperation(tree, other, threads, SET_UNION);
+}
+
+bool rbIntersect(redBlackTree *tree, redBlackTree *other, int threads) {
+    return runSetOperation(tree, other, threads, SET_INTERSECT);
+}
+
+bool rbDifference(redBlackTree *tree, redBlackTree *other, int threads) {
+    return runSetOperation(tree, other, threads, SET_DIFFERENCE);
+}
+
+bool rbInsertBatch(redBlackTree *tree, const int *keys, size_t count, int threads) {
+    if (count == 0) {
+        return true;
+    }
+
+    // a small batch is cheaper to insert one key at a time, sorted so that neighbouring searches share their path
+    if (count < (size_t)size(tree, tree->root) / RB_BATCH_INSERT_RATIO) {
+        int *sorted = (int*)malloc(count * sizeof(int));
+        if (sorted == NULL) {
+            fprintf(stderr, "The memory allocation failed. No keys have been inserted\n");
+            return false;
+        }
+
+        memcpy(sorted, keys, count * sizeof(int));
+        if (!rbSortKeys(sorted, count)) {
+            free(sorted);
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            rbInsert(tree, sorted[i]);
+        }
+
+        free(sorted);
+        return true;
+    }
+
+    // the sorted batch becomes a balanced tree of its own in one pass, and the union merges it in
+    redBlackTree *batch = rbBuildFromSorted(keys, count);
+    if (batch == NULL) {
+        return false;
+    }
+
+    if (!rbUnion(tree, batch, threads)) {
+        destroyTree(batch);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,173 @@
+#ifndef BULK_OPERATIONS
+#define BULK_OPERATIONS
+
+#include <stddef.h>
+#include "red_black_tree.h"
+
+/* NOTE: bulk operations for redBlackTree. Instead of one rbInsert() or rbDelete() (and one fixup) per key, these
+*  cut trees into pieces with split operations, release the pieces being removed in one go, and join what is left
+*  back together. A join of two Red-Black trees around a middle node only has to walk down as far as their black
+*  heights differ, so the splits and joins together cost O(log(n)) instead of O(log(n)) per key.
+*
+*  Trees can only exchange nodes when they share a node pool (see initializeSharedTree()). The functions taking two
+*  trees call rbSharePool() first, which costs O(m) for the m nodes moved unless the trees already share a pool.
+*  That call may move tree over to the pool of other instead, so tree->nil can change across them.
+*  Programs using the set operations need -pthread.
+*
+*  An observer of a tree (see rbSetObserver()) hears nothing while these run, and a single RB_TREE_RESET at the end.
+*/
+
+// smallest subproblem (in nodes of both trees) that rbUnion(), rbIntersect() and rbDifference() hand to a thread
+#define RB_PARALLEL_GRAIN 16384
+
+// rbInsertBatch() inserts batches smaller than the tree size divided by this one key at a time
+#define RB_BATCH_INSERT_RATIO 16
+
+/**
+ * @brief Deletes every treeNode whose key lies in [lo, hi].
+ *
+ * The tree is split into the keys below lo, the keys in the range and the keys above hi, the middle piece is
+ * released to the node pool as a whole, and the outer pieces are joined again.
+ *
+ * Runs in O(log(n) + k), where k is the number of nodes deleted.
+ *
+ * @param *tree The redBlackTree being changed.
+ * @param lo The smallest key deleted.
+ * @param hi The largest key deleted.
+ *
+ * @return The number of nodes deleted, 0 if lo > hi or no key is in the range.
+*/
+size_t rbEraseRange(redBlackTree *tree, int lo, int hi);
+
+/**
+ * @brief Deletes every treeNode whose key is one of the given keys.
+ *
+ * The keys are sorted, then the tree is taken apart at its root, both halves are cleared recursively with the
+ * keys that fall on their side, and the halves are joined again around the root (which is then deleted if its key
+ * was one of the keys). A half that no key falls into is left untouched.
+ *
+ * Runs in O(k log(n / k + 1)) for k keys, which is O(log(n) + k) when the keys are close together in the tree,
+ * instead of O(k log(n)) for k calls to rbDelete().
+ *
+ * @param *tree The redBlackTree being changed.
+ * @param *keys The keys to delete. Keys may repeat, and keys that are not in the tree are ignored.
+ * @param count The number of keys.
+ *
+ * @return The number of nodes deleted. If the sorted copy of the keys can not be allocated, an error message is
+ * printed, nothing is deleted and 0 is returned.
+*/
+size_t rbDeleteBatch(redBlackTree *tree, const int *keys, size_t count);
+
+/**
+ * @brief Splits a redBlackTree at a key, moving every treeNode with a larger key into a new tree.
+ *
+ * The tree is cut along the search path of the key and the pieces hanging off it are joined into the two halves.
+ * The new tree shares the node pool of the old one, so no node is copied.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The redBlackTree being split. It keeps the keys <= key.
+ * @param key The key to split at.
+ *
+ * @return The new redBlackTree with the keys > key, or NULL (with tree unchanged) if it could not be allocated.
+*/
+redBlackTree *rbSplit(redBlackTree *tree, int key);
+
+/**
+ * @brief Appends every treeNode of other to tree and destroys other.
+ *
+ * Every key of tree must be <= every key of other. The smallest node of other is taken out and used to join the
+ * two trees at the point where their black heights match.
+ *
+ * Runs in O(log(n) + log(m)) if the trees share a node pool, otherwise rbSharePool() adds O(m).
+ *
+ * @note tree->nil may change, when rbSharePool() moves tree over to the pool of other.
+ *
+ * @param *tree The redBlackTree that keeps the nodes of both.
+ * @param *other The redBlackTree holding the larger keys. It is destroyed if the join succeeds.
+ *
+ * @return true on success. If the keys overlap or the nodes could not be moved to one pool, an error message is
+ * printed, both trees are left unchanged and false is returned.
+*/
+bool rbJoin(redBlackTree *tree, redBlackTree *other);
+
+/**
+ * @brief Moves every treeNode of other into tree, keeping duplicate keys, and destroys other.
+ *
+ * other is taken apart at its root, tree is split at the root's key, both halves are merged recursively (on their
+ * own threads while there are threads left and at least RB_PARALLEL_GRAIN nodes to merge), and the results are
+ * joined around the root.
+ *
+ * Runs in O(m log(n / m + 1)) work for m <= n nodes, in O(log(n)^2) time given enough threads.
+ *
+ * @note tree->nil may change, as with rbJoin(). The same holds for rbIntersect() and rbDifference().
+ *
+ * @param *tree The redBlackTree that receives the nodes.
+ * @param *other The redBlackTree whose nodes are moved. It is destroyed if the union succeeds.
+ * @param threads The number of threads to use, the calling thread included. 1 (or less) runs on the caller only.
+ *
+ * @return true on success. If the nodes could not be moved to one pool, an error message is printed, both trees
+ * are left unchanged and false is returned.
+*/
+bool rbUnion(redBlackTree *tree, redBlackTree *other, int threads);
+
+/**
+ * @brief Deletes every treeNode of tree whose key does not occur in other, and destroys other.
+ *
+ * Works like rbUnion(), except that the nodes of tree equal to the root of other are cut out and kept, and
+ * everything else of tree and every node of other is released.
+ *
+ * Runs in O(m log(n / m + 1)) work for m <= n nodes, in O(log(n)^2) time given enough threads.
+ *
+ * @param *tree The redBlackTree being changed.
+ * @param *other The redBlackTree holding the keys to keep. It is destroyed if the intersection succeeds.
+ * @param threads The number of threads to use, the calling thread included. 1 (or less) runs on the caller only.
+ *
+ * @return true on success. If the nodes could not be moved to one pool, an error message is printed, both trees
+ * are left unchanged and false is returned.
+*/
+bool rbIntersect(redBlackTree *tree, redBlackTree *other, int threads);
+
+/**
+ * @brief Deletes every treeNode of tree whose key occurs in other, and destroys other.
+ *
+ * Works like rbIntersect(), except that the nodes of tree equal to the root of other are released instead.
+ *
+ * Runs in O(m log(n / m + 1)) work for m <= n nodes, in O(log(n)^2) time given enough threads.
+ *
+ * @param *tree The redBlackTree being changed.
+ * @param *other The redBlackTree holding the keys to delete. It is destroyed if the difference succeeds.
+ * @param threads The number of threads to use, the calling thread included. 1 (or less) runs on the caller only.
+ *
+ * @return true on success. If the nodes could not be moved to one pool, an error message is printed, both trees
+ * are left unchanged and false is returned.
+*/
+bool rbDifference(redBlackTree *tree, redBlackTree *other, int threads);
+
+/**
+ * @brief Inserts many keys at once, using several threads if asked to.
+ *
+ * The keys are sorted and built into a balanced tree with rbBuildFromSorted(), which rbUnion() then merges into
+ * tree: the batch is split by the keys of the tree, the parts of the batch that fall between two subtrees of the
+ * tree are merged into them independently (on their own threads where there are threads left), and the seams are
+ * rebalanced by the joins on the way back up.
+ *
+ * Batches of fewer than n / RB_BATCH_INSERT_RATIO keys are sorted and inserted with rbInsert() instead, since
+ * the splits and joins only pay off once the batch is a sizable part of the tree.
+ *
+ * Runs in O(k log(n / k + 1)) work for k <= n keys, plus O(k) for sorting and building the batch.
+ *
+ * @note The batch is built in a pool of its own, so when it is larger than tree, rbUnion() moves tree over to the
+ * batch's pool and tree->nil changes.
+ *
+ * @param *tree The redBlackTree the keys are inserted into.
+ * @param *keys The keys to insert, in any order. Duplicates are kept, just as rbInsert() keeps them.
+ * @param count The number of keys.
+ * @param threads The number of threads to use, the calling thread included. 1 (or less) runs on the caller only.
+ *
+ * @return true on success. If a memory allocation failed, an error message is printed, nothing is inserted and
+ * false is returned.
+*/
+bool rbInsertBatch(redBlackTree *tree, const int *keys, size_t count, int threads);
+
+#endif
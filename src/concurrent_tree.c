@@ -0,0 +1,123 @@
+#include "concurrent_tree.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "sched.h"
+
+#ifdef RB_MALLOC_NODES
+#error "concurrent_tree.c needs the nodePool, readers may still be looking at released nodes"
+#endif
+
+// readers load the fields a writer may be changing with relaxed atomics, so the compiler reads each of them once
+#define CT_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CT_PAUSE() __builtin_ia32_pause()
+#else
+#define CT_PAUSE() ((void)0)
+#endif
+
+// spins a reader waits for a writer to finish before giving up its time slice, in case the writer was preempted
+#define CT_SPIN_LIMIT 256
+
+concurrentTree *ctInitializeTree(void) {
+    concurrentTree *tree = (concurrentTree*)malloc(sizeof(concurrentTree));
+    if (tree == NULL) {
+        fprintf(stderr, "tree was not allocated and the new tree was not created\n");
+        return NULL;
+    }
+
+    tree->tree = initializeTree();
+    if (tree->tree == NULL) {
+        free(tree);
+        return NULL;
+    }
+
+    pthread_mutex_init(&tree->writeLock, NULL);
+    tree->sequence = 0;
+
+    return tree;
+}
+
+bool ctContains(concurrentTree *tree, int key) {
+    redBlackTree *rbTree = tree->tree;
+    treeNode *nil = rbTree->nil; // the sentinel never changes
+
+    for (int spins = 0;; spins++) {
+        const unsigned long start = __atomic_load_n(&tree->sequence, __ATOMIC_ACQUIRE);
+        if (start & 1) {
+            if (spins < CT_SPIN_LIMIT) {
+                CT_PAUSE();
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+
+        treeNode *x = CT_LOAD(rbTree->root);
+
+        // NULL links and depths beyond CT_MAX_DEPTH only show up in a torn view, which the check below rejects
+        for (int depth = 0; x != nil && x != NULL && depth < CT_MAX_DEPTH; depth++) {
+            const int nodeKey = CT_LOAD(x->key);
+            if (key == nodeKey) {
+                break;
+            }
+            // load both children so that picking one compiles to a conditional move, as it does in rbTreeSearch()
+            treeNode *left = CT_LOAD(x->left);
+            treeNode *right = CT_LOAD(x->right);
+            x = (key < nodeKey) ? left : right;
+        }
+
+        /* computed from x rather than remembered in a flag when the loop breaks, so that the caller does not wait
+        *  on a hard to predict branch and the next search can start while this one's last node is still loading
+        */
+        const bool found = x != nil && x != NULL;
+
+        // the loads above must complete before the sequence is read again
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&tree->sequence, __ATOMIC_RELAXED) == start) {
+            return found;
+        }
+    }
+}
+
+// called with the write lock held; makes the sequence odd, so readers that overlap the change retry
+static void beginChange(concurrentTree *tree) {
+    __atomic_store_n(&tree->sequence, tree->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void endChange(concurrentTree *tree) {
+    __atomic_store_n(&tree->sequence, tree->sequence + 1, __ATOMIC_RELEASE);
+}
+
+void ctInsert(concurrentTree *tree, int key) {
+    pthread_mutex_lock(&tree->writeLock);
+    beginChange(tree);
+    rbInsert(tree->tree, key);
+    endChange(tree);
+    pthread_mutex_unlock(&tree->writeLock);
+}
+
+bool ctDelete(concurrentTree *tree, int key) {
+    pthread_mutex_lock(&tree->writeLock);
+
+    // searching does not change the tree, so readers are only disturbed when there is something to delete
+    treeNode *node = rbTreeSearch(tree->tree, key);
+    const bool found = node != tree->tree->nil;
+    if (found) {
+        beginChange(tree);
+        rbDelete(tree->tree, node);
+        endChange(tree);
+    }
+
+    pthread_mutex_unlock(&tree->writeLock);
+
+    return found;
+}
+
+void ctDestroyTree(concurrentTree *tree) {
+    destroyTree(tree->tree);
+    pthread_mutex_destroy(&tree->writeLock);
+    free(tree);
+}
@@ -0,0 +1,89 @@
+#ifndef CONCURRENT_TREE
+#define CONCURRENT_TREE
+
+#include <stdbool.h>
+#include <pthread.h>
+#include "red_black_tree.h"
+
+/* NOTE: concurrentTree wraps a redBlackTree so that many threads can use it at once. Writers are serialized by a
+*  mutex and bump a sequence counter before and after every change (odd while a change is in progress). Readers
+*  never take the mutex: they read the counter, search the tree without any locking, and only return the result
+*  if the counter is even and unchanged afterwards, retrying otherwise.
+*
+*  A reader can therefore walk into nodes that a concurrent writer is rotating or has just released. This is safe
+*  because released nodes go back to the tree's nodePool and its slabs are only freed by ctDestroyTree(), so every
+*  pointer a reader can load still points at a treeNode (fresh slabs are zeroed, and a NULL child makes the reader
+*  retry). Traversals are also cut off at CT_MAX_DEPTH so that a torn view can not loop. For the same reason the
+*  concurrent tree can not be used together with RB_MALLOC_NODES.
+*/
+
+// a Red-Black tree with n < 2^64 nodes is at most 2 * log2(n + 1) < 128 levels deep
+#define CT_MAX_DEPTH 128
+
+typedef struct concurrentTree {
+    redBlackTree *tree;
+    pthread_mutex_t writeLock;
+    unsigned long sequence; // odd while a writer is changing the tree
+} concurrentTree;
+
+/**
+ * @brief Initializes an empty concurrentTree.
+ *
+ * Runs in O(1).
+ *
+ * @return Returns a pointer to a concurrentTree struct, unless memory allocation failed in which case an error
+ * message is printed and NULL is returned.
+*/
+concurrentTree *ctInitializeTree(void);
+
+/**
+ * @brief Finds if a key is in the tree, without blocking on writers.
+ *
+ * The search is retried whenever a writer changed the tree while it ran, so the answer is the one a search would
+ * have given at some point during the call.
+ *
+ * Runs in O(log(n)) when no writer interferes.
+ *
+ * @param *tree The concurrentTree being searched.
+ * @param key The key being searched for.
+ *
+ * @return Returns true if a node with the key is in the tree, otherwise false.
+*/
+bool ctContains(concurrentTree *tree, int key);
+
+/**
+ * @brief Inserts a key, serialized with the other writers.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The concurrentTree the key is inserted into.
+ * @param key The key being inserted.
+ *
+ * @return Nothing. If a memory allocation fails, an error message is printed and the key is not inserted.
+*/
+void ctInsert(concurrentTree *tree, int key);
+
+/**
+ * @brief Deletes one node with the given key, serialized with the other writers.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The concurrentTree the key is deleted from.
+ * @param key The key being deleted.
+ *
+ * @return Returns true if a node was deleted, false if the key was not in the tree.
+*/
+bool ctDelete(concurrentTree *tree, int key);
+
+/**
+ * @brief Frees the tree. No other thread may be using it.
+ *
+ * Runs in O(n).
+ *
+ * @param *tree The concurrentTree being freed.
+ *
+ * @return Nothing.
+*/
+void ctDestroyTree(concurrentTree *tree);
+
+#endif
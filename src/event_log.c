@@ -0,0 +1,71 @@
+#include "event_log.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+
+// records the event and passes it on
+static void record(void *context, rbEvent event, treeNode *node) {
+    eventLog *log = (eventLog*)context;
+
+    elEvent *slot = &log->events[log->written & log->mask];
+    slot->node = node;
+    slot->key = (node != NULL) ? node->key : 0;
+    slot->event = (unsigned char)event;
+    slot->color = (node != NULL) ? (unsigned char)node->color : (unsigned char)BLACK;
+    log->written++;
+
+    if (log->next != NULL) {
+        log->next(log->nextContext, event, node);
+    }
+}
+
+eventLog *elCreate(redBlackTree *tree, size_t capacity) {
+    size_t rounded = 1;
+    while (rounded < ((capacity > 0) ? capacity : EL_DEFAULT_CAPACITY)) {
+        rounded *= 2;
+    }
+
+    eventLog *log = (eventLog*)malloc(sizeof(eventLog));
+    elEvent *events = (elEvent*)malloc(rounded * sizeof(elEvent));
+    if (log == NULL || events == NULL) {
+        fprintf(stderr, "The memory allocation failed. The event log has not been created\n");
+        free(log);
+        free(events);
+        return NULL;
+    }
+
+    log->tree = tree;
+    log->next = tree->observer;
+    log->nextContext = tree->observerContext;
+    log->events = events;
+    log->mask = rounded - 1;
+    log->written = 0;
+    rbSetObserver(tree, record, log);
+
+    return log;
+}
+
+void elDestroy(eventLog *log) {
+    if (log->tree->observer == record && log->tree->observerContext == log) {
+        rbSetObserver(log->tree, log->next, log->nextContext);
+    }
+    free(log->events);
+    free(log);
+}
+
+uint64_t elWritten(const eventLog *log) {
+    return log->written;
+}
+
+size_t elRead(const eventLog *log, uint64_t from, elEvent *out, size_t max) {
+    // the buffer holds the last mask + 1 events
+    if (from > log->written || log->written - from > log->mask + 1) {
+        return 0;
+    }
+
+    size_t copied = 0;
+    for (uint64_t i = from; i < log->written && copied < max; i++) {
+        out[copied++] = log->events[i & log->mask];
+    }
+    return copied;
+}
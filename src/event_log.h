@@ -0,0 +1,89 @@
+#ifndef EVENT_LOG
+#define EVENT_LOG
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "red_black_tree.h"
+
+/* NOTE: records the events of a redBlackTree (see rbEvent) into a ring buffer, so the steps of an operation can be
+*  played back after it finished, e.g. by the GUI. The log becomes the observer of its tree and hands every event on
+*  to the observer that was set before (a treeLayout, say), so both see the same stream.
+*
+*  Events are numbered from 0 in the order they happened. The buffer holds the last capacity of them and the oldest
+*  are overwritten, so a reader remembers elWritten() before an operation and reads from there once it is done.
+*  Nothing is recorded, and the tree pays one branch per event, while no log is attached.
+*/
+
+#define EL_DEFAULT_CAPACITY 4096 // events kept, a single insertion or deletion takes about 3 log2(n) of them
+
+typedef struct elEvent {
+    const treeNode *node; // only compared, never followed, since the node may have been released since
+    int key; // the key of the node at the time of the event
+    unsigned char event; // an rbEvent
+    unsigned char color; // the Color of the node after the event
+} elEvent;
+
+typedef struct eventLog {
+    redBlackTree *tree;
+    rbObserver next; // the observer of the tree before the log, which gets every event as well
+    void *nextContext;
+    elEvent *events;
+    size_t mask; // the capacity minus one, which is a power of two
+    uint64_t written; // events recorded so far, event i is kept at events[i & mask]
+} eventLog;
+
+/**
+ * @brief Creates an event log and makes it the observer of the tree, in front of the current one.
+ *
+ * Runs in O(1).
+ *
+ * @note Logs and layouts must be destroyed in the reverse order of their creation, so each puts back the observer
+ * it found.
+ *
+ * @param *tree The redBlackTree being recorded.
+ * @param capacity The number of events kept, rounded up to a power of two. 0 means EL_DEFAULT_CAPACITY.
+ *
+ * @return A pointer to the eventLog, unless memory allocation failed in which case an error message is printed and
+ * NULL is returned.
+*/
+eventLog *elCreate(redBlackTree *tree, size_t capacity);
+
+/**
+ * @brief Puts back the observer that was set before the log and frees the log.
+ *
+ * Runs in O(1).
+ *
+ * @param *log The eventLog being freed.
+ *
+ * @return Nothing.
+*/
+void elDestroy(eventLog *log);
+
+/**
+ * @brief Returns the number of events recorded so far, which is the number the next event will get.
+ *
+ * Runs in O(1).
+ *
+ * @param *log The eventLog.
+ *
+ * @return The number of events recorded.
+*/
+uint64_t elWritten(const eventLog *log);
+
+/**
+ * @brief Copies the events from a given number on, oldest first.
+ *
+ * Runs in O(k) for the k events copied.
+ *
+ * @param *log The eventLog.
+ * @param from The number of the first event copied, as returned by elWritten() before the operation.
+ * @param *out Receives the events.
+ * @param max The room in out.
+ *
+ * @return The number of events copied, at most max. 0 if some of the events from the given number on were
+ * overwritten already, so a partial operation is never played back.
+*/
+size_t elRead(const eventLog *log, uint64_t from, elEvent *out, size_t max);
+
+#endif
@@ -1,20 +1,37 @@
 #include "gtkBackend.h"
+#include "bulk_operations.h"
+#include <ctype.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
-void draw_node(cairo_t *cr, redBlackTree *tree, treeNode *node, const int x, const int y, const int x_offset, const int depth) {
-    if (node == NULL || node == tree->nil) return;
+static treeView view = {1.0, 0.0, 0.0, true};
+static treeDrawing cached_drawing; // what draw_tree() drew last
+static treeAnimation animation; // the operation being played back
+
+// the vertical offset of the root when the view follows it
+#define ROOT_Y 50
 
+void draw_node(cairo_t *cr, const treeNode *node, const Color color, const double x, const double y, const double zoom) {
     // Set the color based on the node's color
-    if (node->color == RED) {
+    if (color == RED) {
         cairo_set_source_rgb(cr, 1.0, 0.0, 0.0); // Red
     } else {
         cairo_set_source_rgb(cr, 0.0, 0.0, 0.0); // Black
     }
 
+    // far away, a node is a dot of a fixed size on screen
+    if (NODE_RADIUS * zoom < DOT_RADIUS_PIXELS) {
+        const double r = MIN(NODE_RADIUS, 1.5 / zoom);
+        cairo_rectangle(cr, x - r, y - r, 2 * r, 2 * r);
+        cairo_fill(cr);
+        return;
+    }
+
     // Draw the node as a circle
-    cairo_arc(cr, x, y, 30, 0, 2 * G_PI); // 30 is the radius of the node
+    cairo_arc(cr, x, y, NODE_RADIUS, 0, 2 * G_PI);
     cairo_fill(cr);
 
     // Prepare the text for the node's key
@@ -27,42 +44,560 @@ void draw_node(cairo_t *cr, redBlackTree *tree, treeNode *node, const int x, con
 
     // Draw the node's key inside the circle
     cairo_set_source_rgb(cr, 0.0, 1.0, 0.0); // Green text
-    cairo_set_font_size(cr, 15);
     // Move the text position so it is centered
     cairo_move_to(cr, x - extents.width / 2, y + extents.height / 2);
     cairo_show_text(cr, key_str); 
+}
 
-    // Calculate positions for left and right children
-    const int child_y = y + 70;                    // Vertical distance between levels
-    const int left_x = x - x_offset;               // Horizontal offset for left child
-    const int right_x = x + x_offset;              // Horizontal offset for right child
+// layout units to pixels
+#define UNIT_WIDTH ((double)NODE_SPACING / TL_SEPARATION)
 
-    // Draw lines connecting to the left and right children
-    if (node->left != tree->nil) {
-        cairo_move_to(cr, x, y+10);
-        cairo_line_to(cr, left_x, child_y);
-        cairo_stroke(cr);
-        draw_node(cr, tree, node->left, left_x, child_y, x_offset / 2, depth + 1);
+// orders nodePositions and nodeStates by the address of their node, which both start with
+static int compare_nodes(const void *a, const void *b) {
+    const uintptr_t first = (uintptr_t)*(const treeNode *const *)a;
+    const uintptr_t second = (uintptr_t)*(const treeNode *const *)b;
+    return (first > second) - (first < second);
+}
+
+// where and how a node is drawn at the current step of the animation, false if it is not linked into the tree yet
+static bool animated_look(const treeNode *node, double *x, double *y, Color *color, bool *highlighted) {
+    *color = node->color;
+    *highlighted = false;
+    if (animation.timer == 0) return true;
+
+    const nodePosition *from = bsearch(&node, animation.from, animation.from_count, sizeof(nodePosition), compare_nodes);
+    if (from != NULL) {
+        *x = from->x + (*x - from->x) * animation.motion;
+        *y = from->y + (*y - from->y) * animation.motion;
     }
 
-    if (node->right != tree->nil) {
-        cairo_move_to(cr, x, y+10);
-        cairo_line_to(cr, right_x, child_y);
+    const nodeState *state = bsearch(&node, animation.states, animation.state_count, sizeof(nodeState), compare_nodes);
+    if (state != NULL) {
+        if (state->hidden) return false;
+        *color = state->color;
+        *highlighted = state->highlighted;
+    }
+    return true;
+}
+
+// a gray triangle from the root of a subtree down over its extent, labelled with its number of nodes if it fits
+static void draw_aggregate(cairo_t *cr, const treeNode *node, const tlRecord *record, const double x, const double y, const double zoom) {
+    const double left = x + record->minX * UNIT_WIDTH;
+    const double right = x + record->maxX * UNIT_WIDTH;
+    const double bottom = y + (double)(record->height - 1) * LEVEL_HEIGHT;
+
+    cairo_set_source_rgb(cr, 0.6, 0.6, 0.6); // Gray
+    cairo_move_to(cr, x, y);
+    cairo_line_to(cr, right + 1.0 / zoom, bottom);
+    cairo_line_to(cr, left - 1.0 / zoom, bottom);
+    cairo_fill(cr);
+
+    if ((right - left) * zoom >= COUNT_LABEL_PIXELS) {
+        char count_str[24]; // flawfinder: ignore (snprintf is protecting against buffer overflows)
+        snprintf(count_str, sizeof(count_str), "%zu", node->subtreeSize);
+
+        // the label keeps its size on screen
+        cairo_save(cr);
+        cairo_set_font_size(cr, 12 / zoom);
+        cairo_text_extents_t extents;
+        cairo_text_extents(cr, count_str, &extents);
+        cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+        cairo_move_to(cr, (left + right) / 2 - extents.width / 2, bottom - extents.height / 2);
+        cairo_show_text(cr, count_str);
+        cairo_restore(cr);
+    }
+}
+
+void draw_subtree(cairo_t *cr, const redBlackTree *tree, const treeLayout *layout, const treeNode *node, const double x, const int depth, const double zoom) {
+    if (node == NULL || node == tree->nil) return;
+    const tlRecord *record = tlNode(layout, node);
+    if (record == NULL) return;
+
+    // the subtree spans its extent in the layout, from its depth down over its height
+    double clip_x1, clip_y1, clip_x2, clip_y2;
+    cairo_clip_extents(cr, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+    const double left = x + record->minX * UNIT_WIDTH - NODE_RADIUS;
+    const double right = x + record->maxX * UNIT_WIDTH + NODE_RADIUS;
+    const double y = (double)depth * LEVEL_HEIGHT;
+    const double bottom = y + (double)(record->height - 1) * LEVEL_HEIGHT + NODE_RADIUS;
+    if (right < clip_x1 || left > clip_x2 || y - NODE_RADIUS > clip_y2 || bottom < clip_y1) return;
+
+    // nodes too close together to tell apart are summed up a subtree at a time
+    if (node->subtreeSize > 1 && NODE_SPACING * zoom < NODE_GAP_PIXELS && (right - left) * zoom < AGGREGATE_PIXELS) {
+        draw_aggregate(cr, node, record, x, y, zoom);
+        return;
+    }
+
+    // during an animation the nodes are on their way from where they were drawn before the operation
+    double shown_x = x;
+    double shown_y = y;
+    Color color;
+    bool highlighted;
+    if (!animated_look(node, &shown_x, &shown_y, &color, &highlighted)) return;
+
+    // Draw lines connecting to the left and right children, under the nodes drawn later
+    const double left_x = x - record->offset * UNIT_WIDTH;
+    const double right_x = x + record->offset * UNIT_WIDTH;
+    const double child_y = y + LEVEL_HEIGHT;
+    cairo_set_source_rgb(cr, 0.0, 1.0, 0.0); // Green lines
+    for (int side = 0; side < 2; side++) {
+        const treeNode *child = (side == 0) ? node->left : node->right;
+        double end_x = (side == 0) ? left_x : right_x;
+        double end_y = child_y;
+        Color child_color;
+        bool child_highlighted;
+        if (child != tree->nil && animated_look(child, &end_x, &end_y, &child_color, &child_highlighted)) {
+            cairo_move_to(cr, shown_x, shown_y + 10);
+            cairo_line_to(cr, end_x, end_y);
+            cairo_stroke(cr);
+        }
+    }
+
+    draw_node(cr, node, color, shown_x, shown_y, zoom);
+    if (highlighted) {
+        // a ring around the node being compared
+        cairo_new_path(cr);
+        cairo_set_source_rgb(cr, 1.0, 0.8, 0.0); // Yellow
+        cairo_arc(cr, shown_x, shown_y, NODE_RADIUS + 5, 0, 2 * G_PI);
         cairo_stroke(cr);
-        draw_node(cr, tree, node->right, right_x, child_y, x_offset / 2, depth + 1);
     }
+    draw_subtree(cr, tree, layout, node->left, left_x, depth + 1, zoom);
+    draw_subtree(cr, tree, layout, node->right, right_x, depth + 1, zoom);
+}
+
+/* the layout, and the event log in front of it, observe the tree from the first draw or operation on. They are made
+*  again for another tree. Only the layout is needed for drawing, so the result does not depend on the log
+*/
+static bool observe_tree(redBlackTree *tree) {
+    if (cached_drawing.layout != NULL && cached_drawing.layout->tree == tree) {
+        return true;
+    }
+
+    // each puts back the observer it found, so they go in the reverse order
+    stop_animation();
+    if (cached_drawing.events != NULL) {
+        elDestroy(cached_drawing.events);
+    }
+    if (cached_drawing.layout != NULL) {
+        tlDestroy(cached_drawing.layout);
+    }
+    cached_drawing.layout = tlCreate(tree);
+    cached_drawing.events = (cached_drawing.layout != NULL) ? elCreate(tree, 0) : NULL;
+
+    return cached_drawing.layout != NULL;
+}
+
+// renders the visible part of the tree onto a new surface like the one cr draws on
+static void render_tree(cairo_t *cr, redBlackTree *tree, const int width, const int height) {
+    if (cached_drawing.surface != NULL) {
+        cairo_surface_destroy(cached_drawing.surface);
+    }
+    cached_drawing.tree = tree;
+    cached_drawing.modifications = tree->modifications;
+    cached_drawing.view = view;
+    cached_drawing.width = width;
+    cached_drawing.height = height;
+    cached_drawing.animated = (animation.timer != 0);
+    cached_drawing.surface = cairo_surface_create_similar(cairo_get_target(cr), CAIRO_CONTENT_COLOR_ALPHA, width, height);
+
+    cairo_t *surface_cr = cairo_create(cached_drawing.surface);
+    cairo_rectangle(surface_cr, 0, 0, width, height);
+    cairo_clip(surface_cr);
+    cairo_translate(surface_cr, view.pan_x, view.pan_y);
+    cairo_scale(surface_cr, view.zoom, view.zoom);
+    cairo_set_font_size(surface_cr, 15);
+    cairo_set_line_width(surface_cr, MAX(2.0, 1.0 / view.zoom)); // lines stay at least a pixel wide
+    draw_subtree(surface_cr, tree, cached_drawing.layout, tree->root, 0, 0, view.zoom);
+    cairo_destroy(surface_cr);
 }
 
 void draw_tree(cairo_t *cr, redBlackTree *tree) {
     // Start drawing from the root of the tree
     if (tree->root == tree->nil) return; // Tree is empty
 
-    // Initial position and offset for the root node
-    const int initial_x = 400;    // Start drawing in the middle of the canvas
-    const int initial_y = 50;     // Start drawing from the top of the canvas
-    const int x_offset = 200;     // Initial horizontal offset between child nodes
+    const int width = gtk_widget_get_allocated_width(drawing_area);
+    const int height = gtk_widget_get_allocated_height(drawing_area);
+
+    // until the user moves the view, the root (at x = 0 in the layout) stays at the top center of the drawing area
+    if (view.follow_root) {
+        view.pan_x = width / 2.0;
+        view.pan_y = ROOT_Y;
+    }
+
+    // render again only if the tree, the view or the size of the drawing area changed since the last draw, or an
+    // animation is playing or just ended
+    if (cached_drawing.surface == NULL || cached_drawing.animated || animation.timer != 0 || cached_drawing.tree != tree ||
+        cached_drawing.modifications != tree->modifications || cached_drawing.width != width ||
+        cached_drawing.height != height || cached_drawing.view.zoom != view.zoom ||
+        cached_drawing.view.pan_x != view.pan_x || cached_drawing.view.pan_y != view.pan_y) {
+        // the layout is brought up to date where the tree changed
+        if (!observe_tree(tree) || !tlUpdate(cached_drawing.layout)) return;
+
+        render_tree(cr, tree, width, height);
+    }
+
+    // a single blit of the cached drawing
+    cairo_set_source_surface(cr, cached_drawing.surface, 0, 0);
+    cairo_paint(cr);
+}
+
+// keeps the positions of the nodes within the visible region [left, right] x [.., bottom]
+static void remember_positions(const redBlackTree *tree, const treeNode *node, const double x, const int depth, const double left, const double right, const double bottom) {
+    if (node == tree->nil || animation.from_count == ANIMATED_NODES_MAX) return;
+    const tlRecord *record = tlNode(cached_drawing.layout, node);
+    if (record == NULL) return;
+
+    const double y = (double)depth * LEVEL_HEIGHT;
+    if (x + record->maxX * UNIT_WIDTH + NODE_RADIUS < left || x + record->minX * UNIT_WIDTH - NODE_RADIUS > right || y - NODE_RADIUS > bottom) return;
+
+    nodePosition *position = &animation.from[animation.from_count++];
+    position->node = node;
+    position->x = x;
+    position->y = y;
+    remember_positions(tree, node->left, x - record->offset * UNIT_WIDTH, depth + 1, left, right, bottom);
+    remember_positions(tree, node->right, x + record->offset * UNIT_WIDTH, depth + 1, left, right, bottom);
+}
+
+void begin_operation(redBlackTree *tree) {
+    stop_animation();
+    if (!observe_tree(tree) || cached_drawing.events == NULL || !tlUpdate(cached_drawing.layout)) return;
+
+    animation.from = (nodePosition*)malloc(ANIMATED_NODES_MAX * sizeof(nodePosition));
+    if (animation.from == NULL) return;
+    animation.first_event = elWritten(cached_drawing.events);
+
+    // the drawing area in layout coordinates
+    const double left = -view.pan_x / view.zoom;
+    const double right = (gtk_widget_get_allocated_width(drawing_area) - view.pan_x) / view.zoom;
+    const double bottom = (gtk_widget_get_allocated_height(drawing_area) - view.pan_y) / view.zoom;
+    remember_positions(tree, tree->root, 0, 0, left, right, bottom);
+    qsort(animation.from, animation.from_count, sizeof(nodePosition), compare_nodes);
+}
+
+// steps that change the shape of the tree move the nodes, the others only change their looks
+static bool is_move(const elEvent *step) {
+    return step->event == RB_NODE_LINKED || step->event == RB_ROTATED_LEFT || step->event == RB_ROTATED_RIGHT ||
+           step->event == RB_TRANSPLANTED;
+}
+
+// finds the step being played after elapsed milliseconds, and how the nodes look at that step
+static void play_until(const double elapsed) {
+    while (animation.step < animation.count && animation.ends[animation.step] <= elapsed) {
+        animation.step++;
+    }
+
+    // the nodes move while the moves play, slowly at the start and at the end
+    double moved = 0;
+    for (size_t i = 0; i < animation.step && i < animation.count; i++) {
+        moved += is_move(&animation.steps[i]);
+    }
+    if (animation.step < animation.count && is_move(&animation.steps[animation.step])) {
+        const double begin = (animation.step > 0) ? animation.ends[animation.step - 1] : 0;
+        moved += (elapsed - begin) / (animation.ends[animation.step] - begin);
+    }
+    const double t = (animation.moves > 0) ? MIN(moved / animation.moves, 1.0) : 1.0;
+    animation.motion = t * t * (3 - 2 * t);
+
+    /* the look before the operation, from the earliest step of each node: a recoloring flips the color (there are
+    *  only two), and a node linked in by the operation is hidden until then, unless it was drawn before
+    */
+    for (size_t i = 0; i < animation.state_count; i++) {
+        animation.states[i].hidden = false;
+        animation.states[i].highlighted = false;
+    }
+    for (size_t i = animation.count; i-- > 0;) {
+        const elEvent *step = &animation.steps[i];
+        nodeState *state = bsearch(&step->node, animation.states, animation.state_count, sizeof(nodeState), compare_nodes);
+        state->color = (step->event == RB_NODE_RECOLORED) ? (step->color == RED ? BLACK : RED) : (Color)step->color;
+        if (step->event == RB_NODE_LINKED &&
+            bsearch(&step->node, animation.from, animation.from_count, sizeof(nodePosition), compare_nodes) == NULL) {
+            state->hidden = true;
+        }
+    }
+
+    // then every step played so far
+    for (size_t i = 0; i <= animation.step && i < animation.count; i++) {
+        const elEvent *step = &animation.steps[i];
+        nodeState *state = bsearch(&step->node, animation.states, animation.state_count, sizeof(nodeState), compare_nodes);
+        state->color = (Color)step->color;
+        if (step->event == RB_NODE_LINKED) {
+            state->hidden = false;
+        }
+        state->highlighted = (i == animation.step && step->event == RB_NODE_COMPARED);
+    }
+}
+
+// redraws the widget for the next frame of the animation
+static gboolean on_frame(gpointer widget) {
+    const double elapsed = (double)(g_get_monotonic_time() - animation.start) / 1000.0;
+    gtk_widget_queue_draw((GtkWidget*)widget);
+
+    if (elapsed >= animation.ends[animation.count - 1]) {
+        animation.timer = 0; // the source goes away by returning G_SOURCE_REMOVE
+        stop_animation();
+        return G_SOURCE_REMOVE;
+    }
+
+    play_until(elapsed);
+    return G_SOURCE_CONTINUE;
+}
+
+void animate_operation(GtkWidget *widget) {
+    gtk_widget_queue_draw(widget);
+    if (animation.from == NULL || cached_drawing.events == NULL) return; // begin_operation() did not get ready
+
+    const size_t count = (size_t)(elWritten(cached_drawing.events) - animation.first_event);
+    animation.steps = (elEvent*)malloc(MAX(count, 1) * sizeof(elEvent));
+    animation.ends = (double*)malloc(MAX(count, 1) * sizeof(double));
+    animation.states = (nodeState*)malloc(MAX(count, 1) * sizeof(nodeState));
+    if (count == 0 || animation.steps == NULL || animation.ends == NULL || animation.states == NULL ||
+        elRead(cached_drawing.events, animation.first_event, animation.steps, count) != count) {
+        stop_animation();
+        return;
+    }
+    animation.count = count;
+
+    // a reset says nothing about the steps that led to it, so there is nothing to play
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        const elEvent *step = &animation.steps[i];
+        if (step->event == RB_TREE_RESET) {
+            stop_animation();
+            return;
+        }
+        if (is_move(step)) {
+            animation.moves++;
+            total += MOVE_MS;
+        } else if (step->event == RB_NODE_COMPARED || step->event == RB_NODE_RECOLORED) {
+            total += STEP_MS;
+        }
+        animation.ends[i] = total;
+    }
+    if (total == 0) {
+        stop_animation();
+        return;
+    }
+    if (total > ANIMATION_MAX_MS) {
+        for (size_t i = 0; i < count; i++) {
+            animation.ends[i] *= ANIMATION_MAX_MS / total;
+        }
+    }
+
+    // one state for each node taking part
+    for (size_t i = 0; i < count; i++) {
+        animation.states[i].node = animation.steps[i].node;
+    }
+    qsort(animation.states, count, sizeof(nodeState), compare_nodes);
+    for (size_t i = 0; i < count; i++) {
+        if (animation.state_count == 0 || animation.states[animation.state_count - 1].node != animation.states[i].node) {
+            animation.states[animation.state_count++].node = animation.states[i].node;
+        }
+    }
+
+    play_until(0);
+    animation.start = g_get_monotonic_time();
+    animation.timer = g_timeout_add(FRAME_MS, on_frame, widget);
+}
+
+void stop_animation(void) {
+    if (animation.timer != 0) {
+        g_source_remove(animation.timer);
+    }
+    free(animation.from);
+    free(animation.steps);
+    free(animation.ends);
+    free(animation.states);
+    memset(&animation, 0, sizeof(animation));
+}
+
+void pan_view(const double dx, const double dy) {
+    view.follow_root = false;
+    view.pan_x += dx;
+    view.pan_y += dy;
+}
+
+void zoom_view(const double factor, const double x, const double y) {
+    const double zoom = MIN(MAX(view.zoom * factor, MIN_ZOOM), MAX_ZOOM);
+
+    // the layout point under (x, y) stays there
+    view.follow_root = false;
+    view.pan_x = x - (x - view.pan_x) * (zoom / view.zoom);
+    view.pan_y = y - (y - view.pan_y) * (zoom / view.zoom);
+    view.zoom = zoom;
+}
+
+void reset_view(void) {
+    view.zoom = 1.0;
+    view.follow_root = true;
+}
+
+void free_tree_drawing(void) {
+    stop_animation();
+    if (cached_drawing.surface != NULL) {
+        cairo_surface_destroy(cached_drawing.surface);
+    }
+    if (cached_drawing.events != NULL) {
+        elDestroy(cached_drawing.events);
+    }
+    if (cached_drawing.layout != NULL) {
+        tlDestroy(cached_drawing.layout);
+    }
+    memset(&cached_drawing, 0, sizeof(cached_drawing));
+}
+
+// commas and white space separate the items of a command
+static const char *skip_separators(const char *cursor) {
+    while (*cursor == ',' || isspace((unsigned char)*cursor)) {
+        cursor++;
+    }
+    return cursor;
+}
+
+// reads a number at the cursor and moves past it, false if there is none or it lies outside [min, max]
+static bool read_number(const char **cursor, const long long min, const long long max, long long *number) {
+    char *end;
+    *number = strtoll(*cursor, &end, 10);
+    if (end == *cursor || *number < min || *number > max) {
+        return false;
+    }
+    *cursor = end;
+    return true;
+}
+
+// makes room for more keys, false (with an error message) past COMMAND_KEYS_MAX or if memory runs out
+static bool reserve_keys(treeCommand *command, const unsigned long long more) {
+    if (more > COMMAND_KEYS_MAX - command->count) {
+        fprintf(stderr, "A command can list at most %d keys\n", COMMAND_KEYS_MAX);
+        return false;
+    }
+    if (command->count + more <= command->capacity) {
+        return true;
+    }
+
+    size_t capacity = MAX(command->capacity * 2, command->count + (size_t)more);
+    int *keys = (int*)realloc(command->keys, capacity * sizeof(int));
+    if (keys == NULL) {
+        fprintf(stderr, "The memory allocation failed. The command has not been run\n");
+        return false;
+    }
+    command->keys = keys;
+    command->capacity = capacity;
+    return true;
+}
+
+bool parse_command(const char *text, treeCommand *command) {
+    memset(command, 0, sizeof(*command));
+    command->type = COMMAND_INSERT;
+
+    // a command letter stands alone, so "random" is not taken for one
+    const char *cursor = skip_separators(text);
+    if ((*cursor == 'i' || *cursor == 'd' || *cursor == 's') && !isalpha((unsigned char)cursor[1])) {
+        command->type = (*cursor == 'i') ? COMMAND_INSERT : (*cursor == 'd') ? COMMAND_DELETE : COMMAND_SEARCH;
+        cursor++;
+    }
+
+    size_t items = 0;
+    bool ranges_only = true;
+    for (cursor = skip_separators(cursor); *cursor != '\0'; cursor = skip_separators(cursor)) {
+        long long first;
+        long long last;
+        bool valid;
+
+        if (strncmp(cursor, "random", 6) == 0) {
+            cursor = skip_separators(cursor + 6);
+            valid = read_number(&cursor, 1, COMMAND_KEYS_MAX, &first) && reserve_keys(command, (unsigned long long)first);
+            if (valid) {
+                const gint32 spread = (gint32)MIN(first * RANDOM_KEY_SPREAD, (long long)INT_MAX);
+                for (long long i = 0; i < first; i++) {
+                    command->keys[command->count++] = g_random_int_range(0, spread);
+                }
+            }
+            ranges_only = false;
+        } else {
+            valid = read_number(&cursor, INT_MIN, INT_MAX, &first);
+            last = first;
+            if (valid && strncmp(cursor, "..", 2) == 0) {
+                cursor += 2;
+                valid = read_number(&cursor, first, INT_MAX, &last);
+                command->lo = (int)first;
+                command->hi = (int)last;
+            } else {
+                ranges_only = false;
+            }
+            valid = valid && reserve_keys(command, (unsigned long long)(last - first + 1));
+            for (long long key = first; valid && key <= last; key++) {
+                command->keys[command->count++] = (int)key;
+            }
+        }
+
+        // an item ends at a separator, so "12ab" is not taken for 12
+        if (!valid || (*cursor != '\0' && *cursor != ',' && !isspace((unsigned char)*cursor))) {
+            fprintf(stderr, "Could not read \"%s\". Type keys, ranges like 1..100 or random 100, after i, d or s to insert, delete or search\n", text);
+            free_command(command);
+            return false;
+        }
+        items++;
+    }
+
+    if (items == 0) {
+        fprintf(stderr, "There is no key to %s\n", (command->type == COMMAND_INSERT) ? "insert" : (command->type == COMMAND_DELETE) ? "delete" : "search for");
+        free_command(command);
+        return false;
+    }
+    command->single_range = (items == 1 && ranges_only);
+
+    return true;
+}
+
+size_t run_command(redBlackTree *tree, const treeCommand *command) {
+    // a single key goes through rbInsert(), rbTreeSearch() and rbDelete(), which leave the steps to play back
+    if (command->count == 1) {
+        const int key = command->keys[0];
+        if (command->type == COMMAND_INSERT) {
+            rbInsert(tree, key);
+            return 1;
+        }
+
+        treeNode *node = rbTreeSearch(tree, key);
+        if (node == tree->nil) {
+            return 0;
+        }
+        if (command->type == COMMAND_DELETE) {
+            rbDelete(tree, node);
+        }
+        return 1;
+    }
+
+    if (command->type == COMMAND_INSERT) {
+        return rbInsertBatch(tree, command->keys, command->count, (int)g_get_num_processors()) ? command->count : 0;
+    }
+    if (command->type == COMMAND_DELETE) {
+        if (command->single_range) {
+            return rbEraseRange(tree, command->lo, command->hi);
+        }
+        return rbDeleteBatch(tree, command->keys, command->count);
+    }
+
+    treeNode **found = (treeNode**)malloc(command->count * sizeof(treeNode*));
+    if (found == NULL) {
+        fprintf(stderr, "The memory allocation failed. The keys have not been searched for\n");
+        return 0;
+    }
+    rbTreeSearchBatch(tree, command->keys, command->count, found);
+
+    size_t hits = 0;
+    for (size_t i = 0; i < command->count; i++) {
+        hits += (found[i] != tree->nil);
+    }
+    free(found);
+    return hits;
+}
 
-    draw_node(cr, tree, tree->root, initial_x, initial_y, x_offset, 0);
+void free_command(treeCommand *command) {
+    free(command->keys);
+    command->keys = NULL;
+    command->count = 0;
+    command->capacity = 0;
 }
 
 int safe_stoi(const char *str) {
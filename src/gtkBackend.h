@@ -3,38 +3,281 @@
 
 #include <gtk/gtk.h>
 #include "red_black_tree.h"
+#include "tree_layout.h"
+#include "event_log.h"
 
-extern GtkWidget *drawing_area; 
+extern GtkWidget *drawing_area;
+
+/* NOTE: nodes are drawn where the tidy layout of tree_layout.h puts them, TL_SEPARATION layout units being
+*  NODE_SPACING pixels, and depth d at y = d * LEVEL_HEIGHT, so nodes never overlap however deep the tree is. The
+*  layout is updated only where the tree changed since the last draw. It also knows the extent of every subtree, so
+*  subtrees outside the visible region are skipped without touching their nodes.
+*/
+
+#define NODE_RADIUS 30
+#define NODE_SPACING 70 // smallest horizontal distance between nodes on the same level
+#define LEVEL_HEIGHT 70 // vertical distance between levels
+
+// level of detail, in pixels on screen
+#define DOT_RADIUS_PIXELS 6.0 // nodes smaller than this are drawn as dots without their key
+#define NODE_GAP_PIXELS 4.0 // once nodes are packed closer than this, narrow subtrees become glyphs
+#define AGGREGATE_PIXELS 64.0 // subtrees narrower than this are then drawn as a single glyph
+#define COUNT_LABEL_PIXELS 40.0 // glyphs at least this wide show how many nodes they stand for
+
+#define MIN_ZOOM 1e-6
+#define MAX_ZOOM 4.0
+
+// playback of an operation, in milliseconds
+#define STEP_MS 150 // a comparison or a recoloring
+#define MOVE_MS 450 // a step that changes the shape of the tree
+#define ANIMATION_MAX_MS 4000 // longer operations are played faster
+#define FRAME_MS 16 // about 60 frames a second
+#define ANIMATED_NODES_MAX 4096 // visible nodes whose positions before an operation are kept, the others do not move
+
+// commands typed into the entry
+#define COMMAND_KEYS_MAX 10000000 // keys a single command may list, ranges and random keys included
+#define RANDOM_KEY_SPREAD 10 // random N draws its keys from [0, RANDOM_KEY_SPREAD * N)
+
+// how the layout is mapped onto the drawing area: screen = layout * zoom + pan
+typedef struct treeView {
+    double zoom;
+    double pan_x;
+    double pan_y;
+    bool follow_root; // keep the root at the top center of the drawing area, until the user pans or zooms
+} treeView;
+
+/* the visible part of the tree rendered onto an off-screen surface the size of the drawing area. It is only
+*  rendered again when rbInsert() or rbDelete() changed the tree (tree->modifications), or the view or the size of
+*  the drawing area changed, so any other expose is a single blit of the surface
+*/
+typedef struct treeDrawing {
+    const redBlackTree *tree; // the tree drawn, NULL before the first draw
+    treeLayout *layout; // the positions of its nodes, which observes the tree from the first draw on
+    unsigned long modifications; // tree->modifications when it was drawn
+    treeView view; // the view it was drawn with
+    int width;
+    int height;
+    bool animated; // drawn during an animation, so it is stale by the next frame
+    cairo_surface_t *surface;
+    eventLog *events; // records the steps of the operations on the tree, in front of the layout
+} treeDrawing;
+
+/* a line typed into the entry: an optional command letter followed by items, separated by spaces or commas
+*    i (or nothing)  inserts the keys        d  deletes them        s  searches for them
+*  and an item is a key (42), a range with both ends included (1..100000), or a number of random keys (random 1000).
+*  A single key is played back step by step; anything more is applied in one go and drawn once.
+*/
+typedef enum commandType {COMMAND_INSERT, COMMAND_DELETE, COMMAND_SEARCH} commandType;
+
+typedef struct treeCommand {
+    commandType type;
+    int *keys; // every key the items stand for
+    size_t count;
+    size_t capacity;
+    bool single_range; // the items are one range [lo, hi], which a deletion erases without listing its keys
+    int lo;
+    int hi;
+} treeCommand;
+
+typedef struct nodePosition {
+    const treeNode *node;
+    double x;
+    double y;
+} nodePosition;
+
+// how a node taking part in an animated operation looks at the current step
+typedef struct nodeState {
+    const treeNode *node;
+    Color color;
+    bool hidden; // not linked into the tree yet
+    bool highlighted; // being compared
+} nodeState;
+
+/* an operation played back from the events it left in the event log, one step per event. The nodes move from where
+*  they were drawn before the operation to where the layout puts them after it, while the steps that change the
+*  shape of the tree play, and take their colors one step at a time
+*/
+typedef struct treeAnimation {
+    uint64_t first_event; // elWritten() when begin_operation() was called
+    nodePosition *from; // the visible nodes before the operation, sorted by address
+    size_t from_count;
+    elEvent *steps;
+    double *ends; // when each step ends, in milliseconds after the start
+    size_t count;
+    size_t moves; // steps that change the shape of the tree
+    nodeState *states; // the nodes of the steps, sorted by address
+    size_t state_count;
+    size_t step; // the step being played
+    double motion; // how far the nodes have moved, from 0 to 1
+    gint64 start; // g_get_monotonic_time() when the playback started
+    guint timer; // the frame timer, 0 while nothing is played
+} treeAnimation;
 
 /**
  * @brief Handles drawing individual nodes in the GUI.
  *
- * Runs in O(n).
+ * The node is drawn as a circle with its key when it is at least DOT_RADIUS_PIXELS on screen, otherwise as a dot.
  *
- * @param *cr The cairo drawing object.  
- * @oaram *tree The redBlacktree being drawn.
+ * Runs in O(1).
+ *
+ * @param *cr The cairo drawing object, in layout coordinates.
  * @param *node The node being drawn.
- * @param x The horizontal coordinate of the node. 
+ * @param color The color it is drawn in, which differs from node->color during an animation.
+ * @param x The horizontal coordinate of the node.
  * @param y The vertical coordinate of the node.
- * @param x_offset The horizontal spacing of the node.
- * @param depth The depth of the node being drawn.
+ * @param zoom The scale of the layout on screen.
  *
  * @returns Nothing. A new node is drawn in the GUI after execution.
 */
-void draw_node(cairo_t *cr, redBlackTree *tree, treeNode *node, const int x, const int y, const int x_offset, const int depth);
+void draw_node(cairo_t *cr, const treeNode *node, const Color color, const double x, const double y, const double zoom);
 
 /**
- * @brief Calls draw_node() after setting the gui size.
+ * @brief Draws a subtree, skipping what lies outside the clip region and drawing narrow subtrees as one glyph.
  *
- * Runs in O(n).
+ * Runs in O(v + h) for the v nodes drawn in a subtree of height h.
+ *
+ * @param *cr The cairo drawing object, in pixels of the layout and clipped to the visible region.
+ * @param *tree The redBlackTree being drawn.
+ * @param *layout The up to date layout of the tree.
+ * @param *node The root of the subtree.
+ * @param x The horizontal coordinate of node.
+ * @param depth The depth of node.
+ * @param zoom The scale of the layout on screen.
  *
- * @param *cr The cairo drawing object. 
+ * @returns Nothing. The visible part of the subtree is drawn in the GUI after execution.
+*/
+void draw_subtree(cairo_t *cr, const redBlackTree *tree, const treeLayout *layout, const treeNode *node, const double x, const int depth, const double zoom);
+
+/**
+ * @brief Draws the visible part of the tree, from the cached off-screen surface unless the tree, the view or the
+ * size of the drawing area changed since the last call.
+ *
+ * Runs in O(1) for an unchanged picture (one blit), otherwise O(v + log(n)) for the v nodes and glyphs visible,
+ * plus O(log^2(n)) for each change to the tree to update the layout (O(n) for the first draw).
+ *
+ * @param *cr The cairo drawing object.
  * @param *tree The redBlackTree being drawn.
  *
  * @returns Nothing. A new tree has been drawn in the GUI after execution.
 */
 void draw_tree(cairo_t *cr, redBlackTree *tree);
 
+/**
+ * @brief Gets ready to animate an operation on the tree: remembers where the visible nodes are drawn and from which
+ * event on the event log holds the steps of the operation. Stops an animation still playing.
+ *
+ * Runs in O(v + log^2(n)) for the v nodes visible, at most ANIMATED_NODES_MAX of them.
+ *
+ * @param *tree The redBlackTree about to be changed.
+ *
+ * @returns Nothing.
+*/
+void begin_operation(redBlackTree *tree);
+
+/**
+ * @brief Plays back the operation done since begin_operation(), with a frame timer redrawing the widget.
+ *
+ * If the steps were not recorded (an operation of bulk_operations.h, or more steps than the event log keeps), the
+ * tree is just drawn again.
+ *
+ * Runs in O(k log(k)) for the k steps of the operation.
+ *
+ * @param *widget The drawing area.
+ *
+ * @returns Nothing.
+*/
+void animate_operation(GtkWidget *widget);
+
+/**
+ * @brief Stops the animation playing, if any, and frees it.
+ *
+ * Runs in O(1).
+ *
+ * @returns Nothing.
+*/
+void stop_animation(void);
+
+/**
+ * @brief Moves the view of the tree.
+ *
+ * Runs in O(1).
+ *
+ * @param dx The horizontal distance in pixels.
+ * @param dy The vertical distance in pixels.
+ *
+ * @returns Nothing.
+*/
+void pan_view(const double dx, const double dy);
+
+/**
+ * @brief Zooms the view of the tree, keeping the point under the given screen position in place.
+ *
+ * Runs in O(1).
+ *
+ * @param factor The change of scale, clamped so the zoom stays within [MIN_ZOOM, MAX_ZOOM].
+ * @param x The horizontal screen position to zoom around.
+ * @param y The vertical screen position to zoom around.
+ *
+ * @returns Nothing.
+*/
+void zoom_view(const double factor, const double x, const double y);
+
+/**
+ * @brief Goes back to the initial view, with the root at the top center at full size.
+ *
+ * Runs in O(1).
+ *
+ * @returns Nothing.
+*/
+void reset_view(void);
+
+/**
+ * @brief Stops the animation and frees the cached surface, the event log and the layout of draw_tree(), which stop
+ * observing the tree.
+ *
+ * Runs in O(n).
+ *
+ * @returns Nothing.
+*/
+void free_tree_drawing(void);
+
+/**
+ * @brief Reads a line typed into the entry, see treeCommand.
+ *
+ * Runs in O(k) for the k keys the items stand for.
+ *
+ * @param *text The line.
+ * @param *command Receives the command, whose keys are freed with free_command().
+ *
+ * @returns true if the line is a command. Otherwise an error message is printed, nothing needs freeing and false is
+ * returned.
+ */
+bool parse_command(const char *text, treeCommand *command);
+
+/**
+ * @brief Applies a command to the tree in one go, with rbInsertBatch(), rbDeleteBatch() (rbEraseRange() for a
+ * single range) or rbTreeSearchBatch().
+ *
+ * Runs in O(k log(n / k + 1)) for k keys, plus O(k log(n)) for a search.
+ *
+ * @param *tree The redBlackTree the command is applied to.
+ * @param *command The command.
+ *
+ * @returns The number of keys inserted, the number of nodes deleted, or the number of keys found.
+ */
+size_t run_command(redBlackTree *tree, const treeCommand *command);
+
+/**
+ * @brief Frees the keys of a command.
+ *
+ * Runs in O(1).
+ *
+ * @param *command The command.
+ *
+ * @returns Nothing.
+ */
+void free_command(treeCommand *command);
+
 /**
  * @brief Converts a string to an integer in a safe manner.
  *
@@ -14,15 +14,69 @@ static gboolean on_draw_event(GtkWidget *widget, cairo_t *cr, const gpointer USE
   return FALSE;
 }
 
+// where the last drag event was, so the view moves by the difference
+static double drag_x, drag_y;
+
+static gboolean on_button_press_event(GtkWidget *widget, GdkEventButton *event, const gpointer USER_DATA) {
+    if (event->type == GDK_2BUTTON_PRESS) {
+        reset_view(); // a double click goes back to the initial view
+        gtk_widget_queue_draw(widget);
+    }
+    drag_x = event->x;
+    drag_y = event->y;
+    return TRUE;
+}
+
+static gboolean on_motion_notify_event(GtkWidget *widget, GdkEventMotion *event, const gpointer USER_DATA) {
+    pan_view(event->x - drag_x, event->y - drag_y);
+    drag_x = event->x;
+    drag_y = event->y;
+    gtk_widget_queue_draw(widget);
+    return TRUE;
+}
+
+static gboolean on_scroll_event(GtkWidget *widget, GdkEventScroll *event, const gpointer USER_DATA) {
+    if (event->direction == GDK_SCROLL_UP) {
+        zoom_view(1.25, event->x, event->y);
+    } else if (event->direction == GDK_SCROLL_DOWN) {
+        zoom_view(0.8, event->x, event->y);
+    } else {
+        return FALSE;
+    }
+    gtk_widget_queue_draw(widget);
+    return TRUE;
+}
+
 static void on_entry_activate(GtkEntry *entry, const gpointer USER_DATA) {
     const gchar *text = gtk_entry_get_text(entry);
-    int input = safe_stoi(text); // convert text input to integer 
-
-    rbInsert(tree, input);
+    treeCommand command;
+    if (!parse_command(text, &command)) return; // the text stays, so it can be corrected
 
-    gtk_widget_queue_draw(drawing_area);
+    // a single key is played back step by step from the events it leaves, a batch is drawn once when it is done
+    const bool animated = (command.count == 1);
+    if (animated) {
+        begin_operation(tree);
+    }
+    const size_t done = run_command(tree, &command);
+    if (animated) {
+        animate_operation(drawing_area);
+    } else {
+        gtk_widget_queue_draw(drawing_area);
+    }
 
+    // the outcome is shown in the empty entry
+    char status[96]; // flawfinder: ignore (snprintf is protecting against buffer overflows)
+    if (command.type == COMMAND_INSERT) {
+        snprintf(status, sizeof(status), "inserted %zu keys", done);
+    } else if (command.type == COMMAND_DELETE) {
+        snprintf(status, sizeof(status), "deleted %zu nodes", done);
+    } else {
+        snprintf(status, sizeof(status), "found %zu of %zu keys", done, command.count);
+    }
     gtk_entry_set_text(entry, "");
+    gtk_entry_set_placeholder_text(entry, status);
+
+    free_command(&command);
 }
 
 int main(int argc, char* argv[])
@@ -51,6 +105,12 @@ int main(int argc, char* argv[])
 
     g_signal_connect(G_OBJECT(drawing_area), "draw", G_CALLBACK(on_draw_event), tree);
 
+    // drag with the left button to pan, scroll to zoom
+    gtk_widget_add_events(drawing_area, GDK_BUTTON_PRESS_MASK | GDK_BUTTON1_MOTION_MASK | GDK_SCROLL_MASK);
+    g_signal_connect(G_OBJECT(drawing_area), "button-press-event", G_CALLBACK(on_button_press_event), NULL);
+    g_signal_connect(G_OBJECT(drawing_area), "motion-notify-event", G_CALLBACK(on_motion_notify_event), NULL);
+    g_signal_connect(G_OBJECT(drawing_area), "scroll-event", G_CALLBACK(on_scroll_event), NULL);
+
     g_signal_connect(G_OBJECT(entry), "activate", G_CALLBACK(on_entry_activate), NULL);
     
     gtk_widget_show_all(window);
@@ -58,6 +118,7 @@ int main(int argc, char* argv[])
     // start the GTK main loop
     gtk_main();
 
+    free_tree_drawing();
     destroyTree(tree); 
     
     return 0;
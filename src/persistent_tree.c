@@ -0,0 +1,353 @@
+#include "persistent_tree.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+
+/* a change copies at most q, the sibling and two more nodes around each level of the search path, and a tree of
+*  n nodes is at most 2 * log2(n + 1) levels deep. Reserving that many nodes before a change starts means it can
+*  never run out of memory half way through.
+*/
+static size_t nodesNeeded(size_t count) {
+    size_t bits = 0;
+    for (size_t n = count + 1; n > 0; n >>= 1) {
+        bits++;
+    }
+    return 4 * (2 * bits + 2);
+}
+
+static bool reserveNodes(ptPool *pool, size_t needed) {
+    if (pool->available >= needed) {
+        return true;
+    }
+
+    size_t capacity = pool->nextSlabCapacity;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    ptSlab *slab = (ptSlab*)malloc(sizeof(ptSlab) + capacity * sizeof(ptNode));
+    if (slab == NULL) {
+        return false;
+    }
+
+    // the rest of the old newest slab goes on the free list, so only the new slab hands out fresh nodes
+    if (pool->slabs != NULL) {
+        while (pool->slabs->used < pool->slabs->capacity) {
+            ptNode *node = &pool->slabs->nodes[pool->slabs->used++];
+            node->link[0] = pool->freeList;
+            pool->freeList = node;
+        }
+    }
+
+    slab->capacity = capacity;
+    slab->used = 0;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->available += capacity;
+
+    if (capacity < RB_SLAB_MAX_NODES) {
+        pool->nextSlabCapacity = capacity * 2;
+    }
+
+    return true;
+}
+
+// only called after reserveNodes(), so it can not fail
+static ptNode *allocateNode(ptPool *pool) {
+    pool->available--;
+
+    if (pool->freeList != NULL) {
+        ptNode *node = pool->freeList;
+        pool->freeList = node->link[0];
+        return node;
+    }
+
+    return &pool->slabs->nodes[pool->slabs->used++];
+}
+
+static void freeNode(ptPool *pool, ptNode *node) {
+    node->link[0] = pool->freeList;
+    pool->freeList = node;
+    pool->available++;
+}
+
+// drops one reference to node, and everything below it that nobody else references
+static void releaseNode(ptPool *pool, ptNode *node) {
+    while (node != NULL && --node->refs == 0) {
+        ptNode *right = node->link[1];
+        releaseNode(pool, node->link[0]);
+        freeNode(pool, node);
+        node = right;
+    }
+}
+
+/* makes the node *slot points at private to the version being changed, copying it if it is shared, and returns
+*  it. slot must be a link of a node that is already private (or the version's root link).
+*/
+static ptNode *own(ptPool *pool, ptNode **slot) {
+    ptNode *node = *slot;
+
+    if (node != NULL && node->refs > 1) {
+        ptNode *copy = allocateNode(pool);
+        *copy = *node;
+        copy->refs = 1;
+        if (copy->link[0] != NULL) {
+            copy->link[0]->refs++;
+        }
+        if (copy->link[1] != NULL) {
+            copy->link[1]->refs++;
+        }
+
+        node->refs--;
+        *slot = copy;
+        node = copy;
+    }
+
+    return node;
+}
+
+persistentTree *ptInitializeTree(void) {
+    persistentTree *tree = (persistentTree*)malloc(sizeof(persistentTree));
+    ptPool *pool = (ptPool*)malloc(sizeof(ptPool));
+    if (tree == NULL || pool == NULL) {
+        fprintf(stderr, "tree was not allocated and the new tree was not created\n");
+        free(tree);
+        free(pool);
+        return NULL;
+    }
+
+    pool->slabs = NULL;
+    pool->freeList = NULL;
+    pool->available = 0;
+    pool->nextSlabCapacity = RB_SLAB_MIN_NODES;
+    pool->versions = 1;
+
+    tree->root = NULL;
+    tree->count = 0;
+    tree->pool = pool;
+
+    return tree;
+}
+
+persistentTree *ptSnapshot(const persistentTree *tree) {
+    persistentTree *snapshot = (persistentTree*)malloc(sizeof(persistentTree));
+    if (snapshot == NULL) {
+        fprintf(stderr, "snapshot was not allocated and the new version was not created\n");
+        return NULL;
+    }
+
+    *snapshot = *tree;
+    if (snapshot->root != NULL) {
+        snapshot->root->refs++;
+    }
+    snapshot->pool->versions++;
+
+    return snapshot;
+}
+
+static bool isRedNode(const ptNode *node) {
+    return node != NULL && node->color == RED;
+}
+
+// rotates root in direction dir (0 = left, 1 = right); both root and its child on the other side must be private
+static ptNode *singleRotate(ptNode *root, int dir) {
+    ptNode *save = root->link[!dir];
+
+    root->link[!dir] = save->link[dir];
+    save->link[dir] = root;
+
+    root->color = RED;
+    save->color = BLACK;
+
+    return save;
+}
+
+// rotates root's child the other way first, for the zig-zag shape; the grandchild must be private as well
+static ptNode *doubleRotate(ptNode *root, int dir) {
+    root->link[!dir] = singleRotate(root->link[!dir], !dir);
+    return singleRotate(root, dir);
+}
+
+void ptInsert(persistentTree *tree, const int data) {
+    ptPool *pool = tree->pool;
+    if (!reserveNodes(pool, nodesNeeded(tree->count))) {
+        fprintf(stderr, "The memory allocation failed. The value has not been inserted\n");
+        return;
+    }
+
+    ptNode *inserted = allocateNode(pool);
+    inserted->key = data;
+    inserted->color = RED;
+    inserted->refs = 1;
+    inserted->link[0] = NULL;
+    inserted->link[1] = NULL;
+    tree->count++;
+
+    if (tree->root == NULL) {
+        inserted->color = BLACK;
+        tree->root = inserted;
+        return;
+    }
+
+    // same walk as tdInsert(), except that every node is made private before it can be changed
+    ptNode head = {0, BLACK, 0, {NULL, NULL}};
+    ptNode *t = &head; // great grandparent
+    ptNode *g = NULL; // grandparent
+    ptNode *p = NULL; // parent
+    ptNode *q = own(pool, &tree->root); // iterator
+    int dir = 0;
+    int last = 0;
+
+    head.link[1] = q;
+
+    for (;;) {
+        if (q == NULL) {
+            q = inserted;
+            p->link[dir] = q;
+        } else if (isRedNode(q->link[0]) && isRedNode(q->link[1])) {
+            own(pool, &q->link[0])->color = BLACK;
+            own(pool, &q->link[1])->color = BLACK;
+            q->color = RED;
+        }
+
+        // q, p and g are all private, which is everything the rotations touch
+        if (isRedNode(q) && isRedNode(p)) {
+            const int dir2 = (t->link[1] == g);
+
+            if (q == p->link[last]) {
+                t->link[dir2] = singleRotate(g, !last);
+            } else {
+                t->link[dir2] = doubleRotate(g, !last);
+            }
+        }
+
+        if (q == inserted) {
+            break;
+        }
+
+        last = dir;
+        dir = (data >= q->key);
+
+        if (g != NULL) {
+            t = g;
+        }
+        g = p;
+        p = q;
+        q = own(pool, &q->link[dir]);
+    }
+
+    tree->root = head.link[1];
+    tree->root->color = BLACK;
+}
+
+bool ptDelete(persistentTree *tree, int key) {
+    // the walk below rebalances as it goes, so check first rather than copy a path for nothing
+    if (ptTreeSearch(tree, key) == NULL) {
+        return false;
+    }
+
+    ptPool *pool = tree->pool;
+    if (!reserveNodes(pool, nodesNeeded(tree->count))) {
+        fprintf(stderr, "The memory allocation failed. The value has not been deleted\n");
+        return false;
+    }
+
+    // same walk as tdDelete(), except that every node is made private before it can be changed
+    ptNode head = {0, BLACK, 0, {NULL, NULL}};
+    ptNode *q = &head; // iterator
+    ptNode *p = NULL; // parent
+    ptNode *g = NULL; // grandparent
+    ptNode *found = NULL;
+    int dir = 1;
+
+    head.link[1] = own(pool, &tree->root);
+
+    while (q->link[dir] != NULL) {
+        const int last = dir;
+
+        g = p;
+        p = q;
+        q = own(pool, &q->link[dir]);
+        dir = (q->key < key);
+
+        if (q->key == key) {
+            found = q;
+        }
+
+        if (!isRedNode(q) && !isRedNode(q->link[dir])) {
+            if (isRedNode(q->link[!dir])) {
+                own(pool, &q->link[!dir]);
+                p->link[last] = singleRotate(q, dir);
+                p = p->link[last];
+            } else {
+                ptNode *s = own(pool, &p->link[!last]); // q's sibling
+
+                if (s != NULL) {
+                    if (!isRedNode(s->link[!last]) && !isRedNode(s->link[last])) {
+                        p->color = BLACK;
+                        s->color = RED;
+                        q->color = RED;
+                    } else {
+                        const int dir2 = (g->link[1] == p);
+
+                        // the RED nephew either moves up or is recolored, so it has to be private too
+                        if (isRedNode(s->link[last])) {
+                            own(pool, &s->link[last]);
+                            g->link[dir2] = doubleRotate(p, last);
+                        } else {
+                            own(pool, &s->link[!last]);
+                            g->link[dir2] = singleRotate(p, last);
+                        }
+
+                        q->color = RED;
+                        g->link[dir2]->color = RED;
+                        g->link[dir2]->link[0]->color = BLACK;
+                        g->link[dir2]->link[1]->color = BLACK;
+                    }
+                }
+            }
+        }
+    }
+
+    // q is private and has at most one child, which keeps its reference when it moves up to p
+    found->key = q->key;
+    p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
+    freeNode(pool, q);
+    tree->count--;
+
+    tree->root = head.link[1];
+    if (tree->root != NULL) {
+        tree->root->color = BLACK;
+    }
+
+    return true;
+}
+
+const ptNode *ptTreeSearch(const persistentTree *tree, int key) {
+    const ptNode *x = tree->root;
+
+    while (x != NULL && key != x->key) {
+        const ptNode *left = x->link[0];
+        const ptNode *right = x->link[1];
+        x = (key < x->key) ? left : right;
+    }
+
+    return x;
+}
+
+void ptRelease(persistentTree *tree) {
+    ptPool *pool = tree->pool;
+
+    releaseNode(pool, tree->root);
+    free(tree);
+
+    if (--pool->versions == 0) {
+        ptSlab *slab = pool->slabs;
+        while (slab != NULL) {
+            ptSlab *next = slab->next;
+            free(slab);
+            slab = next;
+        }
+        free(pool);
+    }
+}
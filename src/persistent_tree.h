@@ -0,0 +1,122 @@
+#ifndef PERSISTENT_TREE
+#define PERSISTENT_TREE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "red_black_tree.h"
+
+/* NOTE: persistentTree is a copy-on-write Red-Black tree. A persistentTree is one version of the tree, and
+*  ptSnapshot() makes a second version that shares every node with the first in O(1). Nodes are reference counted
+*  (a node's refs is the number of links and versions pointing at it), and ptInsert() and ptDelete() copy a node
+*  before changing it whenever it is shared, so a change to one version copies O(log(n)) nodes and is never seen
+*  by the others.
+*
+*  Since nodes are shared there are no parent pointers; insertion and deletion use the same single pass top-down
+*  algorithms as topDownTree. All versions made from the same ptInitializeTree() draw their nodes from one pool,
+*  which is freed with the last of them. The versions of one tree must not be used from several threads at once.
+*/
+
+typedef struct ptNode {
+    int key;
+    Color color;
+    unsigned int refs;
+    struct ptNode *link[2]; // link[0] is the left child, link[1] the right child, NULL when absent
+} ptNode;
+
+typedef struct ptSlab {
+    struct ptSlab *next;
+    size_t capacity;
+    size_t used;
+    ptNode nodes[];
+} ptSlab;
+
+// node pool shared by all versions of a tree
+typedef struct ptPool {
+    ptSlab *slabs; // newest slab first
+    ptNode *freeList; // released nodes, linked through link[0]
+    size_t available; // nodes on the free list plus the unused nodes of the newest slab
+    size_t nextSlabCapacity;
+    size_t versions; // persistentTrees still using the pool
+} ptPool;
+
+typedef struct persistentTree {
+    ptNode *root;
+    size_t count;
+    ptPool *pool;
+} persistentTree;
+
+/**
+ * @brief Initializes an empty persistentTree with a pool of its own.
+ *
+ * Runs in O(1).
+ *
+ * @return Returns a pointer to a persistentTree struct, unless memory allocation failed in which case an error
+ * message is printed and NULL is returned.
+*/
+persistentTree *ptInitializeTree(void);
+
+/**
+ * @brief Makes a new version of the tree that shares all of its nodes.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The version being copied. Later changes to either version are not seen by the other.
+ *
+ * @return Returns a pointer to the new version, unless memory allocation failed in which case an error message
+ * is printed and NULL is returned. The new version has to be released with ptRelease().
+*/
+persistentTree *ptSnapshot(const persistentTree *tree);
+
+/**
+ * @brief Inserts a key into this version only, copying the shared nodes on the way down.
+ *
+ * Equal keys go to the right, as in rbInsert().
+ *
+ * Runs in O(log(n)), and allocates O(log(n)) nodes when the path is shared with another version.
+ *
+ * @param *tree The version the key is inserted into.
+ * @param data The key of the new node.
+ *
+ * @return Nothing. If a memory allocation fails, an error message is printed and the version is left unchanged.
+*/
+void ptInsert(persistentTree *tree, const int data);
+
+/**
+ * @brief Deletes one node with the given key from this version only, copying the shared nodes on the way down.
+ *
+ * Runs in O(log(n)), and allocates O(log(n)) nodes when the path is shared with another version.
+ *
+ * @param *tree The version the key is deleted from.
+ * @param key The key being deleted.
+ *
+ * @return Returns true if a node was deleted. Returns false if the key was not in this version, or if a memory
+ * allocation failed (after printing an error message), in which case the version is left unchanged.
+*/
+bool ptDelete(persistentTree *tree, int key);
+
+/**
+ * @brief Searches a version for the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The version being searched.
+ * @param key The key being searched for.
+ *
+ * @return Returns a node with the key, or NULL if there is none. The node may be shared with other versions and
+ * must not be changed.
+*/
+const ptNode *ptTreeSearch(const persistentTree *tree, int key);
+
+/**
+ * @brief Releases a version. Nodes no other version uses are returned to the pool, and the pool is freed with the
+ * last version.
+ *
+ * Runs in O(k), where k is the number of nodes only this version used.
+ *
+ * @param *tree The version being released.
+ *
+ * @return Nothing.
+*/
+void ptRelease(persistentTree *tree);
+
+#endif
@@ -0,0 +1,476 @@
+/* NOTE: rb_map.h generates an ordered map (a Red-Black tree whose nodes carry a key and a value) for one key
+*  type and one value type. It has no include guard on purpose: every inclusion generates another map. Define the
+*  configuration macros and then include the header, for example
+*
+*      #define RB_MAP_NAME intMap
+*      #define RB_MAP_KEY int
+*      #define RB_MAP_VALUE double
+*      #include "rb_map.h"
+*
+*  which declares the types intMap and intMapNode and the functions intMapInitialize(), intMapPut(), intMapGet(),
+*  intMapFind(), intMapRemove() and intMapDestroy(). The configuration macros are:
+*
+*      RB_MAP_NAME            prefix of every generated name (required)
+*      RB_MAP_KEY             key type (required)
+*      RB_MAP_VALUE           value type (required)
+*      RB_MAP_LESS(a, b)      true if key a orders before key b (defaults to a < b)
+*      RB_MAP_EQUAL(a, b)     true if keys a and b are the same (defaults to a == b)
+*
+*  The defaults suit any arithmetic key type. For string keys, for example, define RB_MAP_LESS(a, b) as
+*  (strcmp(a, b) < 0) and RB_MAP_EQUAL(a, b) as (strcmp(a, b) == 0).
+*
+*  All of them are undefined again at the end of the header. The generated functions are static inline, so the
+*  comparison is inlined into the search loop instead of being called through a function pointer. The algorithms
+*  are the ones of red_black_tree.c (without subtree sizes), with keys unique as in any map, and the nodes come
+*  from the same kind of slab pool.
+*/
+
+#if !defined(RB_MAP_NAME) || !defined(RB_MAP_KEY) || !defined(RB_MAP_VALUE)
+#error "define RB_MAP_NAME, RB_MAP_KEY and RB_MAP_VALUE before including rb_map.h"
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "red_black_tree.h"
+
+/* two predicates rather than one three-way comparison: with a three-way result the compiler branches on its sign,
+*  while a plain < lets the choice of child compile to a conditional move, as it does in rbTreeSearch()
+*/
+#ifndef RB_MAP_LESS
+#define RB_MAP_LESS(a, b) ((a) < (b))
+#endif
+#ifndef RB_MAP_EQUAL
+#define RB_MAP_EQUAL(a, b) ((a) == (b))
+#endif
+
+// two levels so that RB_MAP_NAME is expanded before it is pasted
+#define RB_MAP_PASTE(prefix, suffix) prefix##suffix
+#define RB_MAP_EXPAND(prefix, suffix) RB_MAP_PASTE(prefix, suffix)
+#define RB_MAP_FN(suffix) RB_MAP_EXPAND(RB_MAP_NAME, suffix)
+
+#define RB_MAP_NODE RB_MAP_FN(Node)
+#define RB_MAP_SLAB RB_MAP_FN(Slab)
+
+// the key and both children come first, so a search only touches the first bytes of each node (for int keys the
+// same 24 bytes as in a treeNode)
+typedef struct RB_MAP_NODE {
+    RB_MAP_KEY key;
+    Color color;
+    struct RB_MAP_NODE *left;
+    struct RB_MAP_NODE *right;
+    struct RB_MAP_NODE *parent;
+    RB_MAP_VALUE value;
+} RB_MAP_NODE;
+
+typedef struct RB_MAP_SLAB {
+    struct RB_MAP_SLAB *next;
+    size_t capacity;
+    size_t used;
+    RB_MAP_NODE nodes[];
+} RB_MAP_SLAB;
+
+typedef struct RB_MAP_NAME {
+    RB_MAP_NODE *root;
+    RB_MAP_NODE *nil;
+    size_t count;
+    RB_MAP_SLAB *slabs; // newest slab first
+    RB_MAP_NODE *freeList; // nodes released by Remove(), linked through parent
+    size_t nextSlabCapacity;
+    RB_MAP_NODE sentinel; // what nil points at
+} RB_MAP_NAME;
+
+// same slab scheme as rbAllocateNode()
+static inline RB_MAP_NODE *RB_MAP_FN(AllocateNode)(RB_MAP_NAME *map) {
+    if (map->freeList != NULL) {
+        RB_MAP_NODE *node = map->freeList;
+        map->freeList = node->parent;
+        return node;
+    }
+
+    if (map->slabs == NULL || map->slabs->used == map->slabs->capacity) {
+        const size_t capacity = map->nextSlabCapacity;
+        RB_MAP_SLAB *slab = (RB_MAP_SLAB*)malloc(sizeof(RB_MAP_SLAB) + capacity * sizeof(RB_MAP_NODE));
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->capacity = capacity;
+        slab->used = 0;
+        slab->next = map->slabs;
+        map->slabs = slab;
+
+        if (capacity < RB_SLAB_MAX_NODES) {
+            map->nextSlabCapacity = capacity * 2;
+        }
+    }
+
+    return &map->slabs->nodes[map->slabs->used++];
+}
+
+/**
+ * @brief Initializes an empty map.
+ *
+ * Runs in O(1).
+ *
+ * @return Returns a pointer to the map, unless memory allocation failed in which case an error message is printed
+ * and NULL is returned.
+*/
+static inline RB_MAP_NAME *RB_MAP_FN(Initialize)(void) {
+    RB_MAP_NAME *map = (RB_MAP_NAME*)malloc(sizeof(RB_MAP_NAME));
+    if (map == NULL) {
+        fprintf(stderr, "map was not allocated and the new map was not created\n");
+        return NULL;
+    }
+
+    map->nil = &map->sentinel;
+    map->nil->color = BLACK;
+    map->nil->left = map->nil;
+    map->nil->right = map->nil;
+    map->nil->parent = map->nil;
+    map->root = map->nil;
+    map->count = 0;
+    map->slabs = NULL;
+    map->freeList = NULL;
+    map->nextSlabCapacity = RB_SLAB_MIN_NODES;
+
+    return map;
+}
+
+/**
+ * @brief Searches the map for the node with the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *map The map being searched.
+ * @param key The key being searched for.
+ *
+ * @return Returns the node with the key, or map->nil if there is none.
+*/
+static inline RB_MAP_NODE *RB_MAP_FN(Find)(const RB_MAP_NAME *map, RB_MAP_KEY key) {
+    RB_MAP_NODE *x = map->root;
+
+    while (x != map->nil && !RB_MAP_EQUAL(key, x->key)) {
+        if (RB_MAP_LESS(key, x->key)) {
+            x = x->left;
+        } else {
+            x = x->right;
+        }
+    }
+
+    return x;
+}
+
+/**
+ * @brief Finds the value stored under the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *map The map being searched.
+ * @param key The key being searched for.
+ *
+ * @return Returns a pointer to the value, which stays valid until the key is removed, or NULL if the key is not
+ * in the map.
+*/
+static inline RB_MAP_VALUE *RB_MAP_FN(Get)(const RB_MAP_NAME *map, RB_MAP_KEY key) {
+    RB_MAP_NODE *node = RB_MAP_FN(Find)(map, key);
+    return (node != map->nil) ? &node->value : NULL;
+}
+
+static inline void RB_MAP_FN(LeftRotate)(RB_MAP_NAME *map, RB_MAP_NODE *x) {
+    RB_MAP_NODE *y = x->right;
+
+    x->right = y->left;
+    if (y->left != map->nil) {
+        y->left->parent = x;
+    }
+
+    y->parent = x->parent;
+    if (x->parent == map->nil) {
+        map->root = y;
+    } else if (x == x->parent->left) {
+        x->parent->left = y;
+    } else {
+        x->parent->right = y;
+    }
+
+    y->left = x;
+    x->parent = y;
+}
+
+static inline void RB_MAP_FN(RightRotate)(RB_MAP_NAME *map, RB_MAP_NODE *x) {
+    RB_MAP_NODE *y = x->left;
+
+    x->left = y->right;
+    if (y->right != map->nil) {
+        y->right->parent = x;
+    }
+
+    y->parent = x->parent;
+    if (x->parent == map->nil) {
+        map->root = y;
+    } else if (x == x->parent->right) {
+        x->parent->right = y;
+    } else {
+        x->parent->left = y;
+    }
+
+    y->right = x;
+    x->parent = y;
+}
+
+// rbInsertFixup()
+static inline void RB_MAP_FN(InsertFixup)(RB_MAP_NAME *map, RB_MAP_NODE *z) {
+    while (z->parent->color == RED) {
+        if (z->parent == z->parent->parent->left) {
+            RB_MAP_NODE *y = z->parent->parent->right;
+
+            if (y->color == RED) {
+                z->parent->color = BLACK;
+                y->color = BLACK;
+                z->parent->parent->color = RED;
+                z = z->parent->parent;
+            } else {
+                if (z == z->parent->right) {
+                    z = z->parent;
+                    RB_MAP_FN(LeftRotate)(map, z);
+                }
+                z->parent->color = BLACK;
+                z->parent->parent->color = RED;
+                RB_MAP_FN(RightRotate)(map, z->parent->parent);
+            }
+        } else {
+            RB_MAP_NODE *y = z->parent->parent->left;
+
+            if (y->color == RED) {
+                z->parent->color = BLACK;
+                y->color = BLACK;
+                z->parent->parent->color = RED;
+                z = z->parent->parent;
+            } else {
+                if (z == z->parent->left) {
+                    z = z->parent;
+                    RB_MAP_FN(RightRotate)(map, z);
+                }
+                z->parent->color = BLACK;
+                z->parent->parent->color = RED;
+                RB_MAP_FN(LeftRotate)(map, z->parent->parent);
+            }
+        }
+    }
+    map->root->color = BLACK;
+}
+
+/**
+ * @brief Stores a value under a key, replacing the value already stored under it if there is one.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *map The map being changed.
+ * @param key The key.
+ * @param value The value stored under the key.
+ *
+ * @return Returns true if the key was new, false if an existing value was replaced or a memory allocation failed
+ * (in which case an error message is printed and the map is unchanged).
+*/
+static inline bool RB_MAP_FN(Put)(RB_MAP_NAME *map, RB_MAP_KEY key, RB_MAP_VALUE value) {
+    RB_MAP_NODE *x = map->root;
+    RB_MAP_NODE *y = map->nil;
+    bool less = false;
+
+    while (x != map->nil) {
+        if (RB_MAP_EQUAL(key, x->key)) {
+            x->value = value;
+            return false;
+        }
+        y = x;
+        less = RB_MAP_LESS(key, x->key);
+        x = less ? x->left : x->right;
+    }
+
+    RB_MAP_NODE *z = RB_MAP_FN(AllocateNode)(map);
+    if (z == NULL) {
+        fprintf(stderr, "The memory allocation failed. The value has not been inserted\n");
+        return false;
+    }
+
+    z->key = key;
+    z->value = value;
+    z->color = RED;
+    z->left = map->nil;
+    z->right = map->nil;
+    z->parent = y;
+
+    if (y == map->nil) {
+        map->root = z;
+    } else if (less) {
+        y->left = z;
+    } else {
+        y->right = z;
+    }
+    map->count++;
+
+    RB_MAP_FN(InsertFixup)(map, z);
+    return true;
+}
+
+static inline void RB_MAP_FN(Transplant)(RB_MAP_NAME *map, RB_MAP_NODE *u, RB_MAP_NODE *v) {
+    if (u->parent == map->nil) {
+        map->root = v;
+    } else if (u == u->parent->left) {
+        u->parent->left = v;
+    } else {
+        u->parent->right = v;
+    }
+
+    v->parent = u->parent;
+}
+
+// rbDeleteFixup()
+static inline void RB_MAP_FN(DeleteFixup)(RB_MAP_NAME *map, RB_MAP_NODE *x) {
+    while (x != map->root && x->color == BLACK) {
+        if (x == x->parent->left) {
+            RB_MAP_NODE *w = x->parent->right;
+
+            if (w->color == RED) {
+                w->color = BLACK;
+                x->parent->color = RED;
+                RB_MAP_FN(LeftRotate)(map, x->parent);
+                w = x->parent->right;
+            }
+
+            if (w->left->color == BLACK && w->right->color == BLACK) {
+                w->color = RED;
+                x = x->parent;
+            } else {
+                if (w->right->color == BLACK) {
+                    w->left->color = BLACK;
+                    w->color = RED;
+                    RB_MAP_FN(RightRotate)(map, w);
+                    w = x->parent->right;
+                }
+                w->color = x->parent->color;
+                x->parent->color = BLACK;
+                w->right->color = BLACK;
+                RB_MAP_FN(LeftRotate)(map, x->parent);
+                x = map->root;
+            }
+        } else {
+            RB_MAP_NODE *w = x->parent->left;
+
+            if (w->color == RED) {
+                w->color = BLACK;
+                x->parent->color = RED;
+                RB_MAP_FN(RightRotate)(map, x->parent);
+                w = x->parent->left;
+            }
+
+            if (w->right->color == BLACK && w->left->color == BLACK) {
+                w->color = RED;
+                x = x->parent;
+            } else {
+                if (w->left->color == BLACK) {
+                    w->right->color = BLACK;
+                    w->color = RED;
+                    RB_MAP_FN(LeftRotate)(map, w);
+                    w = x->parent->left;
+                }
+                w->color = x->parent->color;
+                x->parent->color = BLACK;
+                w->left->color = BLACK;
+                RB_MAP_FN(RightRotate)(map, x->parent);
+                x = map->root;
+            }
+        }
+    }
+    x->color = BLACK;
+}
+
+/**
+ * @brief Removes a key and its value from the map.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *map The map being changed.
+ * @param key The key being removed.
+ *
+ * @return Returns true if the key was removed, false if it was not in the map.
+*/
+static inline bool RB_MAP_FN(Remove)(RB_MAP_NAME *map, RB_MAP_KEY key) {
+    RB_MAP_NODE *z = RB_MAP_FN(Find)(map, key);
+    if (z == map->nil) {
+        return false;
+    }
+
+    RB_MAP_NODE *y = z;
+    Color yOriginalColor = y->color;
+    RB_MAP_NODE *x;
+
+    if (z->left == map->nil) {
+        x = z->right;
+        RB_MAP_FN(Transplant)(map, z, z->right);
+    } else if (z->right == map->nil) {
+        x = z->left;
+        RB_MAP_FN(Transplant)(map, z, z->left);
+    } else {
+        y = z->right;
+        while (y->left != map->nil) {
+            y = y->left;
+        }
+        yOriginalColor = y->color;
+        x = y->right;
+        if (y != z->right) {
+            RB_MAP_FN(Transplant)(map, y, y->right);
+            y->right = z->right;
+            y->right->parent = y;
+        } else {
+            x->parent = y;
+        }
+        RB_MAP_FN(Transplant)(map, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->color = z->color;
+    }
+
+    if (yOriginalColor == BLACK) {
+        RB_MAP_FN(DeleteFixup)(map, x);
+    }
+
+    z->parent = map->freeList;
+    map->freeList = z;
+    map->count--;
+
+    return true;
+}
+
+/**
+ * @brief Frees the map and all of its nodes.
+ *
+ * Runs in O(s), where s is the number of slabs.
+ *
+ * @param *map The map being freed.
+ *
+ * @return Nothing.
+*/
+static inline void RB_MAP_FN(Destroy)(RB_MAP_NAME *map) {
+    RB_MAP_SLAB *slab = map->slabs;
+    while (slab != NULL) {
+        RB_MAP_SLAB *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    free(map);
+}
+
+#undef RB_MAP_NODE
+#undef RB_MAP_SLAB
+#undef RB_MAP_FN
+#undef RB_MAP_EXPAND
+#undef RB_MAP_PASTE
+#undef RB_MAP_EQUAL
+#undef RB_MAP_LESS
+#undef RB_MAP_VALUE
+#undef RB_MAP_KEY
+#undef RB_MAP_NAME
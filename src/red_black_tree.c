@@ -1,8 +1,32 @@
 #include "red_black_tree.h"
-#include "gtkBackend.h"
 
 #include "stdlib.h"
 #include "stdio.h"
+#include "stdint.h"
+#include "string.h"
+
+// counting compiles to nothing unless RB_ENABLE_STATS is defined
+#ifdef RB_ENABLE_STATS
+#define RB_STAT(tree, counter) ((tree)->stats.counter++)
+#define RB_STAT_ADD(tree, counter, amount) ((tree)->stats.counter += (amount))
+#else
+#define RB_STAT(tree, counter) ((void)(tree))
+#define RB_STAT_ADD(tree, counter, amount) ((void)(tree), (void)(amount))
+#endif
+
+// tells the observer of the tree about a change, if there is one
+#define RB_NOTIFY(tree, event, node) \
+    do { \
+        if ((tree)->observer != NULL) { \
+            (tree)->observer((tree)->observerContext, (event), (node)); \
+        } \
+    } while (0)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RB_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define RB_PREFETCH(address) ((void)(address))
+#endif
 
 redBlackTree* initializeTree() {
     redBlackTree *tree = (redBlackTree*)malloc(sizeof(redBlackTree));
@@ -12,26 +36,289 @@ redBlackTree* initializeTree() {
         return NULL;
     }
     
-    treeNode *sentinel = (treeNode*)malloc(sizeof(treeNode));
-    if (sentinel == NULL) {
+    // the pool holds the sentinel, so one allocation covers both
+    nodePool *pool = (nodePool*)malloc(sizeof(nodePool));
+    if (pool == NULL) {
         fprintf(stderr, "sentinel was not allocated and the new tree was not created\n");
         free(tree);
         return NULL;
     }
 
+    treeNode *sentinel = &pool->sentinel;
     sentinel->color = BLACK; // the sentinel is black by convention
     sentinel->left = sentinel;
     sentinel->right = sentinel;
     sentinel->parent = sentinel;
     sentinel->key = -1; // placeholder value, we should never be checking the sentinel's key anyways
+    sentinel->subtreeSize = 0; // lets size bookkeeping treat missing children uniformly
 
     tree->nil = sentinel;
     tree->root = sentinel; // in an empty tree, the root points to the sentinel
 
+    pool->slabs = NULL; // the first slab is allocated by the first insertion
+    pool->freeList = NULL;
+    pool->nextSlabCapacity = RB_SLAB_MIN_NODES;
+    pool->trees = 1;
+    tree->pool = pool;
+    tree->blackHeight = 0;
+    tree->modifications = 0;
+    tree->observer = NULL;
+    tree->observerContext = NULL;
+
+    rbResetStats(tree);
+
     return tree;
 }
 
+redBlackTree *initializeSharedTree(redBlackTree *tree) {
+    redBlackTree *shared = (redBlackTree*)malloc(sizeof(redBlackTree));
+    if (shared == NULL) {
+        fprintf(stderr, "tree was not allocated and the new tree was not created\n");
+        return NULL;
+    }
+
+    shared->nil = tree->nil;
+    shared->root = tree->nil;
+    shared->pool = tree->pool;
+    shared->pool->trees++;
+    shared->blackHeight = 0;
+    shared->modifications = 0;
+    shared->observer = NULL;
+    shared->observerContext = NULL;
+
+    rbResetStats(shared);
+
+    return shared;
+}
+
+#ifdef RB_MALLOC_NODES
+// points every nil link of the subtree at nil instead, for moving it between pools
+static void relinkSentinel(redBlackTree *tree, treeNode *node, treeNode *nil) {
+    while (node != tree->nil) {
+        treeNode *right = node->right;
+
+        if (node->left == tree->nil) {
+            node->left = nil;
+        } else {
+            relinkSentinel(tree, node->left, nil);
+        }
+        node->right = (right == tree->nil) ? nil : right;
+
+        node = right; // the right spine is followed in a loop, so only left children add to the recursion depth
+    }
+}
+#endif
+
+// copies the subtree into tree's pool below parent, returning its copy or NULL (with nothing left behind)
+static treeNode *copySubtree(redBlackTree *tree, const redBlackTree *other, const treeNode *node, treeNode *parent) {
+    if (node == other->nil) {
+        return tree->nil;
+    }
+
+    treeNode *copy = rbAllocateNode(tree);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->key = node->key;
+    copy->color = node->color;
+    copy->subtreeSize = node->subtreeSize;
+    copy->parent = parent;
+
+    copy->left = copySubtree(tree, other, node->left, copy);
+    copy->right = (copy->left == NULL) ? NULL : copySubtree(tree, other, node->right, copy);
+    if (copy->right == NULL) {
+        if (copy->left != NULL) {
+            destroyTreeHelper(tree, copy->left);
+        }
+        rbReleaseNode(tree, copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+// moves the nodes of other, the only tree of its pool, into tree's pool and frees the emptied pool
+static void adoptPool(redBlackTree *tree, redBlackTree *other) {
+    nodePool *pool = tree->pool;
+    nodePool *adopted = other->pool;
+
+#ifdef RB_MALLOC_NODES
+    relinkSentinel(other, other->root, tree->nil);
+#else
+    // a sequential pass over the slabs is much cheaper than a walk of the tree, and released nodes do no harm
+    for (nodeSlab *slab = adopted->slabs; slab != NULL; slab = slab->next) {
+        for (size_t i = 0; i < slab->used; i++) {
+            treeNode *node = &slab->nodes[i];
+            node->left = (node->left == other->nil) ? tree->nil : node->left;
+            node->right = (node->right == other->nil) ? tree->nil : node->right;
+        }
+    }
+#endif
+    if (other->root != other->nil) {
+        other->root->parent = tree->nil;
+    } else {
+        other->root = tree->nil;
+    }
+
+    // slabs are only freed as a whole, so their order does not matter beyond keeping the partially used one first
+    if (adopted->slabs != NULL) {
+        nodeSlab *last = adopted->slabs;
+        while (last->next != NULL) {
+            last = last->next;
+        }
+        if (pool->slabs != NULL) {
+            last->next = pool->slabs->next;
+            pool->slabs->next = adopted->slabs;
+        } else {
+            pool->slabs = adopted->slabs;
+        }
+    }
+
+    if (adopted->freeList != NULL) {
+        treeNode *last = adopted->freeList;
+        while (last->parent != NULL) {
+            last = last->parent;
+        }
+        last->parent = pool->freeList;
+        pool->freeList = adopted->freeList;
+    }
+
+    if (adopted->nextSlabCapacity > pool->nextSlabCapacity) {
+        pool->nextSlabCapacity = adopted->nextSlabCapacity;
+    }
+
+    free(adopted);
+    other->pool = pool;
+    other->nil = tree->nil;
+    pool->trees++;
+}
+
+bool rbSharePool(redBlackTree *tree, redBlackTree *other) {
+    if (tree->pool == other->pool) {
+        return true;
+    }
+
+    // rewiring the smaller tree is cheaper, but only a tree that is alone in its pool can take its slabs along
+    if (other->pool->trees == 1 && (tree->pool->trees > 1 || other->root->subtreeSize <= tree->root->subtreeSize)) {
+        adoptPool(tree, other);
+        return true;
+    }
+    if (tree->pool->trees == 1) {
+        adoptPool(other, tree);
+        return true;
+    }
+
+    treeNode *copy = copySubtree(tree, other, other->root, tree->nil);
+    if (copy == NULL) {
+        fprintf(stderr, "The memory allocation failed. The trees do not share a node pool\n");
+        return false;
+    }
+
+    destroyTreeHelper(other, other->root);
+    other->pool->trees--;
+    other->pool = tree->pool;
+    other->nil = tree->nil;
+    other->root = copy;
+    tree->pool->trees++;
+    RB_NOTIFY(other, RB_TREE_RESET, NULL);
+
+    return true;
+}
+
+void rbSetObserver(redBlackTree *tree, rbObserver observer, void *context) {
+    tree->observer = observer;
+    tree->observerContext = context;
+}
+
+treeNode *rbAllocateNode(redBlackTree *tree) {
+#ifdef RB_MALLOC_NODES
+    (void)tree;
+    return (treeNode*)malloc(sizeof(treeNode));
+#else
+    nodePool *pool = tree->pool;
+
+    // reuse a node released by rbDelete() before touching fresh memory
+    if (pool->freeList != NULL) {
+        treeNode *node = pool->freeList;
+        pool->freeList = node->parent;
+        return node;
+    }
+
+    // the newest slab is full (or there is none yet), so allocate a bigger one
+    if (pool->slabs == NULL || pool->slabs->used == pool->slabs->capacity) {
+        // zeroed, so a lock-free reader of concurrent_tree.c that races ahead of rbInsert() sees NULL links
+        const size_t capacity = pool->nextSlabCapacity;
+        nodeSlab *slab = (nodeSlab*)calloc(1, sizeof(nodeSlab) + capacity * sizeof(treeNode));
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->capacity = capacity;
+        slab->used = 0;
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+
+        if (capacity < RB_SLAB_MAX_NODES) {
+            pool->nextSlabCapacity = capacity * 2;
+        }
+    }
+
+    return &pool->slabs->nodes[pool->slabs->used++];
+#endif
+}
+
+// hands out count contiguous nodes as a slab of their own, for rbBuildFromSorted()
+static treeNode *allocateNodeBlock(redBlackTree *tree, size_t count) {
+#ifdef RB_MALLOC_NODES
+    (void)tree;
+    (void)count;
+    return NULL; // without the pool every node is allocated on its own
+#else
+    if (count > (SIZE_MAX - sizeof(nodeSlab)) / sizeof(treeNode)) {
+        return NULL;
+    }
+
+    nodeSlab *slab = (nodeSlab*)malloc(sizeof(nodeSlab) + count * sizeof(treeNode));
+    if (slab == NULL) {
+        return NULL;
+    }
+    slab->capacity = count;
+    slab->used = count;
+
+    // the block is full from the start, so keep any partially used slab at the head for rbAllocateNode()
+    if (tree->pool->slabs != NULL) {
+        slab->next = tree->pool->slabs->next;
+        tree->pool->slabs->next = slab;
+    } else {
+        slab->next = NULL;
+        tree->pool->slabs = slab;
+    }
+
+    return slab->nodes;
+#endif
+}
+
+void rbReleaseNode(redBlackTree *tree, treeNode *node) {
+    RB_NOTIFY(tree, RB_NODE_RELEASED, node);
+#ifdef RB_MALLOC_NODES
+    free(node);
+#else
+    node->parent = tree->pool->freeList;
+    tree->pool->freeList = node;
+#endif
+}
+
+// paints a node for the fixups, telling the observer if the color changed
+static inline void recolor(redBlackTree *tree, treeNode *node, Color color) {
+    if (node->color != color) {
+        node->color = color;
+        RB_NOTIFY(tree, RB_NODE_RECOLORED, node);
+    }
+}
+
 void leftRotate(redBlackTree *tree, treeNode *x) {
+    RB_STAT(tree, leftRotations);
     treeNode *y = x->right;
     x->right = y->left; // turn y's left subtree into x's right subtree
 
@@ -53,9 +340,15 @@ void leftRotate(redBlackTree *tree, treeNode *x) {
     
     y->left = x; // make x y's left child
     x->parent = y;
+
+    // y now roots the subtree x used to root, and x lost y's right subtree
+    y->subtreeSize = x->subtreeSize;
+    x->subtreeSize = x->left->subtreeSize + x->right->subtreeSize + 1;
+    RB_NOTIFY(tree, RB_ROTATED_LEFT, x); // x is y's child now, so this covers y as well
 }
 
 void rightRotate(redBlackTree *tree, treeNode *x) {
+    RB_STAT(tree, rightRotations);
     treeNode *y = x->left;
     x->left = y->right; // turn y's right subtree into x's right subtree
 
@@ -76,6 +369,11 @@ void rightRotate(redBlackTree *tree, treeNode *x) {
     
     y->right = x; // make x y's left child
     x->parent = y;
+
+    // y now roots the subtree x used to root, and x lost y's left subtree
+    y->subtreeSize = x->subtreeSize;
+    x->subtreeSize = x->left->subtreeSize + x->right->subtreeSize + 1;
+    RB_NOTIFY(tree, RB_ROTATED_RIGHT, x); // x is y's child now, so this covers y as well
 }
 
 void rbInsert(redBlackTree* tree, const int data) {
@@ -85,25 +383,29 @@ void rbInsert(redBlackTree* tree, const int data) {
     *  just creating a new node inside this function. 
     */
 
-    treeNode *z = (treeNode*)malloc(sizeof(treeNode));
+    treeNode *z = rbAllocateNode(tree);
     // handle memory allocation failure
     if (z == NULL) {
         fprintf(stderr, "The memory allocation failed. The value has not been inserted\n");
         return;
     }
+    tree->modifications++;
     
     z->key = data;
     z->color = RED;
     z->parent = tree->nil;
     z->right = tree->nil;
     z->left = tree->nil;
+    z->subtreeSize = 1;
 
     treeNode *x = tree->root; // node being compared with z
     treeNode *y = tree->nil; // y will be parent of z
 
-    // descend until reaching the sentinel
+    // descend until reaching the sentinel, every node passed gains z as a descendant
     while (x != tree->nil) {
+        RB_NOTIFY(tree, RB_NODE_COMPARED, x);
         y = x;
+        x->subtreeSize++;
         if (z->key < x->key) {
             x = x->left;
         } else {
@@ -124,14 +426,15 @@ void rbInsert(redBlackTree* tree, const int data) {
     z->left = tree->nil; // both of z's children are the sentinel
     z->right = tree->nil;
     z->color = RED;
+    RB_NOTIFY(tree, RB_NODE_LINKED, z);
 
     rbInsertFixup(tree, z);   
-
-    gtk_widget_queue_draw(drawing_area);
 }
 
-void rbInsertFixup(redBlackTree *tree, treeNode *z) {
+bool rbInsertFixup(redBlackTree *tree, treeNode *z) {
     while (z->parent->color == RED) {
+        RB_STAT(tree, insertFixupIterations);
+
         // if z's parent is a left child
         if (z->parent == z->parent->parent->left) {
             treeNode* y = z->parent->parent->right; // y is z's uncle
@@ -139,42 +442,51 @@ void rbInsertFixup(redBlackTree *tree, treeNode *z) {
             // if z's parent and uncle are both red
             if (y->color == RED) {
                 // case 1
-                z->parent->color = BLACK;
-                y->color = BLACK;
-                z->parent->parent->color = RED;
+                RB_STAT(tree, insertCases[0]);
+                recolor(tree, z->parent, BLACK);
+                recolor(tree, y, BLACK);
+                recolor(tree, z->parent->parent, RED);
                 z = z->parent->parent;
             } else {
                 if (z == z->parent->right) {
                     // case 2
+                    RB_STAT(tree, insertCases[1]);
                     z = z->parent;
                     leftRotate(tree, z);
                 }
                 
                 // case 3
-                z->parent->color = BLACK;
-                z->parent->parent->color = RED;
+                RB_STAT(tree, insertCases[2]);
+                recolor(tree, z->parent, BLACK);
+                recolor(tree, z->parent->parent, RED);
                 rightRotate(tree, z->parent->parent);
             }   
         } else { 
             treeNode *y = z->parent->parent->left;
 
             if (y->color == RED) {
-                z->parent->color = BLACK;
-                y->color = BLACK;
-                z->parent->parent->color = RED;
+                RB_STAT(tree, insertCases[0]);
+                recolor(tree, z->parent, BLACK);
+                recolor(tree, y, BLACK);
+                recolor(tree, z->parent->parent, RED);
                 z = z->parent->parent;
             } else {
                 if (z == z->parent->left) {
+                    RB_STAT(tree, insertCases[1]);
                     z = z->parent;
                     rightRotate(tree, z);
                 }
-                z->parent->color = BLACK;
-                z->parent->parent->color = RED;
+                RB_STAT(tree, insertCases[2]);
+                recolor(tree, z->parent, BLACK);
+                recolor(tree, z->parent->parent, RED);
                 leftRotate(tree, z->parent->parent);
             }
         }
     }
-    tree->root->color = BLACK;
+    const bool grew = (tree->root->color == RED);
+    recolor(tree, tree->root, BLACK);
+    tree->blackHeight += grew;
+    return grew;
 }
 
 treeNode *rbMaximum(const redBlackTree *tree, treeNode *node)
@@ -202,13 +514,24 @@ void rbTransplant(redBlackTree *tree, treeNode *u, treeNode *v) {
     }
     
     v->parent = u->parent;
+    RB_NOTIFY(tree, RB_TRANSPLANTED, u); // u still points at the parent whose link changed
 }
 
 void rbDelete(redBlackTree *tree, treeNode *z) {
-    int zOriginalKey = z->key;
     treeNode *y = z;
     Color yOriginalColor = y->color;
     treeNode *x;
+    tree->modifications++;
+
+    // the position that disappears is z's, or its successor's if z has two children;
+    // every ancestor of that position loses one descendant
+    treeNode *vacated = z;
+    if (z->left != tree->nil && z->right != tree->nil) {
+        vacated = rbMinimum(tree, z->right);
+    }
+    for (treeNode *ancestor = vacated->parent; ancestor != tree->nil; ancestor = ancestor->parent) {
+        ancestor->subtreeSize--;
+    }
 
     if (z->left == tree->nil) {
         x = z->right;
@@ -217,7 +540,7 @@ void rbDelete(redBlackTree *tree, treeNode *z) {
         x = z->left;
         rbTransplant(tree, z, z->left); // replace z by its left child
     } else {
-        y = rbMinimum(tree, z->right); // y is z's successor
+        y = vacated; // y is z's successor
         yOriginalColor = y->color;
         x = y->right;
         // if y is farther down the tree
@@ -231,7 +554,9 @@ void rbDelete(redBlackTree *tree, treeNode *z) {
         rbTransplant(tree, z, y); // replace z by its successor y
         y->left = z->left; // give z's left child to y, which had no left child
         y->left->parent = y;
-        y->color = z->color;
+        recolor(tree, y, z->color);
+        y->subtreeSize = z->subtreeSize;
+        RB_NOTIFY(tree, RB_NODE_LINKED, y);
     }
     
     // correct vilations if they occured
@@ -239,48 +564,52 @@ void rbDelete(redBlackTree *tree, treeNode *z) {
         rbDeleteFixup(tree, x);
     }
 
-    // prevent memory leak
-    // the node to be discarded could be different from z in certain scenarios
-    // based on rotations
-    if (z->key == zOriginalKey) {
-        free(z);
-    } else if (y->key == zOriginalKey) {
-        free(y);
-    } else if (x->key == zOriginalKey ) {
-        free(x);
-    }
+    // z has been unlinked (its successor y took its place, not its key), so it can be recycled
+    rbReleaseNode(tree, z);
 }
 
-void rbDeleteFixup(redBlackTree *tree, treeNode *x) {
+bool rbDeleteFixup(redBlackTree *tree, treeNode *x) {
+    // x carries an extra BLACK. If it reaches the root (or starts there), the root just drops it, which is the
+    // only way the black height of the tree shrinks
+    bool shrank = (x == tree->root && x->color == BLACK);
+
     while (x != tree->root && x->color == BLACK) {
+        RB_STAT(tree, deleteFixupIterations);
+
         // if x is a left child
         if (x == x->parent->left) {
             treeNode *w = x->parent->right; // w is x's sibling
 
             // case 1
             if (w->color == RED) {
-                w->color = BLACK;
-                x->parent->color = RED;
+                RB_STAT(tree, deleteCases[0]);
+                recolor(tree, w, BLACK);
+                recolor(tree, x->parent, RED);
                 leftRotate(tree, x->parent);
                 w = x->parent->right;
             }
 
             // case 2
             if (w->left->color == BLACK && w->right->color == BLACK) {
-                w->color = RED;
+                RB_STAT(tree, deleteCases[1]);
+                recolor(tree, w, RED);
                 x = x->parent;
+                shrank = (x == tree->root);
             } else {
                 // case 3
                 if (w->right->color == BLACK) {
-                    w->left->color = BLACK;
-                    w->color = RED;
+                    RB_STAT(tree, deleteCases[2]);
+                    recolor(tree, w->left, BLACK);
+                    recolor(tree, w, RED);
                     rightRotate(tree, w);
                     w = x->parent->right;
                 }
                 
                 // case 4
-                w->color = x->parent->color;
-                x->parent->color = BLACK;
+                RB_STAT(tree, deleteCases[3]);
+                recolor(tree, w, x->parent->color);
+                recolor(tree, x->parent, BLACK);
+                recolor(tree, w->right, BLACK);
                 leftRotate(tree, x->parent);
                 x = tree->root;
             }
@@ -288,53 +617,87 @@ void rbDeleteFixup(redBlackTree *tree, treeNode *x) {
             treeNode *w = x->parent->left;
 
             if (w->color == RED) {
-                w->color = BLACK;
-                x->parent->color = RED;
+                RB_STAT(tree, deleteCases[0]);
+                recolor(tree, w, BLACK);
+                recolor(tree, x->parent, RED);
                 rightRotate(tree, x->parent);
                 w = x->parent->left;
             }
 
             if (w->right->color == BLACK && w->left->color == BLACK)
             {
-                w->color = RED;
+                RB_STAT(tree, deleteCases[1]);
+                recolor(tree, w, RED);
                 x = x->parent;
+                shrank = (x == tree->root);
             } else {
                 if (w->left->color == BLACK) {
-                    w->right->color = BLACK;
-                    w->color = RED;
+                    RB_STAT(tree, deleteCases[2]);
+                    recolor(tree, w->right, BLACK);
+                    recolor(tree, w, RED);
                     leftRotate(tree, w);
                     w = x->parent->left;
                 }
 
-                w->color = x->parent->color;
-                x->parent->color = BLACK;
-                w->left->color = BLACK;
+                RB_STAT(tree, deleteCases[3]);
+                recolor(tree, w, x->parent->color);
+                recolor(tree, x->parent, BLACK);
+                recolor(tree, w->left, BLACK);
                 rightRotate(tree, x->parent);
                 x = tree->root;
             }
         }
     }
-    x->color = BLACK;
+    recolor(tree, x, BLACK);
+
+    tree->blackHeight -= shrank;
+    return shrank;
 }
 
-void destroyTreeHelper(treeNode *node, treeNode *nil) {
-    // base case
-    if (node == nil) {
-        return;
+void destroyTreeHelper(redBlackTree *tree, treeNode *node) {
+    /* the subtree is detached, so its shape no longer matters. Rotating every left child up until the node has
+    *  none turns the subtree into a right spine that is released from the top, without recursion or a stack
+    */
+    while (node != tree->nil) {
+        if (node->left != tree->nil) {
+            treeNode *left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+        } else {
+            treeNode *right = node->right;
+            rbReleaseNode(tree, node);
+            node = right;
+        }
     }
-    
-    // recurse on left and right sides
-    destroyTreeHelper(node->left, nil);
-    destroyTreeHelper(node->right, nil);
-
-    free(node);
 }
 
 void destroyTree(redBlackTree *tree) {
-    destroyTreeHelper(tree->root, tree->nil);
+    nodePool *pool = tree->pool;
 
-    // nil node is dynamically allocated, so it must be freed
-    free(tree->nil);
+    // other trees still draw from the pool, so only this tree's nodes go back to it
+    if (pool->trees > 1) {
+        destroyTreeHelper(tree, tree->root);
+        pool->trees--;
+        free(tree);
+        return;
+    }
+
+#ifdef RB_MALLOC_NODES
+    // without the pool every node is its own allocation
+    destroyTreeHelper(tree, tree->root);
+#endif
+
+    // release the nodes a slab at a time
+    nodeSlab *slab = pool->slabs;
+    while (slab != NULL) {
+        nodeSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    // the pool (and the nil node inside it) is dynamically allocated, so it must be freed
+    free(pool);
 
     tree->root = NULL;
 
@@ -344,18 +707,154 @@ void destroyTree(redBlackTree *tree) {
 
 treeNode* rbTreeSearch(redBlackTree *tree, int key) {
     treeNode *x = tree->root;
+    size_t visited = 0;
 
     while (x != tree->nil && key != x->key) {
+        RB_NOTIFY(tree, RB_NODE_COMPARED, x);
+        visited++;
         if (key < x->key) {
             x = x->left;
         } else {
             x = x->right;
         }
     }
+
+    if (x != tree->nil) {
+        RB_NOTIFY(tree, RB_NODE_COMPARED, x);
+    }
+    RB_STAT(tree, searches);
+    RB_STAT_ADD(tree, searchPathLength, visited + (x != tree->nil));
     
     return x;
 }
 
+void rbTreeSearchBatch(redBlackTree *tree, const int *keys, size_t count, treeNode **out) {
+    treeNode *cursor[RB_SEARCH_GROUP];
+
+    RB_STAT_ADD(tree, searches, count);
+
+    for (size_t base = 0; base < count; base += RB_SEARCH_GROUP) {
+        const size_t groupSize = (count - base < RB_SEARCH_GROUP) ? count - base : RB_SEARCH_GROUP;
+
+        for (size_t i = 0; i < groupSize; i++) {
+            cursor[i] = tree->root;
+        }
+
+        // one level per round for every search still running; the prefetches of a round are in flight together
+        size_t running = groupSize;
+        while (running > 0) {
+            running = 0;
+
+            for (size_t i = 0; i < groupSize; i++) {
+                treeNode *x = cursor[i];
+                const int key = keys[base + i];
+
+                if (x == tree->nil || key == x->key) {
+                    continue;
+                }
+
+                if (key < x->key) {
+                    x = x->left;
+                } else {
+                    x = x->right;
+                }
+
+                RB_PREFETCH(x);
+                cursor[i] = x;
+                running++;
+            }
+
+            RB_STAT_ADD(tree, searchPathLength, running);
+        }
+
+        // the rounds above count the nodes stepped away from; add the node each search started or matched at
+        for (size_t i = 0; i < groupSize; i++) {
+            RB_STAT_ADD(tree, searchPathLength, cursor[i] != tree->nil);
+        }
+
+        for (size_t i = 0; i < groupSize; i++) {
+            out[base + i] = cursor[i];
+        }
+    }
+}
+
+treeNode *rbLowerBound(const redBlackTree *tree, int key) {
+    treeNode *x = tree->root;
+    treeNode *bound = tree->nil;
+
+    // every node >= key is a candidate, and anything smaller still can only be on its left
+    while (x != tree->nil) {
+        if (x->key >= key) {
+            bound = x;
+            x = x->left;
+        } else {
+            x = x->right;
+        }
+    }
+
+    return bound;
+}
+
+treeNode *rbUpperBound(const redBlackTree *tree, int key) {
+    treeNode *x = tree->root;
+    treeNode *bound = tree->nil;
+
+    while (x != tree->nil) {
+        if (x->key > key) {
+            bound = x;
+            x = x->left;
+        } else {
+            x = x->right;
+        }
+    }
+
+    return bound;
+}
+
+treeNode *rbNext(const redBlackTree *tree, const treeNode *node) {
+    if (node->right != tree->nil) {
+        return rbMinimum(tree, node->right);
+    }
+
+    // climb until coming up from a left child, that parent is the next larger key
+    treeNode *parent = node->parent;
+    while (parent != tree->nil && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+
+    return parent;
+}
+
+treeNode *rbPrev(const redBlackTree *tree, const treeNode *node) {
+    if (node->left != tree->nil) {
+        return rbMaximum(tree, node->left);
+    }
+
+    treeNode *parent = node->parent;
+    while (parent != tree->nil && node == parent->left) {
+        node = parent;
+        parent = parent->parent;
+    }
+
+    return parent;
+}
+
+size_t rbRange(const redBlackTree *tree, int lo, int hi, bool (*visit)(treeNode *node, void *context), void *context) {
+    size_t visited = 0;
+
+    for (treeNode *x = rbLowerBound(tree, lo); x != tree->nil && x->key <= hi; x = rbNext(tree, x)) {
+        RB_PREFETCH(x->right);
+        visited++;
+
+        if (visit != NULL && !visit(x, context)) {
+            break;
+        }
+    }
+
+    return visited;
+}
+
 bool isBlack(const treeNode *node) {
     return (node->color == BLACK);
 }
@@ -369,35 +868,259 @@ Color findColor(const treeNode *node) {
 }
 
 int height(redBlackTree *tree, treeNode *node) {
-    // base case
-   if (node == tree->nil) {
-      return -1;
+    if (node == tree->nil) {
+        return -1;
     }
 
-    // recursive case
-   int leftHeight = height(tree, node->left);
-   int rightHeight = height(tree, node->right);
+    // walk the subtree with the parent pointers instead of recursing, tracking the depth of the current node
+    treeNode *const stop = node->parent;
+    treeNode *previous = stop;
+    treeNode *x = node;
+    int depth = 0;
+    int deepest = 0;
 
-    if (leftHeight >= rightHeight) {
-      return 1+leftHeight;
+    while (x != stop) {
+        treeNode *next;
+
+        if (previous == x->parent) { // first visit, go down the left side if there is one
+            if (depth > deepest) {
+                deepest = depth;
+            }
+            next = (x->left != tree->nil) ? x->left : ((x->right != tree->nil) ? x->right : x->parent);
+        } else if (previous == x->left) { // back from the left side, so the right side is next
+            next = (x->right != tree->nil) ? x->right : x->parent;
+        } else { // back from the right side, so x is done
+            next = x->parent;
+        }
+
+        depth += (next == x->parent) ? -1 : 1;
+        previous = x;
+        x = next;
     }
 
-    return 1+rightHeight;
+    return deepest;
+}
+
+int rbBlackHeight(const redBlackTree *tree) {
+    return tree->blackHeight;
+}
+
+int rbHeightBound(const redBlackTree *tree) {
+    return 2 * tree->blackHeight - 1;
 }
 
 int size(redBlackTree *tree, treeNode *node) {
-    // base case
-    if (node == tree->nil) {
-      return 0;
+    (void)tree; // the sentinel's subtree size is 0, so it needs no special case
+    return (int)node->subtreeSize;
+}
+
+treeNode *rbSelect(redBlackTree *tree, size_t k) {
+    treeNode *x = tree->root;
+
+    while (x != tree->nil) {
+        const size_t rank = x->left->subtreeSize + 1; // rank of x within its own subtree
+
+        if (k == rank) {
+            return x;
+        } else if (k < rank) {
+            x = x->left;
+        } else {
+            k -= rank;
+            x = x->right;
+        }
     }
 
-    // recursive case
-    int leftSise = size(tree, node->left);
-    int rightSize = size(tree, node->right);
+    return x;
+}
+
+size_t rbRank(redBlackTree *tree, int key) {
+    treeNode *x = tree->root;
+    size_t rank = 0;
 
-    return 1 + leftSise + rightSize;
+    while (x != tree->nil) {
+        if (key < x->key) {
+            x = x->left;
+        } else {
+            // x and its whole left subtree are <= key
+            rank += x->left->subtreeSize + 1;
+            x = x->right;
+        }
+    }
+
+    return rank;
 }
 
 bool isEmpty(redBlackTree *tree) {
   return (tree->root == tree->nil); 
 }
+
+bool rbSortKeys(int *keys, size_t count) {
+    if (count < 2) {
+        return true;
+    }
+
+    int *scratch = (int*)malloc(count * sizeof(int));
+    if (scratch == NULL) {
+        fprintf(stderr, "The memory allocation failed. The keys have not been sorted\n");
+        return false;
+    }
+
+    int *from = keys;
+    int *to = scratch;
+
+    // four stable counting passes, least significant byte first. Flipping the sign bit makes
+    // negative keys order before positive ones when the bytes are read as unsigned
+    for (unsigned int shift = 0; shift < 32; shift += 8) {
+        size_t offsets[256] = {0};
+
+        for (size_t i = 0; i < count; i++) {
+            offsets[(((unsigned int)from[i] ^ 0x80000000u) >> shift) & 0xFFu]++;
+        }
+
+        size_t total = 0;
+        for (size_t digit = 0; digit < 256; digit++) {
+            const size_t bucketSize = offsets[digit];
+            offsets[digit] = total;
+            total += bucketSize;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            to[offsets[(((unsigned int)from[i] ^ 0x80000000u) >> shift) & 0xFFu]++] = from[i];
+        }
+
+        int *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    // an even number of passes leaves the result back in keys
+    free(scratch);
+    return true;
+}
+
+// takes the node for keys[index] from the contiguous block, or allocates it on its own if there is no block
+static treeNode *buildNode(redBlackTree *tree, treeNode *block, size_t index) {
+    if (block == NULL) {
+        return rbAllocateNode(tree);
+    }
+    return &block[index];
+}
+
+/* builds the subtree holding keys[first .. first + count) and returns its root, or NULL if a node could not be
+*  allocated (after releasing whatever this call had already built). Nodes at redDepth are colored RED.
+*/
+static treeNode *buildSubtree(redBlackTree *tree, const int *keys, size_t first, size_t count, treeNode *block,
+                              size_t depth, size_t redDepth) {
+    if (count == 0) {
+        return tree->nil;
+    }
+
+    const size_t middle = first + count / 2;
+
+    treeNode *left = buildSubtree(tree, keys, first, middle - first, block, depth + 1, redDepth);
+    if (left == NULL) {
+        return NULL;
+    }
+
+    treeNode *right = buildSubtree(tree, keys, middle + 1, first + count - middle - 1, block, depth + 1, redDepth);
+    if (right == NULL) {
+        destroyTreeHelper(tree, left);
+        return NULL;
+    }
+
+    treeNode *node = buildNode(tree, block, middle);
+    if (node == NULL) {
+        destroyTreeHelper(tree, left);
+        destroyTreeHelper(tree, right);
+        return NULL;
+    }
+
+    node->key = keys[middle];
+    node->color = (depth == redDepth) ? RED : BLACK;
+    node->left = left;
+    node->right = right;
+    node->parent = tree->nil; // set by the caller, unless node ends up as the root
+    node->subtreeSize = count;
+
+    // the sentinel's parent is never written here, it is not part of the subtree
+    if (left != tree->nil) {
+        left->parent = node;
+    }
+    if (right != tree->nil) {
+        right->parent = node;
+    }
+
+    return node;
+}
+
+redBlackTree *rbBuildFromSorted(const int *keys, size_t count) {
+    int *sortedCopy = NULL;
+
+    for (size_t i = 1; i < count; i++) {
+        if (keys[i - 1] > keys[i]) {
+            // out of order, so build from a sorted copy instead
+            sortedCopy = (int*)malloc(count * sizeof(int));
+            if (sortedCopy == NULL) {
+                fprintf(stderr, "The memory allocation failed. The tree has not been built\n");
+                return NULL;
+            }
+            memcpy(sortedCopy, keys, count * sizeof(int));
+
+            if (!rbSortKeys(sortedCopy, count)) {
+                free(sortedCopy);
+                return NULL;
+            }
+            keys = sortedCopy;
+            break;
+        }
+    }
+
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        free(sortedCopy);
+        return NULL;
+    }
+
+    // splitting every range at its middle puts all leaves on the last two levels. The last level is
+    // floor(log2(count)); coloring it RED keeps the number of BLACK nodes equal on every path
+    size_t lastLevel = 0;
+    for (size_t remaining = count; remaining > 1; remaining /= 2) {
+        lastLevel++;
+    }
+    const size_t redDepth = (lastLevel == 0) ? SIZE_MAX : lastLevel; // a lone root stays BLACK
+
+    treeNode *block = NULL;
+    if (count > 0) {
+        block = allocateNodeBlock(tree, count);
+    }
+
+    treeNode *root = buildSubtree(tree, keys, 0, count, block, 0, redDepth);
+    free(sortedCopy);
+
+    if (root == NULL) {
+        fprintf(stderr, "The memory allocation failed. The tree has not been built\n");
+        destroyTree(tree);
+        return NULL;
+    }
+
+    tree->root = root;
+    tree->blackHeight = (count == 0) ? 0 : ((lastLevel == 0) ? 1 : (int)lastLevel); // every level above the RED one
+    return tree;
+}
+
+void rbGetStats(const redBlackTree *tree, rbStats *snapshot) {
+#ifdef RB_ENABLE_STATS
+    *snapshot = tree->stats;
+#else
+    (void)tree;
+    memset(snapshot, 0, sizeof(*snapshot));
+#endif
+}
+
+void rbResetStats(redBlackTree *tree) {
+#ifdef RB_ENABLE_STATS
+    memset(&tree->stats, 0, sizeof(tree->stats));
+#else
+    (void)tree;
+#endif
+}
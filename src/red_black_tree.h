@@ -2,6 +2,14 @@
 #define RED_BLACK_TREE
 
 #include <stdbool.h>
+#include <stddef.h>
+
+// smallest and largest number of treeNodes carved out of a single slab of the node pool
+#define RB_SLAB_MIN_NODES 64
+#define RB_SLAB_MAX_NODES 65536
+
+// number of searches rbTreeSearchBatch() advances in lock-step
+#define RB_SEARCH_GROUP 16
 
 typedef enum Color {RED, BLACK} Color;
 
@@ -11,12 +19,82 @@ typedef struct treeNode {
     struct treeNode *left;
     struct treeNode *right;
     struct treeNode *parent;
+    size_t subtreeSize; // number of nodes in the subtree rooted here, 0 for the sentinel
 } treeNode;
 
+/* a slab is one contiguous block of treeNodes. Nodes are handed out front to back and are never
+*  returned to the system individually; the whole slab is released by destroyTree().
+*/
+typedef struct nodeSlab {
+    struct nodeSlab *next;
+    size_t capacity;
+    size_t used;
+    treeNode nodes[];
+} nodeSlab;
+
+/* the pool also holds the sentinel, so trees sharing a pool (see initializeSharedTree()) share nil as well and
+*  can hand subtrees to each other without touching their leaves
+*/
+typedef struct nodePool {
+    nodeSlab *slabs; // newest slab first
+    treeNode *freeList; // nodes released by rbDelete(), linked through their parent pointers
+    size_t nextSlabCapacity;
+    size_t trees; // number of redBlackTrees drawing nodes from the pool, the last destroyTree() frees it
+    treeNode sentinel;
+} nodePool;
+
+/* work counters for the balancing code. They are only kept when the tree sources are compiled with
+*  RB_ENABLE_STATS defined; otherwise the counting compiles away and rbGetStats() reports zeros.
+*/
+typedef struct rbStats {
+    unsigned long long leftRotations;
+    unsigned long long rightRotations;
+    unsigned long long insertCases[3]; // rbInsertFixup() cases 1 to 3, mirror images included
+    unsigned long long deleteCases[4]; // rbDeleteFixup() cases 1 to 4, mirror images included
+    unsigned long long insertFixupIterations;
+    unsigned long long deleteFixupIterations;
+    unsigned long long searches; // rbTreeSearch() calls and keys given to rbTreeSearchBatch()
+    unsigned long long searchPathLength; // nodes compared by those searches
+} rbStats;
+
+/* what an observer of a tree (see rbSetObserver()) is told about, right after it happened. The events changing the
+*  shape of the tree report a node whose subtree changed shape, and with it the subtrees of all its ancestors at the
+*  time of the call, which the parent pointers lead to:
+*    RB_NODE_LINKED      the node took a new place, as the node inserted or the successor moved up by rbDelete()
+*    RB_ROTATED_LEFT     the node went down to the left of its right child
+*    RB_ROTATED_RIGHT    the node went down to the right of its left child
+*    RB_TRANSPLANTED     the node was replaced by another subtree in the link from its parent
+*  The others leave the shape as it is:
+*    RB_NODE_COMPARED    the key of the node was compared on the search path of rbInsert() or rbTreeSearch()
+*    RB_NODE_RECOLORED   the node changed its color, node->color is the new one
+*    RB_NODE_RELEASED    the node is going back to the pool
+*    RB_TREE_RESET       (with a NULL node) the tree changed too much to tell node by node, as after the operations
+*                        of bulk_operations.h
+*/
+typedef enum rbEvent {
+    RB_NODE_LINKED,
+    RB_ROTATED_LEFT,
+    RB_ROTATED_RIGHT,
+    RB_TRANSPLANTED,
+    RB_NODE_COMPARED,
+    RB_NODE_RECOLORED,
+    RB_NODE_RELEASED,
+    RB_TREE_RESET
+} rbEvent;
+
+typedef void (*rbObserver)(void *context, rbEvent event, treeNode *node);
+
 typedef struct redBlackTree {
     treeNode *root;
     treeNode *nil;
-
+    nodePool *pool;
+    int blackHeight; // BLACK nodes on every path from the root down to nil (nil excluded), kept by the fixups
+    unsigned long modifications; // bumped by every change to the keys, so views can tell a cached drawing is stale
+    rbObserver observer; // NULL unless set by rbSetObserver()
+    void *observerContext;
+#ifdef RB_ENABLE_STATS
+    rbStats stats;
+#endif
 } redBlackTree;
 
 /**
@@ -29,11 +107,98 @@ typedef struct redBlackTree {
 */
 redBlackTree *initializeTree();
 
+/**
+ * @brief Initializes an empty redBlackTree that shares the node pool and the sentinel nil node of another tree.
+ *
+ * Trees sharing a pool can exchange nodes without copying them, which is what lets rbSplit() and rbJoin() run in
+ * O(log(n)). They are not independent of each other though: a node released by one may be handed out to the
+ * other, so two trees sharing a pool must not be changed by two threads at the same time.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The redBlackTree whose pool is shared.
+ *
+ * @return Returns a pointer to a redBlackTree struct, unless memory allocation failed
+ * in which case an error message is printed and NULL is returned.
+*/
+redBlackTree *initializeSharedTree(redBlackTree *tree);
+
+/**
+ * @brief Makes other draw its nodes from the same node pool as tree, so the two can exchange nodes.
+ *
+ * If other is the only tree of its pool, its nodes are rewired to tree's sentinel and its slabs are handed to
+ * tree's pool (or the other way around, when only tree is alone in its pool and it is the smaller tree). If both
+ * pools are shared with further trees, other's nodes are copied into tree's pool and the originals are released.
+ * Pointers into other stay valid in the first two cases, but not after a copy.
+ *
+ * Runs in O(1) if the trees already share a pool, otherwise O(m) for the m nodes that are moved.
+ *
+ * @note When tree is the one moved over, its pool and sentinel are freed and tree->nil becomes other->nil, so a
+ * saved tree->nil must be read again after the call.
+ *
+ * @param *tree The redBlackTree whose pool is kept, unless tree is alone in its pool and other is larger or shares
+ * its pool with further trees.
+ * @param *other The redBlackTree that is moved over.
+ *
+ * @return true on success. If the copy can not be allocated, an error message is printed, nothing changes and
+ * false is returned.
+*/
+bool rbSharePool(redBlackTree *tree, redBlackTree *other);
+
+/**
+ * @brief Sets the function told about every change to the shape of the tree, replacing any previous one.
+ *
+ * The observer is called synchronously from rbInsert(), rbDelete(), rbTreeSearch(), the fixups, the rotations
+ * and rbReleaseNode(), so it must not change the tree itself. Passing NULL removes the observer. Without an
+ * observer, every event costs a single well predicted branch.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The redBlackTree being observed.
+ * @param observer The function called for each change, or NULL.
+ * @param *context Handed to every call of observer.
+ *
+ * @return Nothing.
+*/
+void rbSetObserver(redBlackTree *tree, rbObserver observer, void *context);
+
+/**
+ * @brief Hands out an uninitialized treeNode from the tree's node pool.
+ *
+ * Nodes released by rbReleaseNode() are reused first. Otherwise the node is carved from the newest slab, and
+ * a new slab (twice the size of the previous one, up to RB_SLAB_MAX_NODES) is allocated when it is full.
+ *
+ * Runs in amortized O(1).
+ *
+ * @note Compiling with RB_MALLOC_NODES defined falls back to one malloc() per node, which is only useful to
+ * compare against the pool.
+ *
+ * @param *tree The redBlackTree the node will belong to.
+ *
+ * @return A pointer to the node, or NULL if a new slab could not be allocated.
+*/
+treeNode *rbAllocateNode(redBlackTree *tree);
+
+/**
+ * @brief Returns a treeNode to the tree's node pool so a later rbAllocateNode() can reuse it.
+ *
+ * Runs in O(1).
+ *
+ * @note The node must have come from rbAllocateNode() on the same tree and must already be unlinked.
+ *
+ * @param *tree The redBlackTree the node belonged to.
+ * @param *node The node being released.
+ *
+ * @return Nothing.
+*/
+void rbReleaseNode(redBlackTree *tree, treeNode *node);
+
 /**
  * @brief Transforms the configuration of two treeNodes by swapping treeNode x with a child treeNode y such 
  * that Red-Black properties are maintined.
  * 
- * treeNode x has a right child y. This function turns x into the left child of y.
+ * treeNode x has a right child y. This function turns x into the left child of y. The subtree sizes of x
+ * and y are updated to match.
  * 
  * Runs in O(1).
  * 
@@ -51,7 +216,8 @@ void leftRotate(redBlackTree *tree, treeNode *x);
  * @brief Transforms the configuration of two treeNodes by swapping treeNode x with a child treeNode y such 
  * that Red-Black properties are maintined.
  * 
- * treeNode x has a left child y. This function turns x into the right child of y.
+ * treeNode x has a left child y. This function turns x into the right child of y. The subtree sizes of x
+ * and y are updated to match.
  * 
  * Runs in O(1).
  * 
@@ -88,14 +254,16 @@ void rbInsert(redBlackTree *tree, const int data);
  * 
  * Runs in O(log(n)).
  * 
- * @note This function should run automatically as a part of rbInsert(). It should not be called individually.
+ * @note This function should run automatically as a part of rbInsert(), or after a RED node has been linked
+ * into a tree some other way (bulk_operations.c joins trees like this). It should not be called individually.
  *  
  * @param *tree The redBlackTree that is being maintained.
  * @param *z The treeNode which was just inserted.
  * 
- * @return Nothing.
+ * @return true if the root ended up RED and had to be recolored, which raises the black height of the tree by
+ * one (tree->blackHeight is updated to match), otherwise false.
 */
-void rbInsertFixup(redBlackTree *tree, treeNode *z);
+bool rbInsertFixup(redBlackTree *tree, treeNode *z);
 
 /**
  * @brief Finds and returns the treeNode in a redBlackTree subtree rooted at *node with the max value.
@@ -167,29 +335,36 @@ void rbDelete(redBlackTree *tree, treeNode *z);
  * @param *tree The redBlackTree that is being maintained.
  * @param *x Subtree to begin fixup from (determined automatically from rbDelete).
  * 
- * @return Nothing.
+ * @return true if the missing BLACK node was pushed all the way up to the root, which lowers the black height of
+ * the tree by one (tree->blackHeight is updated to match), otherwise false.
 */
-void rbDeleteFixup(redBlackTree *tree, treeNode *x);
+bool rbDeleteFixup(redBlackTree *tree, treeNode *x);
 
 /**
- * @brief Auxilliary function for destroyTree(). Recursively frees all treeNodes.
+ * @brief Releases every treeNode in the subtree rooted at *node back to the tree's node pool.
  * 
- * Runs in O(n).
+ * Left children are rotated up until the subtree is a single right spine, which is then released from the top.
+ * This needs neither recursion nor a stack, however deep the subtree is.
+ * 
+ * Runs in O(n) with O(1) extra memory.
  * 
- * @note This function should run automatically as a part of destroyTree(). It should not be called individually,
- * as doing so could cause a memory leak.
+ * @note The subtree must already be detached from the tree, and its shape is destroyed. destroyTree() does not
+ * need this function unless other trees share the node pool, since it releases whole slabs at once.
  * 
- * @param *node  The node to be freed or recursed from.
- * @param *nil The nil node of the redBlackTree being freed.
+ * @param *tree The redBlackTree the subtree belonged to.
+ * @param *node The root of the subtree being released.
  * 
  * @returns Nothing.
 */
-void destroyTreeHelper(treeNode *node, treeNode *nil);
+void destroyTreeHelper(redBlackTree *tree, treeNode *node);
 
 /**
  * @brief Frees all nodes in the redBlackTree, including nil, so it can no longer be used.
  * 
- * Runs in O(n).
+ * The nodes are released a slab at a time without being visited. If other trees still share the node pool, the
+ * nodes are released to the pool one by one instead and the pool is left to the last of them.
+ * 
+ * Runs in O(n / RB_SLAB_MAX_NODES + log(n)), or O(n) while the pool is shared.
  * 
  * @param *tree The redBlackTree being destroyed.
  * 
@@ -211,6 +386,94 @@ void destroyTree(redBlackTree *tree);
 */
 treeNode* rbTreeSearch(redBlackTree *tree, int key);
 
+/**
+ * @brief Searches a red black tree for many keys at once, hiding memory latency by interleaving the searches.
+ *
+ * The keys are processed in groups of RB_SEARCH_GROUP. Each round moves every unfinished search of the group one
+ * level down and prefetches the child it moved to, so the cache misses of the whole group overlap instead of
+ * being paid one after another as in a loop over rbTreeSearch().
+ *
+ * Runs in O(n log(n)) for n keys, like n calls to rbTreeSearch().
+ *
+ * @param *tree The redBlackTree being searched.
+ * @param *keys The values being searched for.
+ * @param count The number of keys.
+ * @param **out Receives, for every key, what rbTreeSearch() would return for it.
+ *
+ * @returns Nothing.
+*/
+void rbTreeSearchBatch(redBlackTree *tree, const int *keys, size_t count, treeNode **out);
+
+/**
+ * @brief Finds the first treeNode, in sorted order, whose key is not less than the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The redBlackTree being searched.
+ * @param key The bound.
+ *
+ * @return A pointer to the first treeNode with a key >= key, or tree->nil if every key is smaller.
+*/
+treeNode *rbLowerBound(const redBlackTree *tree, int key);
+
+/**
+ * @brief Finds the first treeNode, in sorted order, whose key is greater than the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The redBlackTree being searched.
+ * @param key The bound.
+ *
+ * @return A pointer to the first treeNode with a key > key, or tree->nil if no key is larger.
+*/
+treeNode *rbUpperBound(const redBlackTree *tree, int key);
+
+/**
+ * @brief Finds the in-order successor of a treeNode.
+ *
+ * Runs in O(log(n)), and in amortized O(1) when walking the whole tree (or any range of it) from one node to the
+ * next, since every edge is then crossed at most twice.
+ *
+ * @param *tree The redBlackTree the node is in. Used to identify nil treeNode.
+ * @param *node The node whose successor is wanted.
+ *
+ * @return A pointer to the next treeNode in sorted order, or tree->nil if node holds the maximum.
+*/
+treeNode *rbNext(const redBlackTree *tree, const treeNode *node);
+
+/**
+ * @brief Finds the in-order predecessor of a treeNode.
+ *
+ * Runs in O(log(n)), and in amortized O(1) when walking the tree from one node to the previous.
+ *
+ * @param *tree The redBlackTree the node is in. Used to identify nil treeNode.
+ * @param *node The node whose predecessor is wanted.
+ *
+ * @return A pointer to the previous treeNode in sorted order, or tree->nil if node holds the minimum.
+*/
+treeNode *rbPrev(const redBlackTree *tree, const treeNode *node);
+
+/**
+ * @brief Calls a function on every treeNode whose key lies in [lo, hi], in sorted order.
+ *
+ * The scan starts at rbLowerBound(tree, lo) and follows rbNext(), prefetching the right child of each node
+ * (where its successor usually is) before the callback runs, so the load overlaps the callback.
+ *
+ * Runs in O(log(n) + k), where k is the number of nodes visited.
+ *
+ * @note The callback must not insert into or delete from the tree.
+ *
+ * @param *tree The redBlackTree being scanned.
+ * @param lo The smallest key visited.
+ * @param hi The largest key visited.
+ * @param *visit Called with each node and *context. Returning false ends the scan early. May be NULL, in which
+ * case the nodes are only counted.
+ * @param *context Passed through to visit.
+ *
+ * @return The number of nodes visited, including the one whose callback ended the scan.
+*/
+size_t rbRange(const redBlackTree *tree, int lo, int hi, bool (*visit)(treeNode *node, void *context), void *context);
+
 /**
  * @brief Determines whether a given node's color is BLACK.
  *
@@ -245,11 +508,13 @@ bool isRed(const treeNode *node);
 Color findColor(const treeNode *node);
 
 /**
- * @brief Recursively finds the largest number of edges from the given root to a leaf.
+ * @brief Finds the largest number of edges from the given root to a leaf.
+ *
+ * The subtree is walked with the parent pointers, so there is no recursion however deep it is.
  *
  * @note Pass in the root node for the height of the whole tree.
  *
- * Runs in O(n).
+ * Runs in O(n) with O(1) extra memory.
  *
  * @param *tree The tree whose height is being found (used to know sentinel).
  * @param *node The root of the subtree whose height is being calculated.
@@ -259,19 +524,77 @@ Color findColor(const treeNode *node);
 int height(redBlackTree *tree, treeNode *node);
 
 /**
- * @brief Recursively finds the number of nodes in a given subtree.
+ * @brief Returns the black height of a redBlackTree, the number of BLACK nodes on every path from the root down
+ * to nil (nil excluded).
+ *
+ * The black height is kept up to date by rbInsertFixup() and rbDeleteFixup(), which are the only places it
+ * changes, so it is not counted.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The redBlackTree being queried.
+ *
+ * @return The black height, 0 for an empty tree.
+*/
+int rbBlackHeight(const redBlackTree *tree);
+
+/**
+ * @brief Returns an upper bound for height(tree, tree->root) without walking the tree.
+ *
+ * No RED node has a RED child, so a path from the root holds at most as many RED nodes as BLACK ones, and the
+ * root is BLACK. A path therefore has at most 2 * rbBlackHeight() nodes, and the height is at least
+ * rbBlackHeight() - 1. Both are within a factor of two of the true height, and the bound never exceeds
+ * 2 * log2(n + 1) - 1.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The redBlackTree being queried.
+ *
+ * @return 2 * rbBlackHeight() - 1, which is -1 for an empty tree just like height().
+*/
+int rbHeightBound(const redBlackTree *tree);
+
+/**
+ * @brief Finds the number of nodes in a given subtree.
  *
  * @note Pass in the root node for the size of the whole tree.
  *
- * Runs in O(n).
+ * Runs in O(1), since every node keeps the size of its subtree.
  *
- * @param *tree The tree whose height is being found (used to know sentinel).
+ * @param *tree The tree whose size is being found (used to know sentinel).
  * @param *node The root of the subtree whose size is being calculated.
  *
  * @return The number of nodes in a subtree as an int.
 */
 int size(redBlackTree *tree, treeNode *node);
 
+/**
+ * @brief Finds the treeNode with the k-th smallest key (order statistic) by descending on subtree sizes.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The redBlackTree being searched.
+ * @param k The 1-based rank of the wanted key, so 1 is the minimum and size(tree, tree->root) the maximum.
+ *
+ * @return A pointer to the treeNode of rank k, or a pointer to the NIL node if k is 0 or larger than the tree.
+*/
+treeNode *rbSelect(redBlackTree *tree, size_t k);
+
+/**
+ * @brief Counts the keys in the tree that are less than or equal to the given key.
+ *
+ * For a key stored once in the tree this is its 1-based rank, so rbSelect(tree, rbRank(tree, key)) finds it.
+ * For an absent key it is the rank of its predecessor.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The redBlackTree being searched.
+ * @param key The key being ranked.
+ *
+ * @return The number of keys less than or equal to key.
+*/
+size_t rbRank(redBlackTree *tree, int key);
+
 /**
  * @brief Checks if a redBlackTree has no nodes.
  *
@@ -283,4 +606,61 @@ int size(redBlackTree *tree, treeNode *node);
  */
 bool isEmpty(redBlackTree *tree);
 
+/**
+ * @brief Copies the tree's work counters.
+ *
+ * Runs in O(1).
+ *
+ * @note The counters are only kept when the tree sources are compiled with RB_ENABLE_STATS defined. Otherwise
+ * the snapshot is all zeros.
+ *
+ * @param *tree The redBlackTree whose counters are read.
+ * @param *snapshot Receives the counters.
+ *
+ * @return Nothing.
+*/
+void rbGetStats(const redBlackTree *tree, rbStats *snapshot);
+
+/**
+ * @brief Sets all of the tree's work counters back to zero.
+ *
+ * Runs in O(1).
+ *
+ * @param *tree The redBlackTree whose counters are reset.
+ *
+ * @return Nothing.
+*/
+void rbResetStats(redBlackTree *tree);
+
+/**
+ * @brief Sorts an array of ints in ascending order with an LSD radix sort (four passes over 8-bit digits).
+ *
+ * Runs in O(n), with O(n) auxiliary memory.
+ *
+ * @param *keys The array being sorted in place.
+ * @param count The number of keys in the array.
+ *
+ * @return true if the keys were sorted, false if the scratch buffer could not be allocated (in which case an error
+ * message is printed and the array is untouched).
+*/
+bool rbSortKeys(int *keys, size_t count);
+
+/**
+ * @brief Builds a new redBlackTree holding the given keys in one linear pass instead of count rbInsert() calls.
+ *
+ * The middle key of every range becomes the root of that range, so the tree is perfectly balanced. Every node is
+ * BLACK except those on the deepest level, which are RED whenever that level is not the root. All nodes are
+ * allocated as one contiguous block of the node pool.
+ *
+ * If the keys are not in non-decreasing order, a copy is sorted with rbSortKeys() first.
+ *
+ * Runs in O(n).
+ *
+ * @param *keys The keys of the new tree. Duplicates are kept, just as rbInsert() keeps them.
+ * @param count The number of keys.
+ *
+ * @return A pointer to the new redBlackTree, or NULL if a memory allocation failed (an error message is printed).
+*/
+redBlackTree *rbBuildFromSorted(const int *keys, size_t count);
+
 #endif
@@ -0,0 +1,265 @@
+#include "top_down_tree.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+
+// same slab scheme as rbAllocateNode(), so both variants pay the same allocation costs
+static tdNode *allocateNode(topDownTree *tree) {
+    if (tree->freeList != NULL) {
+        tdNode *node = tree->freeList;
+        tree->freeList = node->link[0];
+        return node;
+    }
+
+    if (tree->slabs == NULL || tree->slabs->used == tree->slabs->capacity) {
+        const size_t capacity = tree->nextSlabCapacity;
+        tdSlab *slab = (tdSlab*)malloc(sizeof(tdSlab) + capacity * sizeof(tdNode));
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->capacity = capacity;
+        slab->used = 0;
+        slab->next = tree->slabs;
+        tree->slabs = slab;
+
+        if (capacity < RB_SLAB_MAX_NODES) {
+            tree->nextSlabCapacity = capacity * 2;
+        }
+    }
+
+    return &tree->slabs->nodes[tree->slabs->used++];
+}
+
+static void releaseNode(topDownTree *tree, tdNode *node) {
+    node->link[0] = tree->freeList;
+    tree->freeList = node;
+}
+
+topDownTree *tdInitializeTree(void) {
+    topDownTree *tree = (topDownTree*)malloc(sizeof(topDownTree));
+    if (tree == NULL) {
+        fprintf(stderr, "tree was not allocated and the new tree was not created\n");
+        return NULL;
+    }
+
+    tree->root = NULL;
+    tree->count = 0;
+    tree->slabs = NULL;
+    tree->freeList = NULL;
+    tree->nextSlabCapacity = RB_SLAB_MIN_NODES;
+
+    return tree;
+}
+
+static bool isRedNode(const tdNode *node) {
+    return node != NULL && node->color == RED;
+}
+
+// rotates root in direction dir (0 = left, 1 = right), coloring the old root RED and the new one BLACK
+static tdNode *singleRotate(tdNode *root, int dir) {
+    tdNode *save = root->link[!dir];
+
+    root->link[!dir] = save->link[dir];
+    save->link[dir] = root;
+
+    root->color = RED;
+    save->color = BLACK;
+
+    return save;
+}
+
+// rotates root's child the other way first, for the zig-zag shape
+static tdNode *doubleRotate(tdNode *root, int dir) {
+    root->link[!dir] = singleRotate(root->link[!dir], !dir);
+    return singleRotate(root, dir);
+}
+
+void tdInsert(topDownTree *tree, const int data) {
+    tdNode *inserted = allocateNode(tree);
+    if (inserted == NULL) {
+        fprintf(stderr, "The memory allocation failed. The value has not been inserted\n");
+        return;
+    }
+
+    inserted->key = data;
+    inserted->color = RED;
+    inserted->link[0] = NULL;
+    inserted->link[1] = NULL;
+    tree->count++;
+
+    if (tree->root == NULL) {
+        inserted->color = BLACK;
+        tree->root = inserted;
+        return;
+    }
+
+    // a false root above the real one means rotations at the root need no special case
+    tdNode head = {0, BLACK, {NULL, NULL}};
+    tdNode *t = &head; // great grandparent
+    tdNode *g = NULL; // grandparent
+    tdNode *p = NULL; // parent
+    tdNode *q = tree->root; // iterator
+    int dir = 0;
+    int last = 0;
+
+    head.link[1] = tree->root;
+
+    for (;;) {
+        if (q == NULL) {
+            // reached the bottom, hang the new node here
+            q = inserted;
+            p->link[dir] = q;
+        } else if (isRedNode(q->link[0]) && isRedNode(q->link[1])) {
+            // color flip, which is case 1 of rbInsertFixup() done ahead of time
+            q->color = RED;
+            q->link[0]->color = BLACK;
+            q->link[1]->color = BLACK;
+        }
+
+        // a flip or the new node can leave two REDs in a row, fix them at the grandparent
+        if (isRedNode(q) && isRedNode(p)) {
+            const int dir2 = (t->link[1] == g);
+
+            if (q == p->link[last]) {
+                t->link[dir2] = singleRotate(g, !last);
+            } else {
+                t->link[dir2] = doubleRotate(g, !last);
+            }
+        }
+
+        if (q == inserted) {
+            break;
+        }
+
+        last = dir;
+        dir = (data >= q->key); // equal keys go right, like rbInsert()
+
+        if (g != NULL) {
+            t = g;
+        }
+        g = p;
+        p = q;
+        q = q->link[dir];
+    }
+
+    tree->root = head.link[1];
+    tree->root->color = BLACK;
+}
+
+bool tdDelete(topDownTree *tree, int key) {
+    if (tree->root == NULL) {
+        return false;
+    }
+
+    tdNode head = {0, BLACK, {NULL, NULL}};
+    tdNode *q = &head; // iterator
+    tdNode *p = NULL; // parent
+    tdNode *g = NULL; // grandparent
+    tdNode *found = NULL;
+    int dir = 1;
+
+    head.link[1] = tree->root;
+
+    // push a RED node down the search path so the node finally removed is RED
+    while (q->link[dir] != NULL) {
+        const int last = dir;
+
+        g = p;
+        p = q;
+        q = q->link[dir];
+        dir = (q->key < key);
+
+        if (q->key == key) {
+            found = q;
+        }
+
+        if (!isRedNode(q) && !isRedNode(q->link[dir])) {
+            if (isRedNode(q->link[!dir])) {
+                // q has a RED child on the other side, rotate it above q
+                p->link[last] = singleRotate(q, dir);
+                p = p->link[last];
+            } else {
+                tdNode *s = p->link[!last]; // q's sibling
+
+                if (s != NULL) {
+                    if (!isRedNode(s->link[!last]) && !isRedNode(s->link[last])) {
+                        // q and its sibling can both become RED (case 2 of rbDeleteFixup())
+                        p->color = BLACK;
+                        s->color = RED;
+                        q->color = RED;
+                    } else {
+                        // borrow from the sibling's RED child (cases 3 and 4 of rbDeleteFixup())
+                        const int dir2 = (g->link[1] == p);
+
+                        if (isRedNode(s->link[last])) {
+                            g->link[dir2] = doubleRotate(p, last);
+                        } else {
+                            g->link[dir2] = singleRotate(p, last);
+                        }
+
+                        q->color = RED;
+                        g->link[dir2]->color = RED;
+                        g->link[dir2]->link[0]->color = BLACK;
+                        g->link[dir2]->link[1]->color = BLACK;
+                    }
+                }
+            }
+        }
+    }
+
+    if (found != NULL) {
+        // q is the in-order predecessor of found (or found itself), and has at most one child
+        found->key = q->key;
+        p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
+        releaseNode(tree, q);
+        tree->count--;
+    }
+
+    tree->root = head.link[1];
+    if (tree->root != NULL) {
+        tree->root->color = BLACK;
+    }
+
+    return found != NULL;
+}
+
+tdNode *tdTreeSearch(const topDownTree *tree, int key) {
+    tdNode *x = tree->root;
+
+    while (x != NULL && key != x->key) {
+        // load both children before the comparison decides, so the next load does not wait on it
+        tdNode *left = x->link[0];
+        tdNode *right = x->link[1];
+        x = (key < x->key) ? left : right;
+    }
+
+    return x;
+}
+
+tdNode *tdMinimum(const topDownTree *tree) {
+    tdNode *node = tree->root;
+    while (node != NULL && node->link[0] != NULL) {
+        node = node->link[0];
+    }
+    return node;
+}
+
+tdNode *tdMaximum(const topDownTree *tree) {
+    tdNode *node = tree->root;
+    while (node != NULL && node->link[1] != NULL) {
+        node = node->link[1];
+    }
+    return node;
+}
+
+void tdDestroyTree(topDownTree *tree) {
+    tdSlab *slab = tree->slabs;
+    while (slab != NULL) {
+        tdSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    free(tree);
+}
@@ -0,0 +1,124 @@
+#ifndef TOP_DOWN_TREE
+#define TOP_DOWN_TREE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "red_black_tree.h"
+
+/* NOTE: topDownTree is a variant of redBlackTree without parent pointers. Insertion and deletion restore the
+*  Red-Black properties on the way down (recoloring and rotating ahead of the search), so a single pass from the
+*  root is enough and there is no upward fixup. A node is 24 bytes instead of 40 (no parent, no subtree size).
+*
+*  Deletion works on keys rather than nodes, since a node cannot be unlinked without knowing its parent.
+*/
+
+typedef struct tdNode {
+    int key;
+    Color color;
+    struct tdNode *link[2]; // link[0] is the left child, link[1] the right child, NULL when absent
+} tdNode;
+
+// slab of tdNodes, handed out and released the same way as the nodePool of redBlackTree
+typedef struct tdSlab {
+    struct tdSlab *next;
+    size_t capacity;
+    size_t used;
+    tdNode nodes[];
+} tdSlab;
+
+typedef struct topDownTree {
+    tdNode *root;
+    size_t count;
+    tdSlab *slabs; // newest slab first
+    tdNode *freeList; // nodes released by tdDelete(), linked through link[0]
+    size_t nextSlabCapacity;
+} topDownTree;
+
+/**
+ * @brief Initializes an empty topDownTree.
+ *
+ * Runs in O(1).
+ *
+ * @return Returns a pointer to a topDownTree struct, unless memory allocation failed in which case an error
+ * message is printed and NULL is returned.
+*/
+topDownTree *tdInitializeTree(void);
+
+/**
+ * @brief Inserts a RED node with the given key in one top-down pass.
+ *
+ * On the way down every BLACK node with two RED children is flipped (case 1 of rbInsertFixup() applied early), and
+ * a RED node with a RED parent is fixed right away with a single or double rotation at its grandparent. Equal
+ * keys go to the right, as in rbInsert().
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The topDownTree the key is inserted into.
+ * @param data The key of the new node.
+ *
+ * @return Nothing. If a memory allocation fails, an error message is printed and the key is not inserted.
+*/
+void tdInsert(topDownTree *tree, const int data);
+
+/**
+ * @brief Deletes one node holding the given key in one top-down pass.
+ *
+ * On the way down the current node is made RED (by recoloring or rotating with its sibling), so the node that is
+ * finally unlinked is RED and removing it cannot change any black height. The key of the in-order predecessor
+ * is copied into the node holding the deleted key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The topDownTree being deleted from.
+ * @param key The key to be deleted.
+ *
+ * @return true if a node was deleted, false if the key was not in the tree.
+*/
+bool tdDelete(topDownTree *tree, int key);
+
+/**
+ * @brief Searches a topDownTree for a node containing the given key.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The topDownTree being searched.
+ * @param key The value being searched for.
+ *
+ * @return A pointer to a node holding key, or NULL if the key is not in the tree.
+*/
+tdNode *tdTreeSearch(const topDownTree *tree, int key);
+
+/**
+ * @brief Finds the node with the min value in the tree.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The topDownTree being searched.
+ *
+ * @return A pointer to the node with the minimum value, or NULL if the tree is empty.
+*/
+tdNode *tdMinimum(const topDownTree *tree);
+
+/**
+ * @brief Finds the node with the max value in the tree.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *tree The topDownTree being searched.
+ *
+ * @return A pointer to the node with the maximum value, or NULL if the tree is empty.
+*/
+tdNode *tdMaximum(const topDownTree *tree);
+
+/**
+ * @brief Frees all nodes in the topDownTree, a slab at a time, and the tree itself.
+ *
+ * Runs in O(n / RB_SLAB_MAX_NODES + log(n)).
+ *
+ * @param *tree The topDownTree being destroyed.
+ *
+ * @return Nothing.
+*/
+void tdDestroyTree(topDownTree *tree);
+
+#endif
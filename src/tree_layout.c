@@ -0,0 +1,262 @@
+#include "tree_layout.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "stdint.h"
+#include "string.h"
+
+// the leftmost and rightmost x of a level of a subtree
+#define LEFT(record, level) ((record)->contour[2 * (level)])
+#define RIGHT(record, level) ((record)->contour[2 * (level) + 1])
+
+// the slot a node hashes to, from the high bits of a multiplicative hash of its address
+static size_t homeSlot(const treeLayout *layout, const treeNode *node) {
+    const uint64_t hash = (uint64_t)(uintptr_t)node * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(hash >> 32) & (layout->capacity - 1);
+}
+
+// the slot holding node, or the empty slot where it belongs
+static size_t findSlot(const treeLayout *layout, const treeNode *node) {
+    size_t slot = homeSlot(layout, node);
+    while (layout->records[slot].node != NULL && layout->records[slot].node != node) {
+        slot = (slot + 1) & (layout->capacity - 1);
+    }
+    return slot;
+}
+
+// moves the records to a table of the given number of slots, a power of two
+static bool resize(treeLayout *layout, size_t capacity) {
+    tlRecord *records = (tlRecord*)calloc(capacity, sizeof(tlRecord));
+    if (records == NULL) {
+        return false;
+    }
+
+    tlRecord *old = layout->records;
+    const size_t oldCapacity = layout->capacity;
+    layout->records = records;
+    layout->capacity = capacity;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].node != NULL) {
+            records[findSlot(layout, old[i].node)] = old[i];
+        }
+    }
+
+    free(old);
+    return true;
+}
+
+// makes room for count records at a load of at most one half
+static bool reserve(treeLayout *layout, size_t count) {
+    size_t capacity = (layout->capacity > 0) ? layout->capacity : TL_MIN_CAPACITY;
+    while (capacity < 2 * count) {
+        capacity *= 2;
+    }
+    return capacity == layout->capacity || resize(layout, capacity);
+}
+
+// the record of node, added (and dirty) if it has none. NULL if the table could not grow
+static tlRecord *findOrAdd(treeLayout *layout, const treeNode *node) {
+    if (layout->capacity == 0 || 2 * (layout->count + 1) > layout->capacity) {
+        if (!reserve(layout, layout->count + 1)) {
+            return NULL;
+        }
+    }
+
+    tlRecord *record = &layout->records[findSlot(layout, node)];
+    if (record->node == NULL) {
+        memset(record, 0, sizeof(tlRecord));
+        record->node = node;
+        record->dirty = true;
+        layout->count++;
+    }
+    return record;
+}
+
+// deletes the record of node by shifting the records of its probe sequence back, so no tombstones are left
+static void removeRecord(treeLayout *layout, const treeNode *node) {
+    const size_t mask = layout->capacity - 1;
+    size_t hole = findSlot(layout, node);
+    if (layout->records[hole].node == NULL) {
+        return;
+    }
+
+    free(layout->records[hole].contour);
+    layout->count--;
+
+    for (size_t next = (hole + 1) & mask; layout->records[next].node != NULL; next = (next + 1) & mask) {
+        // a record may move back into the hole unless its home slot lies after the hole
+        const size_t home = homeSlot(layout, layout->records[next].node);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            layout->records[hole] = layout->records[next];
+            hole = next;
+        }
+    }
+    memset(&layout->records[hole], 0, sizeof(tlRecord));
+}
+
+// drops every record, for a layout from scratch
+static void clearRecords(treeLayout *layout) {
+    for (size_t i = 0; i < layout->capacity; i++) {
+        free(layout->records[i].contour);
+    }
+    if (layout->capacity > 0) {
+        memset(layout->records, 0, layout->capacity * sizeof(tlRecord));
+    }
+    layout->count = 0;
+}
+
+/* marks the subtrees that changed shape. Those of all the ancestors changed with the one of node, and the parent
+*  pointers lead to them only now, since a later rotation may move node below other nodes
+*/
+static void observe(void *context, rbEvent event, treeNode *node) {
+    treeLayout *layout = (treeLayout*)context;
+    if (layout->reset) {
+        return; // everything is laid out again anyway
+    }
+
+    if (event == RB_TREE_RESET) {
+        layout->reset = true;
+    } else if (event == RB_NODE_RELEASED) {
+        removeRecord(layout, node);
+    } else if (event != RB_NODE_COMPARED && event != RB_NODE_RECOLORED) { // comparisons and colors move nothing
+        for (; node != layout->tree->nil; node = node->parent) {
+            tlRecord *record = findOrAdd(layout, node);
+            if (record == NULL) {
+                layout->reset = true; // tlUpdate() starts over and reports the failure if it lasts
+                return;
+            }
+            record->dirty = true;
+        }
+    }
+}
+
+treeLayout *tlCreate(redBlackTree *tree) {
+    treeLayout *layout = (treeLayout*)malloc(sizeof(treeLayout));
+    if (layout == NULL) {
+        fprintf(stderr, "The memory allocation failed. The layout has not been created\n");
+        return NULL;
+    }
+
+    layout->tree = tree;
+    layout->records = NULL;
+    layout->capacity = 0;
+    layout->count = 0;
+    layout->reset = true; // nothing has been laid out yet
+    layout->recomputed = 0;
+    rbSetObserver(tree, observe, layout);
+
+    return layout;
+}
+
+void tlDestroy(treeLayout *layout) {
+    if (layout->tree->observer == observe && layout->tree->observerContext == layout) {
+        rbSetObserver(layout->tree, NULL, NULL);
+    }
+    clearRecords(layout);
+    free(layout->records);
+    free(layout);
+}
+
+/* lays out the dirty nodes of the subtree, children first. A clean record stands for a subtree that did not change,
+*  so the walk does not descend below it. The table never grows in here, so record pointers stay valid.
+*/
+static bool layoutSubtree(treeLayout *layout, const treeNode *node) {
+    const treeNode *nil = layout->tree->nil;
+    tlRecord *record = findOrAdd(layout, node);
+    if (!record->dirty) {
+        return true;
+    }
+
+    const tlRecord *left = NULL;
+    const tlRecord *right = NULL;
+    if (node->left != nil) {
+        if (!layoutSubtree(layout, node->left)) {
+            return false;
+        }
+        left = tlNode(layout, node->left);
+    }
+    if (node->right != nil) {
+        if (!layoutSubtree(layout, node->right)) {
+            return false;
+        }
+        right = tlNode(layout, node->right);
+    }
+
+    const int leftHeight = (left != NULL) ? left->height : 0;
+    const int rightHeight = (right != NULL) ? right->height : 0;
+    const int height = 1 + ((leftHeight > rightHeight) ? leftHeight : rightHeight);
+    if (record->levels < height) {
+        int *contour = (int*)realloc(record->contour, 2 * (size_t)height * sizeof(int));
+        if (contour == NULL) {
+            return false;
+        }
+        record->contour = contour;
+        record->levels = height;
+    }
+
+    // the subtrees are pushed apart until they are TL_SEPARATION apart on the level where they come closest
+    int offset = 0;
+    if (left != NULL && right != NULL) {
+        int overlap = 0;
+        const int shared = (leftHeight < rightHeight) ? leftHeight : rightHeight;
+        for (int level = 0; level < shared; level++) {
+            const int distance = RIGHT(left, level) - LEFT(right, level);
+            if (distance > overlap) {
+                overlap = distance;
+            }
+        }
+        offset = (TL_SEPARATION + overlap + 1) / 2;
+    } else if (left != NULL || right != NULL) {
+        offset = TL_SEPARATION / 2;
+    }
+
+    // the outermost node of a level comes from the subtree on that side, unless that subtree is not as deep
+    LEFT(record, 0) = 0;
+    RIGHT(record, 0) = 0;
+    record->minX = 0;
+    record->maxX = 0;
+    for (int level = 1; level < height; level++) {
+        LEFT(record, level) = (level <= leftHeight) ? LEFT(left, level - 1) - offset : LEFT(right, level - 1) + offset;
+        RIGHT(record, level) = (level <= rightHeight) ? RIGHT(right, level - 1) + offset : RIGHT(left, level - 1) - offset;
+        if (LEFT(record, level) < record->minX) {
+            record->minX = LEFT(record, level);
+        }
+        if (RIGHT(record, level) > record->maxX) {
+            record->maxX = RIGHT(record, level);
+        }
+    }
+
+    record->offset = offset;
+    record->height = height;
+    record->dirty = false;
+    layout->recomputed++;
+
+    return true;
+}
+
+bool tlUpdate(treeLayout *layout) {
+    redBlackTree *tree = layout->tree;
+
+    if (layout->reset) {
+        clearRecords(layout);
+    }
+
+    // every node of the tree may need a record, and adding them must not move the records being laid out
+    if (!reserve(layout, tree->root->subtreeSize + 1) || (tree->root != tree->nil && !layoutSubtree(layout, tree->root))) {
+        fprintf(stderr, "The memory allocation failed. The tree has not been laid out\n");
+        layout->reset = true;
+        return false;
+    }
+
+    layout->reset = false;
+    return true;
+}
+
+const tlRecord *tlNode(const treeLayout *layout, const treeNode *node) {
+    if (layout->capacity == 0) {
+        return NULL;
+    }
+
+    const tlRecord *record = &layout->records[findSlot(layout, node)];
+    return (record->node != NULL) ? record : NULL;
+}
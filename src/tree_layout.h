@@ -0,0 +1,100 @@
+#ifndef TREE_LAYOUT
+#define TREE_LAYOUT
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "red_black_tree.h"
+
+/* NOTE: a tidy drawing of a redBlackTree in the manner of Reingold and Tilford. Every node is centered above its
+*  children, the two subtrees of a node are pushed apart just far enough that no two nodes on the same level come
+*  closer than TL_SEPARATION, and a lone child sits TL_SEPARATION / 2 to the side of its parent. This packs the
+*  tree much tighter than giving every key a column of its own, while nodes still never overlap.
+*
+*  Positions are kept relative to the parent: the children of a node lie offset units to its left and right, so
+*  the x of a node is the sum of the offsets on its path from the root (at 0), and its y is its depth. The offset of
+*  a node follows from the right contour of its left subtree and the left contour of its right subtree, i.e. the
+*  outermost x on each of their levels, so every subtree keeps its contours. Laying out a node then costs O(height
+*  of its subtree), and the whole tree O(n), since the subtree heights of a balanced tree add up to O(n).
+*
+*  The layout follows the changes to its tree through rbSetObserver(). A change marks the nodes whose subtrees
+*  changed shape, which are the nodes rotated and their ancestors, and tlUpdate() lays out only those again, which
+*  is O(log^2(n)) for each rbInsert() or rbDelete(). treeNode has no room for a layout, so the records live in a
+*  hash table keyed by the address of the node.
+*/
+
+#define TL_SEPARATION 2 // smallest distance between two nodes on the same level, in layout units
+#define TL_MIN_CAPACITY 64 // smallest number of slots of the hash table
+
+typedef struct tlRecord {
+    const treeNode *node; // NULL for an empty slot of the table
+    int offset; // the children of the node are this many units to its left and right
+    int height; // levels of the subtree rooted at the node
+    int minX; // leftmost x of the subtree, relative to the node
+    int maxX; // rightmost x of the subtree, relative to the node
+    bool dirty; // the subtree changed shape since it was laid out
+    int levels; // levels the contour has room for
+    int *contour; // the leftmost and the rightmost x relative to the node, for each level of the subtree
+} tlRecord;
+
+typedef struct treeLayout {
+    redBlackTree *tree;
+    tlRecord *records; // open addressing with linear probing, capacity is a power of two
+    size_t capacity;
+    size_t count;
+    bool reset; // every record is stale, as after a bulk operation or an allocation failure
+    unsigned long long recomputed; // nodes laid out by tlUpdate(), for tests and benchmarks
+} treeLayout;
+
+/**
+ * @brief Creates the layout of a tree and becomes the observer of the tree.
+ *
+ * Nothing is laid out before the first tlUpdate().
+ *
+ * Runs in O(1).
+ *
+ * @note A tree has one observer, so the layout replaces any observer set before. tlDestroy() must be called before
+ * the tree is destroyed.
+ *
+ * @param *tree The redBlackTree being laid out.
+ *
+ * @return A pointer to the treeLayout, unless memory allocation failed in which case an error message is printed
+ * and NULL is returned.
+*/
+treeLayout *tlCreate(redBlackTree *tree);
+
+/**
+ * @brief Stops observing the tree and frees the layout.
+ *
+ * Runs in O(n).
+ *
+ * @param *layout The treeLayout being freed.
+ *
+ * @return Nothing.
+*/
+void tlDestroy(treeLayout *layout);
+
+/**
+ * @brief Lays out the nodes whose subtrees changed shape since the last call, and the nodes added since.
+ *
+ * Runs in O(n) after tlCreate() or an RB_TREE_RESET, otherwise O(log^2(n)) for each change to the tree.
+ *
+ * @param *layout The treeLayout being brought up to date.
+ *
+ * @return true on success. If memory allocation failed, an error message is printed and false is returned; the
+ * next call starts over.
+*/
+bool tlUpdate(treeLayout *layout);
+
+/**
+ * @brief Finds the record of a node, with its offset and the extent of its subtree.
+ *
+ * Runs in O(1) on average.
+ *
+ * @param *layout The treeLayout, as of the last tlUpdate().
+ * @param *node The treeNode looked up.
+ *
+ * @return A pointer to the record, valid until the tree or the layout change, or NULL if the node has no record.
+*/
+const tlRecord *tlNode(const treeLayout *layout, const treeNode *node);
+
+#endif
@@ -0,0 +1,293 @@
+#include "tree_serialization.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+// next node of a preorder walk, climbing the parent pointers once a subtree is done
+static treeNode *preorderNext(const redBlackTree *tree, treeNode *node) {
+    if (node->left != tree->nil) {
+        return node->left;
+    }
+    if (node->right != tree->nil) {
+        return node->right;
+    }
+
+    // climb until node is a left child whose parent still has a right subtree to visit
+    while (node->parent != tree->nil && (node == node->parent->right || node->parent->right == tree->nil)) {
+        node = node->parent;
+    }
+    return (node->parent == tree->nil) ? tree->nil : node->parent->right;
+}
+
+bool rbSaveTree(const redBlackTree *tree, const char *path) {
+    return rbSaveTreeAt(tree, path, 0);
+}
+
+bool rbSaveTreeAt(const redBlackTree *tree, const char *path, uint64_t sequence) {
+    const size_t count = tree->root->subtreeSize;
+    if (count > RB_SNAPSHOT_MAX_NODES) {
+        fprintf(stderr, "The tree is too large for a snapshot. The tree has not been saved\n");
+        return false;
+    }
+
+    FILE *file = fopen(path, "wb"); // flawfinder: ignore (the caller chooses the path to write)
+    if (file == NULL) {
+        fprintf(stderr, "The snapshot file could not be opened. The tree has not been saved\n");
+        return false;
+    }
+
+    rbSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RB_SNAPSHOT_MAGIC, sizeof(header.magic)); // flawfinder: ignore (the magic is 8 bytes)
+    header.version = RB_SNAPSHOT_VERSION;
+    header.nodeSize = sizeof(rbPackedNode);
+    header.count = count;
+    header.blackHeight = tree->blackHeight;
+    header.byteOrder = RB_SNAPSHOT_BYTE_ORDER;
+    header.sequence = sequence;
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    rbPackedNode buffer[RB_SNAPSHOT_BUFFER_NODES];
+    size_t buffered = 0;
+    uint32_t index = 0;
+
+    for (treeNode *node = tree->root; written && node != tree->nil; node = preorderNext(tree, node)) {
+        // the left subtree comes right after the node, and the right subtree right after that
+        const uint32_t right = (node->right == tree->nil) ? 0 : index + 1 + (uint32_t)node->left->subtreeSize;
+
+        buffer[buffered].key = node->key;
+        buffer[buffered].link = right | ((node->color == BLACK) ? RB_PACKED_BLACK : 0) |
+                                ((node->left != tree->nil) ? RB_PACKED_LEFT : 0);
+        buffered++;
+        index++;
+
+        if (buffered == RB_SNAPSHOT_BUFFER_NODES) {
+            written = (fwrite(buffer, sizeof(rbPackedNode), buffered, file) == buffered);
+            buffered = 0;
+        }
+    }
+    if (written && buffered > 0) {
+        written = (fwrite(buffer, sizeof(rbPackedNode), buffered, file) == buffered);
+    }
+
+    // fclose() flushes the last of stdio's buffer, so it can fail too
+    if (fclose(file) != 0) {
+        written = false;
+    }
+    if (!written) {
+        fprintf(stderr, "The snapshot file could not be written. The tree has not been saved\n");
+    }
+
+    return written;
+}
+
+rbSnapshot *rbOpenSnapshot(const char *path) {
+    int fd = open(path, O_RDONLY); // flawfinder: ignore (the caller chooses the path to read)
+    if (fd < 0) {
+        fprintf(stderr, "The snapshot file could not be opened\n");
+        return NULL;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(rbSnapshotHeader)) {
+        fprintf(stderr, "The file is not a tree snapshot\n");
+        close(fd);
+        return NULL;
+    }
+
+    const size_t mappingSize = (size_t)status.st_size;
+    void *mapping = mmap(NULL, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "The snapshot file could not be mapped\n");
+        return NULL;
+    }
+
+    const rbSnapshotHeader *header = (const rbSnapshotHeader*)mapping;
+    if (memcmp(header->magic, RB_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != RB_SNAPSHOT_VERSION || header->nodeSize != sizeof(rbPackedNode) ||
+        header->byteOrder != RB_SNAPSHOT_BYTE_ORDER || header->count > RB_SNAPSHOT_MAX_NODES ||
+        header->count * sizeof(rbPackedNode) != mappingSize - sizeof(rbSnapshotHeader)) {
+        fprintf(stderr, "The file is not a tree snapshot of this version and byte order\n");
+        munmap(mapping, mappingSize);
+        return NULL;
+    }
+
+    rbSnapshot *snapshot = (rbSnapshot*)malloc(sizeof(rbSnapshot));
+    if (snapshot == NULL) {
+        fprintf(stderr, "The memory allocation failed. The snapshot has not been opened\n");
+        munmap(mapping, mappingSize);
+        return NULL;
+    }
+
+    snapshot->nodes = (const rbPackedNode*)((const char*)mapping + sizeof(rbSnapshotHeader));
+    snapshot->count = (size_t)header->count;
+    snapshot->blackHeight = header->blackHeight;
+    snapshot->sequence = header->sequence;
+    snapshot->mapping = mapping;
+    snapshot->mappingSize = mappingSize;
+
+    return snapshot;
+}
+
+bool rbSnapshotContains(const rbSnapshot *snapshot, int key) {
+    const rbPackedNode *nodes = snapshot->nodes;
+    const size_t count = snapshot->count;
+    size_t i = 0;
+
+    // child indices only ever grow, and anything that does not ends the search, so even a corrupt file terminates
+    while (i < count) {
+        const rbPackedNode node = nodes[i];
+        if (key == node.key) {
+            return true;
+        }
+
+        if (key < node.key) {
+            i = (node.link & RB_PACKED_LEFT) ? i + 1 : count;
+        } else {
+            const size_t right = node.link & RB_PACKED_RIGHT_MASK;
+            i = (right > i) ? right : count;
+        }
+    }
+
+    return false;
+}
+
+void rbCloseSnapshot(rbSnapshot *snapshot) {
+    munmap(snapshot->mapping, snapshot->mappingSize);
+    free(snapshot);
+}
+
+/* while the tree is rebuilt, a NULL child is one that is still to come. Every such node is on the path from the
+*  root to the node linked last, so this walk replaces them with nil and leaves a tree destroyTree() can handle
+*/
+static void abandonRebuild(redBlackTree *tree, treeNode *last) {
+    for (treeNode *node = last; node != tree->nil; node = node->parent) {
+        node->left = (node->left == NULL) ? tree->nil : node->left;
+        node->right = (node->right == NULL) ? tree->nil : node->right;
+    }
+}
+
+// a node whose children are all linked, so its subtree size is known
+static void finishNode(treeNode *node) {
+    node->subtreeSize = node->left->subtreeSize + node->right->subtreeSize + 1;
+}
+
+// links the nodes of a snapshot back into tree, returning false (with a message) if the snapshot is not valid
+static bool rebuildTree(redBlackTree *tree, const rbSnapshot *snapshot) {
+    treeNode *nil = tree->nil;
+    treeNode *last = nil; // the node linked last
+    int depth = 0; // BLACK nodes from the root down to last, last included
+
+    for (size_t i = 0; i < snapshot->count; i++) {
+        const rbPackedNode packed = snapshot->nodes[i];
+        treeNode *parent = last;
+
+        // unless the node is the left child of the one before it, last has no children to come, so climb to the
+        // nearest node still waiting for its right child
+        if (last == nil || last->left != NULL) {
+            while (parent != nil && parent->right != NULL) {
+                finishNode(parent);
+                depth -= (parent->color == BLACK);
+                parent = parent->parent;
+            }
+
+            // the root comes first and nothing comes after the last right subtree, and the parent, which comes
+            // right before its left subtree, has to have stored this node's index as its right child
+            const bool linked = (parent == nil) ? (i == 0) :
+                ((snapshot->nodes[i - 1 - parent->left->subtreeSize].link & RB_PACKED_RIGHT_MASK) == i);
+            if (!linked) {
+                fprintf(stderr, "The snapshot is corrupt: node %zu is not linked to the tree\n", i);
+                abandonRebuild(tree, last);
+                return false;
+            }
+        }
+
+        treeNode *node = rbAllocateNode(tree);
+        if (node == NULL) {
+            fprintf(stderr, "The memory allocation failed. The tree has not been loaded\n");
+            abandonRebuild(tree, last);
+            return false;
+        }
+
+        node->key = packed.key;
+        node->color = (packed.link & RB_PACKED_BLACK) ? BLACK : RED;
+        node->parent = parent;
+        node->left = (packed.link & RB_PACKED_LEFT) ? NULL : nil;
+        node->right = (packed.link & RB_PACKED_RIGHT_MASK) ? NULL : nil;
+        node->subtreeSize = 1;
+
+        if (parent == nil) {
+            tree->root = node;
+        } else if (parent->left == NULL) {
+            parent->left = node;
+        } else {
+            parent->right = node;
+        }
+        last = node;
+        depth += (node->color == BLACK);
+
+        // a RED node may not have a RED parent, and every path down to a missing child has the same BLACK count
+        const bool redRed = (node->color == RED && (parent == nil || parent->color == RED));
+        const bool reachesNil = (node->left == nil || node->right == nil);
+        if (redRed || (reachesNil && depth != snapshot->blackHeight)) {
+            fprintf(stderr, "The snapshot is corrupt: node %zu breaks the Red-Black properties\n", i);
+            abandonRebuild(tree, last);
+            return false;
+        }
+    }
+
+    // climb to the root, finishing every node on the way, none of which may still wait for a child
+    for (treeNode *node = last; node != nil; node = node->parent) {
+        if (node->left == NULL || node->right == NULL) {
+            fprintf(stderr, "The snapshot is corrupt: it ends before its last subtree\n");
+            abandonRebuild(tree, last);
+            return false;
+        }
+        finishNode(node);
+    }
+
+    if (tree->root == nil && snapshot->blackHeight != 0) {
+        fprintf(stderr, "The snapshot is corrupt: an empty tree has a black height\n");
+        return false;
+    }
+    tree->blackHeight = snapshot->blackHeight;
+
+    // the links are sound now, so the keys can be checked in order
+    for (treeNode *node = (tree->root == nil) ? nil : rbMinimum(tree, tree->root); node != nil;) {
+        treeNode *next = rbNext(tree, node);
+        if (next != nil && next->key < node->key) {
+            fprintf(stderr, "The snapshot is corrupt: its keys are out of order\n");
+            return false;
+        }
+        node = next;
+    }
+
+    return true;
+}
+
+redBlackTree *rbLoadTree(const char *path) {
+    rbSnapshot *snapshot = rbOpenSnapshot(path);
+    if (snapshot == NULL) {
+        return NULL;
+    }
+
+    redBlackTree *tree = initializeTree();
+    if (tree == NULL) {
+        rbCloseSnapshot(snapshot);
+        return NULL;
+    }
+
+    if (!rebuildTree(tree, snapshot)) {
+        destroyTree(tree);
+        tree = NULL;
+    }
+
+    rbCloseSnapshot(snapshot);
+    return tree;
+}
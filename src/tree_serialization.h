@@ -0,0 +1,153 @@
+#ifndef TREE_SERIALIZATION
+#define TREE_SERIALIZATION
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "red_black_tree.h"
+
+/* NOTE: a binary snapshot format for redBlackTree. A snapshot is an rbSnapshotHeader followed by one rbPackedNode
+*  per node in preorder, so the left child of a node (if it has one) is always the next node and only the index of
+*  the right child has to be stored. Together with the color that fits in 8 bytes per node, and the file holds no
+*  pointers, so it can be mapped with mmap() and searched where it lies: rbOpenSnapshot() only maps the file and
+*  checks the header, and the pages are read from disk as lookups touch them.
+*
+*  The format uses the byte order of the machine that wrote it; a snapshot from a machine with the other byte order
+*  is refused. Files are opened and mapped with POSIX calls.
+*/
+
+#define RB_SNAPSHOT_MAGIC "RBTSNAP" // 8 bytes with the terminating zero
+#define RB_SNAPSHOT_VERSION 2u // version 2 added the log sequence number
+#define RB_SNAPSHOT_BYTE_ORDER 0x01020304u
+
+// the right child index takes the low 30 bits of rbPackedNode.link
+#define RB_SNAPSHOT_MAX_NODES ((1u << 30) - 1)
+#define RB_PACKED_BLACK (1u << 31) // the node is BLACK
+#define RB_PACKED_LEFT (1u << 30) // the node has a left child, which is the next node
+#define RB_PACKED_RIGHT_MASK ((1u << 30) - 1) // index of the right child, 0 if there is none (0 is the root)
+
+// nodes rbSaveTree() collects before each write
+#define RB_SNAPSHOT_BUFFER_NODES 4096
+
+typedef struct rbSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeSize; // sizeof(rbPackedNode)
+    uint64_t count;
+    int32_t blackHeight;
+    uint32_t byteOrder; // RB_SNAPSHOT_BYTE_ORDER as written by the saving machine
+    uint64_t sequence; // changes of a write-ahead log the snapshot includes, see write_ahead_log.h
+} rbSnapshotHeader;
+
+typedef struct rbPackedNode {
+    int32_t key;
+    uint32_t link; // RB_PACKED_BLACK | RB_PACKED_LEFT | index of the right child
+} rbPackedNode;
+
+// a snapshot file mapped read-only into memory
+typedef struct rbSnapshot {
+    const rbPackedNode *nodes; // in preorder, nodes[0] is the root
+    size_t count;
+    int blackHeight;
+    uint64_t sequence;
+    void *mapping;
+    size_t mappingSize;
+} rbSnapshot;
+
+/**
+ * @brief Writes a redBlackTree to a snapshot file.
+ *
+ * The tree is walked in preorder with the parent pointers and the nodes are written in blocks of
+ * RB_SNAPSHOT_BUFFER_NODES, so saving needs O(1) extra memory however large the tree is. The index of a node's
+ * right child is known without looking ahead, since it is the node's own index plus the size of its left subtree
+ * plus one.
+ *
+ * Runs in O(n).
+ *
+ * @note An existing file is overwritten in place. To replace a snapshot atomically, save to a temporary file and
+ * rename() it over the old one.
+ *
+ * @param *tree The redBlackTree being saved.
+ * @param *path The file to write.
+ *
+ * @return true on success. If the tree has more than RB_SNAPSHOT_MAX_NODES nodes or the file can not be written,
+ * an error message is printed and false is returned.
+*/
+bool rbSaveTree(const redBlackTree *tree, const char *path);
+
+/**
+ * @brief Writes a redBlackTree to a snapshot file like rbSaveTree(), recording a log sequence number with it.
+ *
+ * The sequence number is the number of write-ahead log records the tree already includes (see walCheckpoint()),
+ * so recovery knows which records to replay on top of the snapshot. rbSaveTree() records 0.
+ *
+ * Runs in O(n).
+ *
+ * @param *tree The redBlackTree being saved.
+ * @param *path The file to write.
+ * @param sequence The log sequence number stored in the header.
+ *
+ * @return true on success, otherwise an error message is printed and false is returned.
+*/
+bool rbSaveTreeAt(const redBlackTree *tree, const char *path, uint64_t sequence);
+
+/**
+ * @brief Maps a snapshot file read-only for rbSnapshotContains().
+ *
+ * Only the header is read and checked against the size of the file, so opening is O(1) however many nodes the
+ * snapshot holds. The nodes themselves are not checked; rbSnapshotContains() never leaves the mapping and always
+ * terminates even on a corrupt file.
+ *
+ * Runs in O(1).
+ *
+ * @param *path The snapshot file.
+ *
+ * @return A pointer to the rbSnapshot, or NULL if the file can not be mapped or is not a snapshot of this version
+ * and byte order (an error message is printed).
+*/
+rbSnapshot *rbOpenSnapshot(const char *path);
+
+/**
+ * @brief Searches a mapped snapshot for a key.
+ *
+ * The search goes down the stored tree the way rbTreeSearch() does, reading the nodes straight from the mapped
+ * pages.
+ *
+ * Runs in O(log(n)).
+ *
+ * @param *snapshot The rbSnapshot being searched.
+ * @param key The key being searched for.
+ *
+ * @return true if a node of the snapshot holds the key, otherwise false.
+*/
+bool rbSnapshotContains(const rbSnapshot *snapshot, int key);
+
+/**
+ * @brief Unmaps a snapshot and frees the rbSnapshot.
+ *
+ * Runs in O(1).
+ *
+ * @param *snapshot The rbSnapshot being closed.
+ *
+ * @return Nothing.
+*/
+void rbCloseSnapshot(rbSnapshot *snapshot);
+
+/**
+ * @brief Reads a snapshot file back into a redBlackTree that can be changed again.
+ *
+ * The nodes are linked up in preorder as they are read. A node that has no children left to come is finished and
+ * the walk climbs the parent pointers to the nearest node still waiting for its right child, so no stack is
+ * needed. On the way, every link, color and black height is checked, and the keys are checked to be in order at the
+ * end, so a corrupt file can not produce an invalid tree.
+ *
+ * Runs in O(n).
+ *
+ * @param *path The snapshot file.
+ *
+ * @return A pointer to the new redBlackTree, or NULL if the file is not a valid snapshot or a memory allocation
+ * failed (an error message is printed).
+*/
+redBlackTree *rbLoadTree(const char *path);
+
+#endif
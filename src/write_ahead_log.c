@@ -0,0 +1,452 @@
+#define _POSIX_C_SOURCE 200809L // ftruncate() and fdatasync() under -std=c11
+
+#include "write_ahead_log.h"
+#include "tree_serialization.h"
+
+#include "stdlib.h"
+#include "stdio.h"
+#include "string.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+
+// fdatasync() skips the metadata fsync() would also flush, where it is available
+#if defined(__linux__)
+#define walSyncFd(fd) fdatasync(fd)
+#else
+#define walSyncFd(fd) fsync(fd)
+#endif
+
+// CRC-32 (the polynomial of zlib), computed a bit at a time since frames are written once per group
+static uint32_t crc32(const unsigned char *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+// writes all of data, retrying short writes and interruptions
+static bool writeAll(int fd, const unsigned char *data, size_t length) {
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+// opens a file or directory just to sync it, which for a directory makes a rename() in it durable
+static bool syncPath(const char *path) {
+    int fd = open(path, O_RDONLY); // flawfinder: ignore (the path was just written by walCheckpoint())
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = (fsync(fd) == 0);
+    return (close(fd) == 0) && synced;
+}
+
+// syncs the directory holding path
+static bool syncDirectory(const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (slash == NULL) {
+        return syncPath(".");
+    }
+    if (slash == path) {
+        return syncPath("/");
+    }
+
+    const size_t length = (size_t)(slash - path);
+    char *directory = (char*)malloc(length + 1);
+    if (directory == NULL) {
+        return false;
+    }
+    memcpy(directory, path, length); // flawfinder: ignore (directory has room for length bytes and the zero)
+    directory[length] = '\0';
+
+    const bool synced = syncPath(directory);
+    free(directory);
+    return synced;
+}
+
+/* replaces the log file with one holding only a header whose first record is sequence. The new file is written and
+*  synced under a temporary name and renamed over the log, so a crash leaves either the old log or the new one whole
+*  and never a file without a header. log->fd goes on with the new file, positioned just past its header
+*/
+static bool resetLog(writeAheadLog *log, uint64_t sequence) {
+    rbWalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RB_WAL_MAGIC, sizeof(RB_WAL_MAGIC)); // flawfinder: ignore (the magic fits in 8 bytes)
+    header.version = RB_WAL_VERSION;
+    header.byteOrder = RB_SNAPSHOT_BYTE_ORDER;
+    header.firstSequence = sequence;
+
+    const size_t length = strlen(log->path) + sizeof(".tmp");
+    char *temporary = (char*)malloc(length);
+    if (temporary == NULL) {
+        return false;
+    }
+    snprintf(temporary, length, "%s.tmp", log->path);
+
+    const int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644); // flawfinder: ignore (next to the log)
+    if (fd < 0 || !writeAll(fd, (const unsigned char*)&header, sizeof(header)) || walSyncFd(fd) != 0 ||
+        rename(temporary, log->path) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(temporary);
+        free(temporary);
+        return false;
+    }
+    free(temporary);
+
+    // the old file is no longer in the directory, so nothing more is written to it
+    close(log->fd);
+    log->fd = fd;
+    return syncDirectory(log->path);
+}
+
+/* decodes the records of one frame, starting from *lastKey and *sequence. Only the records numbered from first on
+*  are applied, and only if tree is not NULL, so a frame can be checked completely before any of it is applied.
+*  Returns false if the records do not fill the frame exactly or a key leaves the range of int
+*/
+static bool replayFrame(const unsigned char *data, const rbWalFrameHeader *frame, int *lastKey, uint64_t *sequence,
+                        redBlackTree *tree, uint64_t first) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < frame->records; i++) {
+        uint64_t value = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (offset == frame->bytes || shift >= 7 * RB_WAL_RECORD_MAX_BYTES) {
+                return false;
+            }
+            byte = data[offset++];
+            value |= (uint64_t)(byte & 0x7Fu) << shift;
+            shift += 7;
+        } while (byte & 0x80u);
+
+        const unsigned op = (unsigned)(value & 1u);
+        const uint64_t zigzag = value >> 1;
+        const int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1u);
+        const int64_t key = (int64_t)*lastKey + delta;
+        if (key < INT32_MIN || key > INT32_MAX) {
+            return false;
+        }
+        *lastKey = (int)key;
+
+        if (tree != NULL && *sequence >= first) {
+            if (op == RB_WAL_INSERT) {
+                rbInsert(tree, (int)key);
+            } else {
+                treeNode *node = rbTreeSearch(tree, (int)key);
+                if (node != tree->nil) {
+                    rbDelete(tree, node);
+                }
+            }
+        }
+        (*sequence)++;
+    }
+
+    return offset == frame->bytes;
+}
+
+/* replays the frames of a mapped log file into tree from record number first on, returning the offset just past the
+*  last complete frame. The next sequence number and the key of the last record are left in *log
+*/
+static size_t replayLog(writeAheadLog *log, const unsigned char *data, size_t size, redBlackTree *tree,
+                        uint64_t first) {
+    size_t offset = sizeof(rbWalHeader);
+
+    while (size - offset >= sizeof(rbWalFrameHeader)) {
+        rbWalFrameHeader frame;
+        memcpy(&frame, data + offset, sizeof(frame)); // flawfinder: ignore (the frame header lies inside the file)
+        const unsigned char *records = data + offset + sizeof(frame);
+
+        // a torn frame ends the log: it runs past the end of the file or its records do not match the checksum
+        if (frame.bytes > size - offset - sizeof(frame) || crc32(records, frame.bytes) != frame.checksum) {
+            break;
+        }
+
+        int lastKey = log->lastKey;
+        uint64_t sequence = log->sequence;
+        if (!replayFrame(records, &frame, &lastKey, &sequence, NULL, first)) {
+            break;
+        }
+        replayFrame(records, &frame, &log->lastKey, &log->sequence, tree, first);
+        offset += sizeof(frame) + frame.bytes;
+    }
+
+    return offset;
+}
+
+writeAheadLog *walOpen(const char *path, redBlackTree *tree, uint64_t sequence, size_t groupCommit) {
+    writeAheadLog *log = (writeAheadLog*)malloc(sizeof(writeAheadLog));
+    if (log == NULL) {
+        fprintf(stderr, "The memory allocation failed. The log has not been opened\n");
+        return NULL;
+    }
+    log->groupCommit = (groupCommit == 0) ? 1 : groupCommit;
+    log->pending = 0;
+    log->unsynced = false;
+    log->failed = false;
+    log->lastKey = 0;
+    log->sequence = sequence;
+    log->syncs = 0;
+    log->buffered = 0;
+    log->frameRecords = 0;
+
+    // kept for resetLog(), which replaces the file
+    const size_t length = strlen(path) + 1;
+    log->path = (char*)malloc(length);
+    if (log->path == NULL) {
+        fprintf(stderr, "The memory allocation failed. The log has not been opened\n");
+        free(log);
+        return NULL;
+    }
+    memcpy(log->path, path, length); // flawfinder: ignore (log->path has room for the path and its zero)
+
+    log->fd = open(path, O_RDWR | O_CREAT, 0644); // flawfinder: ignore (the caller chooses the path to write)
+    struct stat status;
+    if (log->fd < 0 || fstat(log->fd, &status) != 0) {
+        fprintf(stderr, "The log file could not be opened\n");
+        if (log->fd >= 0) {
+            close(log->fd);
+        }
+        free(log->path);
+        free(log);
+        return NULL;
+    }
+
+    const size_t size = (size_t)status.st_size;
+    size_t end = 0;
+    if (size > 0) {
+        void *mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, log->fd, 0);
+        const rbWalHeader *header = (const rbWalHeader*)mapping;
+        if (mapping == MAP_FAILED || size < sizeof(rbWalHeader) ||
+            memcmp(header->magic, RB_WAL_MAGIC, sizeof(RB_WAL_MAGIC)) != 0 ||
+            header->version != RB_WAL_VERSION || header->byteOrder != RB_SNAPSHOT_BYTE_ORDER ||
+            header->firstSequence > sequence) {
+            fprintf(stderr, "The file is not a log of this version and byte order that goes on from the tree\n");
+            if (mapping != MAP_FAILED) {
+                munmap(mapping, size);
+            }
+            close(log->fd);
+            free(log->path);
+            free(log);
+            return NULL;
+        }
+
+        log->sequence = header->firstSequence;
+        end = replayLog(log, (const unsigned char*)mapping, size, tree, sequence);
+        munmap(mapping, size);
+    }
+
+    bool opened = true;
+    if (size == 0 || log->sequence <= sequence) {
+        // a new log, or one whose records the tree already includes all of (a checkpoint stopped before emptying it)
+        log->lastKey = 0;
+        log->sequence = sequence;
+        opened = resetLog(log, sequence);
+    } else if (end < size) {
+        // cut off the torn frame, so new frames follow the last complete one
+        opened = ftruncate(log->fd, (off_t)end) == 0 && walSyncFd(log->fd) == 0 &&
+                 lseek(log->fd, (off_t)end, SEEK_SET) == (off_t)end;
+    } else {
+        opened = lseek(log->fd, (off_t)end, SEEK_SET) == (off_t)end;
+    }
+
+    if (!opened) {
+        fprintf(stderr, "The log file could not be written\n");
+        close(log->fd);
+        free(log->path);
+        free(log);
+        return NULL;
+    }
+
+    return log;
+}
+
+redBlackTree *walRecover(const char *snapshotPath, const char *logPath, size_t groupCommit, writeAheadLog **log) {
+    *log = NULL;
+
+    redBlackTree *tree = NULL;
+    uint64_t sequence = 0;
+    struct stat status;
+    if (stat(snapshotPath, &status) == 0) {
+        rbSnapshot *snapshot = rbOpenSnapshot(snapshotPath);
+        if (snapshot == NULL) {
+            return NULL;
+        }
+        sequence = snapshot->sequence;
+        rbCloseSnapshot(snapshot);
+        tree = rbLoadTree(snapshotPath);
+    } else {
+        tree = initializeTree();
+    }
+    if (tree == NULL) {
+        return NULL;
+    }
+
+    *log = walOpen(logPath, tree, sequence, groupCommit);
+    if (*log == NULL) {
+        destroyTree(tree);
+        return NULL;
+    }
+
+    return tree;
+}
+
+// writes the records collected so far as one frame, without syncing it
+static bool writeFrame(writeAheadLog *log) {
+    if (log->buffered == 0) {
+        return true;
+    }
+
+    rbWalFrameHeader frame;
+    frame.bytes = (uint32_t)log->buffered;
+    frame.records = log->frameRecords;
+    frame.checksum = crc32(log->buffer + sizeof(frame), log->buffered);
+    memcpy(log->buffer, &frame, sizeof(frame)); // flawfinder: ignore (the buffer starts with room for it)
+
+    const bool written = writeAll(log->fd, log->buffer, sizeof(frame) + log->buffered);
+    log->buffered = 0;
+    log->frameRecords = 0;
+    log->unsynced = true;
+    return written;
+}
+
+bool walSync(writeAheadLog *log) {
+    if (!log->failed) {
+        log->failed = !writeFrame(log);
+    }
+    if (!log->failed && log->unsynced) {
+        log->failed = (walSyncFd(log->fd) != 0);
+        log->unsynced = false;
+        log->syncs++;
+    }
+    log->pending = 0;
+
+    if (log->failed) {
+        fprintf(stderr, "The log file could not be written. The latest changes are not durable\n");
+    }
+    return !log->failed;
+}
+
+// appends one record to the current frame, ending the frame when it is full and the group when it is complete
+static bool appendRecord(writeAheadLog *log, unsigned op, int key) {
+    if (log->failed) {
+        fprintf(stderr, "The log file could not be written. The latest changes are not durable\n");
+        return false;
+    }
+
+    // zigzag keeps small negative differences small, and the low bit holds the operation
+    const int64_t delta = (int64_t)key - (int64_t)log->lastKey;
+    uint64_t value = ((((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)) << 1) | op;
+    log->lastKey = key;
+
+    unsigned char *out = log->buffer + sizeof(rbWalFrameHeader) + log->buffered;
+    size_t length = 0;
+    while (value >= 0x80u) {
+        out[length++] = (unsigned char)(value | 0x80u);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+
+    log->buffered += length;
+    log->frameRecords++;
+    log->pending++;
+    log->sequence++;
+
+    if (log->pending >= log->groupCommit) {
+        return walSync(log);
+    }
+    if (log->buffered > RB_WAL_BUFFER_BYTES - RB_WAL_RECORD_MAX_BYTES) {
+        log->failed = !writeFrame(log);
+        if (log->failed) {
+            fprintf(stderr, "The log file could not be written. The latest changes are not durable\n");
+        }
+    }
+    return !log->failed;
+}
+
+bool walInsert(writeAheadLog *log, redBlackTree *tree, int key) {
+    // rbInsert() only prints an error when it runs out of memory, so the size tells whether the key went in
+    const size_t size = tree->root->subtreeSize;
+    rbInsert(tree, key);
+    if (tree->root->subtreeSize == size) {
+        return false; // nothing is logged, so recovery rebuilds the tree the caller has
+    }
+    return appendRecord(log, RB_WAL_INSERT, key);
+}
+
+bool walDelete(writeAheadLog *log, redBlackTree *tree, int key) {
+    treeNode *node = rbTreeSearch(tree, key);
+    if (node == tree->nil) {
+        return false;
+    }
+
+    const bool logged = appendRecord(log, RB_WAL_DELETE, key);
+    rbDelete(tree, node);
+    return logged;
+}
+
+bool walCheckpoint(writeAheadLog *log, const redBlackTree *tree, const char *snapshotPath) {
+    if (!walSync(log)) {
+        return false;
+    }
+
+    const size_t length = strlen(snapshotPath) + sizeof(".tmp");
+    char *temporary = (char*)malloc(length);
+    if (temporary == NULL) {
+        fprintf(stderr, "The memory allocation failed. The checkpoint has not been made\n");
+        return false;
+    }
+    snprintf(temporary, length, "%s.tmp", snapshotPath);
+
+    // the snapshot has to be on disk under its final name before the log may forget anything
+    if (!rbSaveTreeAt(tree, temporary, log->sequence)) {
+        unlink(temporary);
+        free(temporary);
+        return false;
+    }
+    if (!syncPath(temporary) || rename(temporary, snapshotPath) != 0 || !syncDirectory(snapshotPath)) {
+        fprintf(stderr, "The snapshot could not be made durable. The checkpoint has not been made\n");
+        unlink(temporary);
+        free(temporary);
+        return false;
+    }
+    free(temporary);
+
+    if (!resetLog(log, log->sequence)) {
+        // recovery is sound with the old log or the new one, but it is not known which one stays
+        log->failed = true;
+        fprintf(stderr, "The log file could not be emptied. The latest changes are not durable\n");
+        return false;
+    }
+    log->lastKey = 0;
+    log->unsynced = false;
+    return true;
+}
+
+bool walClose(writeAheadLog *log) {
+    bool closed = walSync(log);
+    if (close(log->fd) != 0) {
+        fprintf(stderr, "The log file could not be closed\n");
+        closed = false;
+    }
+    free(log->path);
+    free(log);
+    return closed;
+}
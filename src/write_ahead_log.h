@@ -0,0 +1,170 @@
+#ifndef WRITE_AHEAD_LOG
+#define WRITE_AHEAD_LOG
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "red_black_tree.h"
+
+/* NOTE: a write-ahead log that makes the changes to a redBlackTree durable. walInsert() and walDelete() append a
+*  record to an in-memory frame and change the tree; once groupCommit records are pending, the frame is written and
+*  the file is flushed to disk with a single fsync (group commit), so the cost of the sync is shared by the whole
+*  group. A record is one varint holding the operation and the zigzag encoded difference to the previous key, which
+*  is 1 or 2 bytes for keys that are close together.
+*
+*  Every frame carries its record count and a CRC-32 of its records, so recovery applies whole frames only and stops
+*  at a frame that was torn by a crash. Records are numbered from the start of the log; a snapshot saved by
+*  walCheckpoint() stores the number of records it includes (see rbSaveTreeAt()), so recovery replays exactly the
+*  records that came after it, even if a crash hit the checkpoint halfway. Files are written with POSIX calls.
+*/
+
+#define RB_WAL_MAGIC "RBTWAL" // 8 bytes with the terminating zeros
+#define RB_WAL_VERSION 1u
+#define RB_WAL_BUFFER_BYTES 65536 // records collected in memory before a frame is written
+#define RB_WAL_RECORD_MAX_BYTES 5 // a varint of up to 34 bits
+
+#define RB_WAL_INSERT 0u
+#define RB_WAL_DELETE 1u
+
+typedef struct rbWalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // RB_SNAPSHOT_BYTE_ORDER as written by the logging machine
+    uint64_t firstSequence; // sequence number of the first record in the file
+} rbWalHeader;
+
+typedef struct rbWalFrameHeader {
+    uint32_t bytes; // bytes of records following the frame header
+    uint32_t records;
+    uint32_t checksum; // CRC-32 of the records
+} rbWalFrameHeader;
+
+typedef struct writeAheadLog {
+    int fd;
+    char *path; // the log file, which walCheckpoint() replaces with an empty one
+    size_t groupCommit; // records per fsync
+    size_t pending; // records appended since the last fsync
+    bool unsynced; // frames were written since the last fsync
+    bool failed; // a write or sync failed, so the file may end in a torn frame and nothing more is logged
+    int lastKey; // the key of the last record, which the next one is encoded against
+    uint64_t sequence; // sequence number of the next record
+    uint64_t syncs; // fsyncs done, for benchmarks
+    size_t buffered; // bytes of records in the current frame
+    uint32_t frameRecords; // records in the current frame
+    unsigned char buffer[sizeof(rbWalFrameHeader) + RB_WAL_BUFFER_BYTES];
+} writeAheadLog;
+
+/**
+ * @brief Opens a log file for appending, first replaying the records it already holds into a tree.
+ *
+ * Every record from the given sequence number on is applied to the tree with rbInsert() or rbDelete(). The replay
+ * stops at the first torn or corrupt frame, which is cut off together with everything after it, so the records
+ * appended from now on follow the last complete frame. A missing file is created.
+ *
+ * Runs in O(r log(n)) for the r records replayed.
+ *
+ * @param *path The log file.
+ * @param *tree The redBlackTree the log belongs to, as of the given sequence number.
+ * @param sequence The number of records the tree already includes, which is snapshot->sequence for a tree loaded
+ * from a snapshot and 0 for an empty tree.
+ * @param groupCommit The number of records after which the log is synced to disk. 0 and 1 sync every record.
+ *
+ * @return A pointer to the writeAheadLog, or NULL if the file can not be opened, is not a log, or starts after the
+ * given sequence number so records are missing (an error message is printed).
+*/
+writeAheadLog *walOpen(const char *path, redBlackTree *tree, uint64_t sequence, size_t groupCommit);
+
+/**
+ * @brief Loads the last snapshot and replays the log on top of it.
+ *
+ * A convenience for rbLoadTree() and walOpen(). If the snapshot file does not exist, the tree starts empty and the
+ * whole log is replayed.
+ *
+ * Runs in O(n + r log(n)) for a snapshot of n nodes and r records replayed.
+ *
+ * @param *snapshotPath The snapshot file written by walCheckpoint().
+ * @param *logPath The log file.
+ * @param groupCommit The number of records after which the log is synced to disk.
+ * @param **log Receives the opened writeAheadLog.
+ *
+ * @return A pointer to the recovered redBlackTree, or NULL (with *log set to NULL) if the snapshot or the log can
+ * not be read (an error message is printed).
+*/
+redBlackTree *walRecover(const char *snapshotPath, const char *logPath, size_t groupCommit, writeAheadLog **log);
+
+/**
+ * @brief Logs an insertion and inserts the key with rbInsert().
+ *
+ * The record is durable once the group it belongs to is synced, which happens in this call for every groupCommit-th
+ * record, or with walSync().
+ *
+ * Runs in O(log(n)), plus the write and fsync at the end of a group.
+ *
+ * @param *log The writeAheadLog of the tree.
+ * @param *tree The redBlackTree being changed.
+ * @param key The key being inserted.
+ *
+ * @return true on success. If the key could not be inserted, an error message is printed, nothing is logged and
+ * false is returned. If the log could not be written, an error message is printed and false is returned; the key has
+ * been inserted in memory all the same.
+*/
+bool walInsert(writeAheadLog *log, redBlackTree *tree, int key);
+
+/**
+ * @brief Logs a deletion and deletes a node holding the key with rbDelete().
+ *
+ * Nothing is logged if the key is not in the tree.
+ *
+ * Runs in O(log(n)), plus the write and fsync at the end of a group.
+ *
+ * @param *log The writeAheadLog of the tree.
+ * @param *tree The redBlackTree being changed.
+ * @param key The key being deleted.
+ *
+ * @return true if a node was deleted and the log written. false if the key is not in the tree, or if the log could
+ * not be written (an error message is printed; the node has been deleted in memory all the same).
+*/
+bool walDelete(writeAheadLog *log, redBlackTree *tree, int key);
+
+/**
+ * @brief Writes the pending records and syncs the log to disk, ending the current group early.
+ *
+ * Runs in O(1), plus the write and fsync.
+ *
+ * @param *log The writeAheadLog being synced.
+ *
+ * @return true on success, otherwise an error message is printed and false is returned.
+*/
+bool walSync(writeAheadLog *log);
+
+/**
+ * @brief Saves a snapshot of the tree and empties the log, so recovery only has to replay what comes after.
+ *
+ * The log is synced, the tree is saved with rbSaveTreeAt() to a temporary file next to the snapshot, which is synced
+ * and renamed over the old snapshot, and only then is the log replaced the same way by an empty one. A crash at any
+ * point leaves a snapshot and a log that recover to the same tree, since recovery skips the records the snapshot
+ * already includes.
+ *
+ * Runs in O(n).
+ *
+ * @param *log The writeAheadLog of the tree.
+ * @param *tree The redBlackTree being saved.
+ * @param *snapshotPath The snapshot file.
+ *
+ * @return true on success, otherwise an error message is printed and false is returned; the snapshot and the log
+ * then still recover every record synced so far.
+*/
+bool walCheckpoint(writeAheadLog *log, const redBlackTree *tree, const char *snapshotPath);
+
+/**
+ * @brief Syncs the pending records, closes the log file and frees the writeAheadLog.
+ *
+ * Runs in O(1), plus the write and fsync.
+ *
+ * @param *log The writeAheadLog being closed.
+ *
+ * @return true if the last records were synced, otherwise an error message is printed and false is returned.
+*/
+bool walClose(writeAheadLog *log);
+
+#endif
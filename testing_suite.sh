@@ -3,8 +3,11 @@ BIRed='\033[1;91m'
 BIPurple='\033[1;35m'
 NC='\033[0m'
 
-# NOTE: This script is only intended to test the functionality of the red-black tree data structure itself, not the gui. When running this
-#       script, gui related functions should be commented out of red_black_tree.c
+# every source file of the tree itself, i.e. everything in src/ except the GTK front end
+CORE_SOURCES="./src/red_black_tree.c ./src/array_tree.c ./src/top_down_tree.c ./src/concurrent_tree.c ./src/persistent_tree.c ./src/bulk_operations.c ./src/tree_serialization.c ./src/write_ahead_log.c ./src/tree_layout.c ./src/event_log.c"
+
+# NOTE: This script is only intended to test the functionality of the red-black tree data structure itself, not the gui. The tree sources
+#       do not depend on GTK, so the unit tests are built without it.
 
 echo -e "${BIPurple}Running static analysis suite...\n"
 
@@ -39,7 +42,7 @@ else
 fi
 
 echo -e "${NC}Running scan-build static analysis..."
-scan-build gcc -g3 ./unit_tests/*.c ./src/red_black_tree.c ./src/gtkBackend.c -I./src `pkg-config --cflags --libs gtk+-3.0` > scan-build_report.txt # report should include "No bugs found" if passed
+scan-build gcc -g3 -pthread ./unit_tests/*.c ${CORE_SOURCES} ./src/gtkBackend.c -I./src `pkg-config --cflags --libs gtk+-3.0` > scan-build_report.txt # report should include "No bugs found" if passed
 if grep -Fq "No bugs found" scan-build_report.txt; then
     echo -e "${BGreen}scan-build static analysis passed."
     rm scan-build_report.txt
@@ -51,7 +54,7 @@ fi
 echo -e "${BIPurple}\nRunning dynamic analysis suite...\n"
 
 echo -e "${NC}Running valgrind dynamic analysis..."
-gcc -g3 ./unit_tests/*.c ./src/red_black_tree.c -I./src `pkg-config --cflags --libs gtk+-3.0`
+gcc -g3 -pthread ./unit_tests/*.c ${CORE_SOURCES} -I./src
 valgrind -s --log-file=valgrind_report.txt --leak-check=full --show-reachable=yes --track-origins=yes ./a.out > /dev/null
 if grep -Fq "no leaks are possible" valgrind_report.txt  && grep -Fq "0 errors from 0 contexts" valgrind_report.txt; then
     echo -e "${BGreen}valgrind dynamic analysis passed."
@@ -62,7 +65,7 @@ else
 fi
 
 echo -e "${NC}Running address and leak sanitizer dynamic analysis..."
-gcc -fsanitize=address -fsanitize=leak ./unit_tests/*.c src/red_black_tree.c -g3 -I./src `pkg-config --cflags --libs gtk+-3.0`
+gcc -pthread -fsanitize=address -fsanitize=leak ./unit_tests/*.c ${CORE_SOURCES} -g3 -I./src
 if [ -s sanitizer_report.txt ]; then
     echo -e "${BIRed}Issues found by sanitizers."
     cat sanitizer_report.txt
@@ -72,7 +75,7 @@ fi
 
 echo -e "${BIPurple}\nRunning unit tests..."
 echo -e "${NC}"
-gcc ./unit_tests/*.c ./src/red_black_tree.c -I./src `pkg-config --cflags --libs gtk+-3.0` > /dev/null
+gcc -pthread ./unit_tests/*.c ${CORE_SOURCES} -I./src > /dev/null
 ./a.out
 
 echo -e "${BIPurple}\nTest suite finished"
@@ -1,7 +1,64 @@
 #include "red_black_tree.h"
+#include "array_tree.h"
+#include "top_down_tree.h"
+#include "concurrent_tree.h"
+#include "persistent_tree.h"
+#include "bulk_operations.h"
+#include "tree_serialization.h"
+#include "write_ahead_log.h"
+#include "tree_layout.h"
+#include "event_log.h"
 #include "unit_tests.h"
 #include "assert.h"
 #include "stdio.h"
+#include "string.h"
+#include "pthread.h"
+#include "unistd.h"
+
+#define RB_MAP_NAME intMap
+#define RB_MAP_KEY int
+#define RB_MAP_VALUE double
+#include "rb_map.h"
+
+#define RB_MAP_NAME stringMap
+#define RB_MAP_KEY const char*
+#define RB_MAP_VALUE int
+#define RB_MAP_LESS(a, b) (strcmp((a), (b)) < 0)
+#define RB_MAP_EQUAL(a, b) (strcmp((a), (b)) == 0)
+#include "rb_map.h"
+
+// returns the black height of the subtree rooted at node, asserting the Red-Black and BST properties on the way
+static int checkSubtree(redBlackTree *tree, treeNode *node) {
+    if (node == tree->nil) {
+        return 0;
+    }
+
+    if (node->color == RED) {
+        assert(node->left->color == BLACK);
+        assert(node->right->color == BLACK);
+    }
+    if (node->left != tree->nil) {
+        assert(node->left->parent == node);
+        assert(node->left->key <= node->key);
+    }
+    if (node->right != tree->nil) {
+        assert(node->right->parent == node);
+        assert(node->right->key >= node->key);
+    }
+
+    int leftBlackHeight = checkSubtree(tree, node->left);
+    int rightBlackHeight = checkSubtree(tree, node->right);
+    assert(leftBlackHeight == rightBlackHeight);
+    assert(node->subtreeSize == node->left->subtreeSize + node->right->subtreeSize + 1);
+
+    return leftBlackHeight + (node->color == BLACK ? 1 : 0);
+}
+
+static void checkTree(redBlackTree *tree) {
+    assert(tree->root->color == BLACK);
+    assert(tree->root == tree->nil || tree->root->parent == tree->nil);
+    assert(checkSubtree(tree, tree->root) == rbBlackHeight(tree));
+}
 
 void testInsertMaxMin() {
     redBlackTree* tree = initializeTree();
@@ -170,6 +227,97 @@ void testSearch() {
     printf("testSearch passed.\n");
 }
 
+void testSearchBatch() {
+    redBlackTree *tree = initializeTree();
+
+    int keys[100];
+    treeNode *found[100];
+
+    // nothing is found in an empty tree
+    for (int i = 0; i < 100; i++) {
+        keys[i] = i;
+    }
+    rbTreeSearchBatch(tree, keys, 100, found);
+    for (int i = 0; i < 100; i++) {
+        assert(found[i] == tree->nil);
+    }
+
+    for (int i = 0; i < 500; i += 2) {
+        rbInsert(tree, (i * 7) % 500);
+    }
+
+    // a count that is not a multiple of the group size, mixing hits and misses
+    for (int i = 0; i < 99; i++) {
+        keys[i] = (i * 13) % 501;
+    }
+    rbTreeSearchBatch(tree, keys, 99, found);
+    for (int i = 0; i < 99; i++) {
+        assert(found[i] == rbTreeSearch(tree, keys[i]));
+    }
+
+    destroyTree(tree);
+
+    printf("testSearchBatch passed.\n");
+}
+
+void testStats() {
+    redBlackTree *tree = initializeTree();
+    rbStats stats;
+
+    // ascending keys always take the mirrored insert case 3, one left rotation each time
+    for (int i = 0; i < 3; i++) {
+        rbInsert(tree, i);
+    }
+    rbTreeSearch(tree, 2);
+    rbTreeSearch(tree, 5);
+
+    rbGetStats(tree, &stats);
+#ifdef RB_ENABLE_STATS
+    assert(stats.leftRotations == 1);
+    assert(stats.rightRotations == 0);
+    assert(stats.insertCases[0] == 0 && stats.insertCases[1] == 0 && stats.insertCases[2] == 1);
+    assert(stats.insertFixupIterations == 1);
+    assert(stats.searches == 2);
+    assert(stats.searchPathLength == 4); // 1 then 2 for the hit, 1 then 2 for the miss
+
+    // the batch search visits the same nodes as the single searches
+    int keys[2] = {2, 5};
+    treeNode *found[2];
+    rbResetStats(tree);
+    rbTreeSearchBatch(tree, keys, 2, found);
+    rbGetStats(tree, &stats);
+    assert(stats.searches == 2);
+    assert(stats.searchPathLength == 4);
+
+    // each insert fixup iteration ends in case 1 or case 3, and only cases 2 and 3 rotate
+    rbResetStats(tree);
+    for (int i = 0; i < 500; i++) {
+        rbInsert(tree, 3 + (i * 37) % 500);
+    }
+    rbGetStats(tree, &stats);
+    assert(stats.insertFixupIterations >= stats.insertCases[0] + stats.insertCases[2]);
+    assert(stats.leftRotations + stats.rightRotations == stats.insertCases[1] + stats.insertCases[2]);
+
+    // each delete fixup iteration ends in case 2 or case 4, and cases 1, 3 and 4 rotate
+    rbResetStats(tree);
+    for (int i = 0; i < 400; i++) {
+        rbDelete(tree, rbTreeSearch(tree, 3 + (i * 37) % 500));
+    }
+    rbGetStats(tree, &stats);
+    assert(stats.deleteFixupIterations == stats.deleteCases[1] + stats.deleteCases[3]);
+    assert(stats.leftRotations + stats.rightRotations ==
+           stats.deleteCases[0] + stats.deleteCases[2] + stats.deleteCases[3]);
+    checkTree(tree);
+#else
+    // without RB_ENABLE_STATS nothing is counted
+    assert(stats.leftRotations == 0 && stats.searches == 0 && stats.insertCases[2] == 0);
+#endif
+
+    destroyTree(tree);
+
+    printf("testStats passed.\n");
+}
+
 void testSizeHeight() {
     redBlackTree *tree = initializeTree();
 
@@ -207,6 +355,1333 @@ void testSizeHeight() {
     printf("testSizeHeight passed.\n");
 }
 
+// recursive reference for height()
+static int referenceHeight(redBlackTree *tree, treeNode *node) {
+    if (node == tree->nil) {
+        return -1;
+    }
+    const int leftHeight = referenceHeight(tree, node->left);
+    const int rightHeight = referenceHeight(tree, node->right);
+    return 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+}
+
+void testDeepSubtree() {
+    redBlackTree *tree = initializeTree();
+
+    // height() of every subtree of a real tree matches the recursive definition
+    for (int i = 0; i < 2000; i++) {
+        rbInsert(tree, (i * 613) % 1000);
+    }
+    for (treeNode *node = rbMinimum(tree, tree->root); node != tree->nil; node = rbNext(tree, node)) {
+        assert(height(tree, node) == referenceHeight(tree, node));
+    }
+
+    // a zig-zag chain far deeper than any Red-Black tree gets, which would overflow a recursive walk
+    enum {DEPTH = 1000000};
+    treeNode *top = rbAllocateNode(tree);
+    top->parent = tree->nil;
+    top->left = top->right = tree->nil;
+    treeNode *bottom = top;
+    for (int i = 1; i < DEPTH; i++) {
+        treeNode *node = rbAllocateNode(tree);
+        node->left = node->right = tree->nil;
+        node->parent = bottom;
+        if (i % 2) {
+            bottom->left = node;
+        } else {
+            bottom->right = node;
+        }
+        bottom = node;
+    }
+
+    assert(height(tree, top) == DEPTH - 1);
+    assert(height(tree, bottom->parent) == 1);
+
+    // released without recursion, and handed out again by the pool
+    destroyTreeHelper(tree, top);
+    for (int i = 0; i < 100; i++) {
+        rbInsert(tree, i);
+    }
+    checkTree(tree);
+
+    destroyTree(tree);
+
+    printf("testDeepSubtree passed.\n");
+}
+
+void testBlackHeight() {
+    redBlackTree *tree = initializeTree();
+    assert(rbBlackHeight(tree) == 0);
+    assert(rbHeightBound(tree) == -1);
+
+    // the counter has to follow every growth on the way up and every shrink on the way back down to empty
+    for (int i = 0; i < 3000; i++) {
+        rbInsert(tree, (i * 1543) % 3000);
+        checkTree(tree);
+        const int treeHeight = height(tree, tree->root);
+        assert(rbBlackHeight(tree) - 1 <= treeHeight && treeHeight <= rbHeightBound(tree));
+    }
+    for (int i = 0; i < 3000; i++) {
+        rbDelete(tree, rbTreeSearch(tree, (i * 2003) % 3000));
+        checkTree(tree);
+        assert(height(tree, tree->root) <= rbHeightBound(tree));
+    }
+    assert(rbBlackHeight(tree) == 0);
+    destroyTree(tree);
+
+    // built trees start out with the right count too
+    for (int count = 0; count < 70; count++) {
+        int keys[70];
+        for (int i = 0; i < count; i++) {
+            keys[i] = i;
+        }
+        tree = rbBuildFromSorted(keys, (size_t)count);
+        checkTree(tree);
+        destroyTree(tree);
+    }
+
+    printf("testBlackHeight passed.\n");
+}
+
+void testNodeRecycling() {
+    redBlackTree *tree = initializeTree();
+
+    // a deleted node is handed back out by the next insertion
+    rbInsert(tree, 1);
+    rbInsert(tree, 2);
+    treeNode *released = rbTreeSearch(tree, 2);
+    rbDelete(tree, released);
+    rbInsert(tree, 3);
+    assert(rbTreeSearch(tree, 3) == released);
+
+    // enough insertions to need several slabs
+    for (int i = 0; i < 10 * RB_SLAB_MIN_NODES; i++) {
+        rbInsert(tree, i);
+    }
+    assert(tree->pool->slabs->next != NULL);
+    assert(size(tree, tree->root) == 10 * RB_SLAB_MIN_NODES + 2);
+
+    destroyTree(tree);
+
+    printf("testNodeRecycling passed.\n");
+}
+
+void testDeletionKeepsProperties() {
+    redBlackTree *tree = initializeTree();
+
+    // pseudo random keys, then delete every other one
+    unsigned int state = 12345;
+    int keys[2000];
+    for (int i = 0; i < 2000; i++) {
+        state = state * 1103515245 + 12345;
+        keys[i] = (int)(state >> 8) % 5000;
+        rbInsert(tree, keys[i]);
+    }
+    checkTree(tree);
+
+    for (int i = 0; i < 2000; i += 2) {
+        treeNode *node = rbTreeSearch(tree, keys[i]);
+        assert(node != tree->nil);
+        rbDelete(tree, node);
+        checkTree(tree);
+    }
+    assert(size(tree, tree->root) == 1000);
+
+    destroyTree(tree);
+
+    printf("testDeletionKeepsProperties passed.\n");
+}
+
+// collects the keys an rbRange() scan visits, stopping after limit of them
+typedef struct rangeCollector {
+    int keys[64];
+    size_t count;
+    size_t limit;
+} rangeCollector;
+
+static bool collectKey(treeNode *node, void *context) {
+    rangeCollector *collector = (rangeCollector*)context;
+    collector->keys[collector->count++] = node->key;
+    return collector->count < collector->limit;
+}
+
+void testRangeQueries() {
+    redBlackTree *tree = initializeTree();
+    assert(rbLowerBound(tree, 0) == tree->nil);
+    assert(rbRange(tree, 0, 100, NULL, NULL) == 0);
+
+    // the even keys 0 to 98, with 40 stored three times
+    for (int i = 0; i < 50; i++) {
+        rbInsert(tree, (i * 17) % 50 * 2);
+    }
+    rbInsert(tree, 40);
+    rbInsert(tree, 40);
+
+    assert(rbLowerBound(tree, 41)->key == 42);
+    assert(rbLowerBound(tree, 42)->key == 42);
+    assert(rbUpperBound(tree, 42)->key == 44);
+    assert(rbLowerBound(tree, -5)->key == 0);
+    assert(rbLowerBound(tree, 99) == tree->nil);
+    assert(rbUpperBound(tree, 98) == tree->nil);
+
+    // all three 40s lie between the lower and the upper bound
+    int duplicates = 0;
+    for (treeNode *x = rbLowerBound(tree, 40); x != rbUpperBound(tree, 40); x = rbNext(tree, x)) {
+        assert(x->key == 40);
+        duplicates++;
+    }
+    assert(duplicates == 3);
+
+    // walking forwards and backwards gives the sorted order
+    int previous = -1;
+    size_t steps = 0;
+    for (treeNode *x = rbMinimum(tree, tree->root); x != tree->nil; x = rbNext(tree, x)) {
+        assert(x->key >= previous);
+        previous = x->key;
+        steps++;
+    }
+    assert(steps == 52);
+    steps = 0;
+    for (treeNode *x = rbMaximum(tree, tree->root); x != tree->nil; x = rbPrev(tree, x)) {
+        assert(x->key <= previous);
+        previous = x->key;
+        steps++;
+    }
+    assert(steps == 52);
+
+    rangeCollector collector = {{0}, 0, 64};
+    assert(rbRange(tree, 35, 47, collectKey, &collector) == 8);
+    const int expected[] = {36, 38, 40, 40, 40, 42, 44, 46};
+    for (int i = 0; i < 8; i++) {
+        assert(collector.keys[i] == expected[i]);
+    }
+
+    // the callback can end the scan early, and an empty or reversed range visits nothing
+    collector.count = 0;
+    collector.limit = 2;
+    assert(rbRange(tree, 0, 98, collectKey, &collector) == 2);
+    assert(collector.keys[1] == 2);
+    assert(rbRange(tree, 41, 41, NULL, NULL) == 0);
+    assert(rbRange(tree, 50, 10, NULL, NULL) == 0);
+    assert(rbRange(tree, -100, 100, NULL, NULL) == 52);
+
+    destroyTree(tree);
+
+    printf("testRangeQueries passed.\n");
+}
+
+void testEraseRange() {
+    redBlackTree *tree = initializeTree();
+    assert(rbEraseRange(tree, 0, 10) == 0);
+
+    // keys 0 to 2999 in a scrambled order, every multiple of 10 twice
+    int present[3000] = {0};
+    for (int i = 0; i < 3000; i++) {
+        const int key = (i * 1237) % 3000;
+        rbInsert(tree, key);
+        present[key]++;
+        if (key % 10 == 0) {
+            rbInsert(tree, key);
+            present[key]++;
+        }
+    }
+
+    const int ranges[][2] = {{100, 199}, {500, 500}, {-50, 20}, {2990, 4000}, {1000, 2500}, {30, 29}, {150, 160}};
+    for (int r = 0; r < 7; r++) {
+        size_t expected = 0;
+        for (int key = 0; key < 3000; key++) {
+            if (key >= ranges[r][0] && key <= ranges[r][1]) {
+                expected += (size_t)present[key];
+                present[key] = 0;
+            }
+        }
+
+        assert(rbEraseRange(tree, ranges[r][0], ranges[r][1]) == expected);
+        checkTree(tree);
+    }
+
+    for (int key = 0; key < 3000; key++) {
+        assert((rbTreeSearch(tree, key) != tree->nil) == (present[key] > 0));
+    }
+
+    // erasing everything leaves an empty, usable tree
+    const size_t remaining = (size_t)size(tree, tree->root);
+    assert(rbEraseRange(tree, -1, 3000) == remaining);
+    assert(isEmpty(tree));
+    rbInsert(tree, 5);
+    checkTree(tree);
+
+    destroyTree(tree);
+
+    printf("testEraseRange passed.\n");
+}
+
+void testDeleteBatch() {
+    redBlackTree *tree = initializeTree();
+    int none[1] = {0};
+    assert(rbDeleteBatch(tree, none, 1) == 0);
+
+    int present[2000] = {0};
+    for (int i = 0; i < 2000; i++) {
+        const int key = (i * 7) % 2000;
+        rbInsert(tree, key);
+        present[key]++;
+        if (key % 3 == 0) {
+            rbInsert(tree, key);
+            present[key]++;
+        }
+    }
+
+    // unsorted keys, repeats, keys that are not in the tree, and one contiguous run
+    int keys[700];
+    size_t count = 0;
+    for (int i = 0; i < 400; i++) {
+        keys[count++] = (i * 37) % 2500;
+    }
+    for (int i = 0; i < 300; i++) {
+        keys[count++] = 1200 + i % 200;
+    }
+
+    size_t expected = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (keys[i] < 2000) {
+            expected += (size_t)present[keys[i]];
+            present[keys[i]] = 0;
+        }
+    }
+
+    assert(rbDeleteBatch(tree, keys, count) == expected);
+    checkTree(tree);
+    for (int key = 0; key < 2000; key++) {
+        assert((rbTreeSearch(tree, key) != tree->nil) == (present[key] > 0));
+    }
+
+    destroyTree(tree);
+
+    printf("testDeleteBatch passed.\n");
+}
+
+// ensure the nodes of tree hold exactly the keys counted in expected[0, range)
+static void checkKeyCounts(redBlackTree *tree, const int *expected, int range) {
+    checkTree(tree);
+
+    size_t total = 0;
+    treeNode *node = (tree->root == tree->nil) ? tree->nil : rbMinimum(tree, tree->root);
+    for (int key = 0; key < range; key++) {
+        for (int i = 0; i < expected[key]; i++) {
+            assert(node != tree->nil && node->key == key);
+            node = rbNext(tree, node);
+            total++;
+        }
+    }
+    assert(node == tree->nil);
+    assert((size_t)size(tree, tree->root) == total);
+}
+
+void testSplitJoin() {
+    redBlackTree *tree = initializeTree();
+    int counts[1000] = {0};
+    for (int i = 0; i < 1500; i++) {
+        const int key = (i * 379) % 1000;
+        rbInsert(tree, key);
+        counts[key]++;
+    }
+
+    // every key <= 400 stays, the rest moves to a tree sharing the pool
+    redBlackTree *upper = rbSplit(tree, 400);
+    assert(upper->pool == tree->pool);
+    int lowerCounts[1000] = {0};
+    int upperCounts[1000] = {0};
+    for (int key = 0; key < 1000; key++) {
+        (key <= 400 ? lowerCounts : upperCounts)[key] = counts[key];
+    }
+    checkKeyCounts(tree, lowerCounts, 1000);
+    checkKeyCounts(upper, upperCounts, 1000);
+
+    // overlapping keys are refused and leave both trees alone
+    rbInsert(upper, 10);
+    upperCounts[10]++;
+    assert(!rbJoin(tree, upper));
+    checkKeyCounts(upper, upperCounts, 1000);
+    rbDelete(upper, rbTreeSearch(upper, 10));
+    upperCounts[10]--;
+
+    // splitting off an empty half and joining it back works too
+    redBlackTree *empty = rbSplit(upper, 5000);
+    assert(isEmpty(empty));
+    assert(rbJoin(upper, empty));
+
+    assert(rbJoin(tree, upper));
+    checkKeyCounts(tree, counts, 1000);
+
+    // a tree with a pool of its own is moved over, and so are trees that are short and tall next to each other
+    redBlackTree *small = initializeTree();
+    rbInsert(small, 2000);
+    assert(rbJoin(tree, small));
+    assert(rbTreeSearch(tree, 2000) != tree->nil);
+    checkTree(tree);
+
+    destroyTree(tree);
+
+    printf("testSplitJoin passed.\n");
+}
+
+// builds a tree of count keys key(i) = (i * step) % range, counting them in counts
+static redBlackTree *buildCountedTree(int count, int step, int range, int *counts) {
+    redBlackTree *tree = initializeTree();
+    for (int i = 0; i < count; i++) {
+        const int key = (int)(((long)i * step) % range);
+        rbInsert(tree, key);
+        counts[key]++;
+    }
+    return tree;
+}
+
+void testSetOperations() {
+    enum {RANGE = 30000};
+    static int a[RANGE];
+    static int b[RANGE];
+    static int expected[RANGE];
+
+    // threads = 1 runs everything on the caller, 4 is enough to hand the larger subproblems to other threads
+    for (int threads = 1; threads <= 4; threads += 3) {
+        memset(a, 0, sizeof(a));
+        memset(b, 0, sizeof(b));
+        redBlackTree *tree = buildCountedTree(40000, 7, RANGE, a);
+        redBlackTree *other = buildCountedTree(20000, 11, RANGE / 2, b);
+        for (int key = 0; key < RANGE; key++) {
+            expected[key] = a[key] + b[key];
+        }
+        assert(rbUnion(tree, other, threads));
+        checkKeyCounts(tree, expected, RANGE);
+        destroyTree(tree);
+
+        memset(a, 0, sizeof(a));
+        memset(b, 0, sizeof(b));
+        tree = buildCountedTree(40000, 7, RANGE, a);
+        other = buildCountedTree(5000, 13, RANGE, b);
+        for (int key = 0; key < RANGE; key++) {
+            expected[key] = (b[key] > 0) ? a[key] : 0;
+        }
+        assert(rbIntersect(tree, other, threads));
+        checkKeyCounts(tree, expected, RANGE);
+        destroyTree(tree);
+
+        memset(a, 0, sizeof(a));
+        memset(b, 0, sizeof(b));
+        tree = buildCountedTree(40000, 7, RANGE, a);
+        other = buildCountedTree(25000, 3, RANGE, b);
+        for (int key = 0; key < RANGE; key++) {
+            expected[key] = (b[key] > 0) ? 0 : a[key];
+        }
+        assert(rbDifference(tree, other, threads));
+        checkKeyCounts(tree, expected, RANGE);
+        destroyTree(tree);
+    }
+
+    // both pools are shared with other trees, so the nodes of other are copied
+    memset(a, 0, sizeof(a));
+    memset(b, 0, sizeof(b));
+    redBlackTree *tree = buildCountedTree(3000, 7, 3000, a);
+    redBlackTree *other = buildCountedTree(3000, 11, 3000, b);
+    redBlackTree *treeUpper = rbSplit(tree, 1499);
+    redBlackTree *otherUpper = rbSplit(other, 999);
+    for (int key = 0; key < 3000; key++) {
+        expected[key] = (key <= 1499 ? a[key] : 0) + (key <= 999 ? b[key] : 0);
+    }
+    assert(rbUnion(tree, other, 2));
+    checkKeyCounts(tree, expected, 3000);
+
+    // intersecting with an empty tree empties it
+    assert(rbIntersect(treeUpper, initializeTree(), 1));
+    assert(isEmpty(treeUpper));
+
+    destroyTree(tree);
+    destroyTree(treeUpper);
+    destroyTree(otherUpper);
+
+    printf("testSetOperations passed.\n");
+}
+
+void testInsertBatch() {
+    enum {RANGE = 50000};
+    static int counts[RANGE];
+    static int keys[60000];
+
+    // into an empty tree, a tree as large as the batch and a tree far larger than it, on one and on four threads
+    const int treeSizes[] = {0, 30000, 40000};
+    const int batchSizes[] = {60000, 30000, 1000};
+    for (int threads = 1; threads <= 4; threads += 3) {
+        for (int run = 0; run < 3; run++) {
+            memset(counts, 0, sizeof(counts));
+            redBlackTree *tree = buildCountedTree(treeSizes[run], 17, RANGE, counts);
+
+            // unsorted, with duplicates inside the batch and keys already in the tree
+            for (int i = 0; i < batchSizes[run]; i++) {
+                keys[i] = (int)(((long)i * 7919) % RANGE);
+                counts[keys[i]]++;
+            }
+
+            assert(rbInsertBatch(tree, keys, (size_t)batchSizes[run], threads));
+            checkKeyCounts(tree, counts, RANGE);
+            destroyTree(tree);
+        }
+    }
+
+    redBlackTree *tree = initializeTree();
+    assert(rbInsertBatch(tree, keys, 0, 1));
+    assert(isEmpty(tree));
+    destroyTree(tree);
+
+    printf("testInsertBatch passed.\n");
+}
+
+// overwrites one node record of a snapshot file
+static void corruptSnapshot(const char *path, size_t index, rbPackedNode node) {
+    FILE *file = fopen(path, "r+b"); // flawfinder: ignore (a fixed test file)
+    assert(file != NULL);
+    assert(fseek(file, (long)(sizeof(rbSnapshotHeader) + index * sizeof(rbPackedNode)), SEEK_SET) == 0);
+    assert(fwrite(&node, sizeof(node), 1, file) == 1);
+    assert(fclose(file) == 0);
+}
+
+void testSnapshot() {
+    const char *path = "unit_test_snapshot.rbt";
+
+    // an empty tree round-trips
+    redBlackTree *tree = initializeTree();
+    assert(rbSaveTree(tree, path));
+    rbSnapshot *snapshot = rbOpenSnapshot(path);
+    assert(snapshot != NULL && snapshot->count == 0);
+    assert(!rbSnapshotContains(snapshot, 0));
+    rbCloseSnapshot(snapshot);
+    redBlackTree *loaded = rbLoadTree(path);
+    assert(loaded != NULL && isEmpty(loaded));
+    checkTree(loaded);
+    destroyTree(loaded);
+
+    // more nodes than one write buffer, with duplicates and deletions so the colors are mixed
+    for (int i = 0; i < 3 * RB_SNAPSHOT_BUFFER_NODES; i++) {
+        rbInsert(tree, (i * 7) % (2 * RB_SNAPSHOT_BUFFER_NODES));
+    }
+    for (int i = 0; i < RB_SNAPSHOT_BUFFER_NODES; i += 3) {
+        rbDelete(tree, rbTreeSearch(tree, i * 2));
+    }
+    assert(rbSaveTree(tree, path));
+
+    snapshot = rbOpenSnapshot(path);
+    assert(snapshot != NULL && snapshot->count == (size_t)size(tree, tree->root));
+    for (int key = -5; key < 2 * RB_SNAPSHOT_BUFFER_NODES + 5; key++) {
+        assert(rbSnapshotContains(snapshot, key) == (rbTreeSearch(tree, key) != tree->nil));
+    }
+    rbCloseSnapshot(snapshot);
+
+    // the loaded tree has the same shape, colors and sizes, and can be changed again
+    loaded = rbLoadTree(path);
+    assert(loaded != NULL);
+    checkTree(loaded);
+    treeNode *original = rbMinimum(tree, tree->root);
+    for (treeNode *node = rbMinimum(loaded, loaded->root); node != loaded->nil; node = rbNext(loaded, node)) {
+        assert(node->key == original->key && node->color == original->color);
+        assert(node->subtreeSize == original->subtreeSize);
+        original = rbNext(tree, original);
+    }
+    assert(original == tree->nil);
+    rbInsert(loaded, -1);
+    rbDelete(loaded, rbTreeSearch(loaded, 1));
+    checkTree(loaded);
+    destroyTree(loaded);
+
+    // a root that is RED, a right link that points backwards and an out of order key are all refused
+    const rbPackedNode root = {1, RB_PACKED_LEFT};
+    corruptSnapshot(path, 0, root);
+    assert(rbLoadTree(path) == NULL);
+    snapshot = rbOpenSnapshot(path);
+    assert(snapshot != NULL);
+    rbSnapshotContains(snapshot, 1 << 30); // a search must still end
+    rbCloseSnapshot(snapshot);
+
+    assert(rbSaveTree(tree, path));
+    snapshot = rbOpenSnapshot(path);
+    rbPackedNode node = snapshot->nodes[1];
+    rbCloseSnapshot(snapshot);
+    node.key = 1 << 30;
+    corruptSnapshot(path, 1, node);
+    assert(rbLoadTree(path) == NULL);
+
+    // a file of the wrong size or with another magic is not opened at all
+    FILE *file = fopen(path, "wb"); // flawfinder: ignore (a fixed test file)
+    assert(file != NULL);
+    assert(fputs("not a tree snapshot, just some text", file) >= 0);
+    assert(fclose(file) == 0);
+    assert(rbOpenSnapshot(path) == NULL);
+    assert(rbLoadTree(path) == NULL);
+    assert(rbOpenSnapshot("unit_test_missing.rbt") == NULL);
+
+    remove(path);
+    destroyTree(tree);
+
+    printf("testSnapshot passed.\n");
+}
+
+// asserts that two trees hold the same keys in the same order
+static void checkSameKeys(redBlackTree *tree, redBlackTree *other) {
+    assert(size(tree, tree->root) == size(other, other->root));
+    treeNode *node = (other->root == other->nil) ? other->nil : rbMinimum(other, other->root);
+    for (treeNode *x = (tree->root == tree->nil) ? tree->nil : rbMinimum(tree, tree->root); x != tree->nil;
+         x = rbNext(tree, x)) {
+        assert(x->key == node->key);
+        node = rbNext(other, node);
+    }
+}
+
+void testWriteAheadLog() {
+    const char *logPath = "unit_test_wal.log";
+    const char *snapshotPath = "unit_test_wal.rbt";
+    remove(logPath);
+    remove(snapshotPath);
+
+    // changes made through the log come back after a close, including keys far apart and deletions of missing keys
+    writeAheadLog *log = NULL;
+    redBlackTree *tree = walRecover(snapshotPath, logPath, 16, &log);
+    assert(tree != NULL && log != NULL && isEmpty(tree));
+    for (int i = 0; i < 1000; i++) {
+        assert(walInsert(log, tree, (i * 37) % 500));
+    }
+    assert(walInsert(log, tree, 2147483647) && walInsert(log, tree, -2147483647 - 1));
+    for (int i = 0; i < 500; i += 7) {
+        assert(walDelete(log, tree, i));
+    }
+    assert(!walDelete(log, tree, 1 << 20));
+    assert(walClose(log));
+
+    redBlackTree *recovered = walRecover(snapshotPath, logPath, 16, &log);
+    assert(recovered != NULL && log != NULL);
+    checkTree(recovered);
+    checkSameKeys(tree, recovered);
+
+    // records that were never synced are lost, and a torn frame at the end is cut off before new frames follow it
+    assert(walInsert(log, recovered, 7) && walSync(log));
+    const uint64_t synced = log->sequence;
+    assert(walInsert(log, recovered, 9));
+    assert(write(log->fd, "torn frame", 10) == 10);
+    close(log->fd); // a crash: the pending record is never written
+    free(log->path);
+    free(log);
+    destroyTree(recovered);
+    rbInsert(tree, 7);
+
+    recovered = walRecover(snapshotPath, logPath, 16, &log);
+    assert(recovered != NULL && log->sequence == synced);
+    checkSameKeys(tree, recovered);
+    assert(walInsert(log, recovered, 11));
+    rbInsert(tree, 11);
+    assert(walClose(log));
+    destroyTree(recovered);
+    recovered = walRecover(snapshotPath, logPath, 16, &log);
+    checkSameKeys(tree, recovered);
+
+    // after a checkpoint only the later records are replayed on top of the snapshot
+    assert(walCheckpoint(log, recovered, snapshotPath));
+    assert(walDelete(log, recovered, 11) && walInsert(log, recovered, 12));
+    assert(walClose(log));
+    rbDelete(tree, rbTreeSearch(tree, 11));
+    rbInsert(tree, 12);
+    destroyTree(recovered);
+    recovered = walRecover(snapshotPath, logPath, 16, &log);
+    assert(recovered != NULL);
+    checkTree(recovered);
+    checkSameKeys(tree, recovered);
+
+    // a checkpoint that saved the snapshot but stopped before emptying the log does not apply records twice
+    assert(walInsert(log, recovered, 13) && walSync(log));
+    assert(rbSaveTreeAt(recovered, snapshotPath, log->sequence));
+    assert(walInsert(log, recovered, 14));
+    assert(walClose(log));
+    rbInsert(tree, 13);
+    rbInsert(tree, 14);
+    destroyTree(recovered);
+    recovered = walRecover(snapshotPath, logPath, 16, &log);
+    assert(recovered != NULL);
+    checkSameKeys(tree, recovered);
+    assert(walClose(log));
+    destroyTree(recovered);
+
+    // a log that starts after the snapshot is missing records and is refused, and so is a file that is not a log
+    assert(rbSaveTreeAt(tree, snapshotPath, 0));
+    assert(walRecover(snapshotPath, logPath, 16, &log) == NULL && log == NULL);
+    FILE *file = fopen(logPath, "wb"); // flawfinder: ignore (a fixed test file)
+    assert(file != NULL);
+    assert(fputs("not a write-ahead log, just some text", file) >= 0);
+    assert(fclose(file) == 0);
+    assert(walRecover(snapshotPath, logPath, 16, &log) == NULL);
+
+    remove(logPath);
+    remove(snapshotPath);
+    destroyTree(tree);
+
+    printf("testWriteAheadLog passed.\n");
+}
+
+void testModifications() {
+    redBlackTree *tree = initializeTree();
+    assert(tree->modifications == 0);
+
+    rbInsert(tree, 5);
+    rbInsert(tree, 3);
+    rbInsert(tree, 8);
+    unsigned long seen = tree->modifications;
+    assert(seen == 3);
+
+    // searches and walks leave the tree as it is
+    assert(rbTreeSearch(tree, 3) != tree->nil);
+    rbNext(tree, rbMinimum(tree, tree->root));
+    assert(tree->modifications == seen);
+
+    rbDelete(tree, rbTreeSearch(tree, 3));
+    assert(tree->modifications > seen);
+    seen = tree->modifications;
+
+    assert(rbEraseRange(tree, 0, 6) == 1);
+    assert(tree->modifications > seen);
+
+    destroyTree(tree);
+
+    printf("testModifications passed.\n");
+}
+
+// checks the layout against one made from scratch, and that the nodes of each level are TL_SEPARATION apart
+static void checkLayout(redBlackTree *tree, treeLayout *layout) {
+    assert(tlUpdate(layout));
+
+    // a second layout takes over the observer until it is destroyed
+    rbObserver observer = tree->observer;
+    void *context = tree->observerContext;
+    treeLayout *fresh = tlCreate(tree);
+    assert(tlUpdate(fresh));
+
+    const size_t count = tree->root->subtreeSize;
+    treeNode **queue = (treeNode**)malloc((count + 1) * sizeof(treeNode*));
+    int *x = (int*)malloc((count + 1) * sizeof(int));
+    int *depth = (int*)malloc((count + 1) * sizeof(int));
+    assert(queue != NULL && x != NULL && depth != NULL);
+
+    // breadth first, so the nodes of a level come left to right
+    size_t head = 0;
+    size_t tail = 0;
+    if (count > 0) {
+        queue[tail] = tree->root;
+        x[tail] = 0;
+        depth[tail++] = 0;
+    }
+    while (head < tail) {
+        const treeNode *node = queue[head];
+        const tlRecord *record = tlNode(layout, node);
+        const tlRecord *expected = tlNode(fresh, node);
+        assert(record != NULL && expected != NULL && !record->dirty);
+        assert(record->offset == expected->offset && record->height == expected->height);
+        assert(record->minX == expected->minX && record->maxX == expected->maxX);
+
+        if (head > 0 && depth[head - 1] == depth[head]) {
+            assert(x[head] - x[head - 1] >= TL_SEPARATION);
+        }
+        if (node->left != tree->nil) {
+            queue[tail] = node->left;
+            x[tail] = x[head] - record->offset;
+            depth[tail++] = depth[head] + 1;
+        }
+        if (node->right != tree->nil) {
+            queue[tail] = node->right;
+            x[tail] = x[head] + record->offset;
+            depth[tail++] = depth[head] + 1;
+        }
+        head++;
+    }
+    assert(tail == count);
+
+    tlDestroy(fresh);
+    rbSetObserver(tree, observer, context);
+    free(queue);
+    free(x);
+    free(depth);
+}
+
+void testTreeLayout() {
+    redBlackTree *tree = initializeTree();
+    treeLayout *layout = tlCreate(tree);
+    assert(layout != NULL && tree->observerContext == layout);
+    assert(tlUpdate(layout));
+
+    for (int i = 0; i < 300; i++) {
+        rbInsert(tree, (i * 37) % 300);
+        if (i % 7 == 0) {
+            checkLayout(tree, layout);
+        }
+    }
+    checkLayout(tree, layout);
+
+    // a single change lays out its search path and the rotated nodes again, not the whole tree
+    unsigned long long before = layout->recomputed;
+    rbInsert(tree, 1000);
+    assert(tlUpdate(layout));
+    assert(layout->recomputed - before <= 2 * (unsigned long long)height(tree, tree->root) + 4);
+
+    for (int i = 0; i < 300; i += 2) {
+        rbDelete(tree, rbTreeSearch(tree, (i * 11) % 300));
+        if (i % 10 == 0) {
+            checkLayout(tree, layout);
+        }
+    }
+    checkLayout(tree, layout);
+
+    before = layout->recomputed;
+    rbDelete(tree, tree->root);
+    assert(tlUpdate(layout));
+    assert(layout->recomputed - before <= 2 * (unsigned long long)height(tree, tree->root) + 4);
+    checkLayout(tree, layout);
+
+    // a bulk operation starts the layout over
+    rbEraseRange(tree, 50, 150);
+    checkLayout(tree, layout);
+    const int keys[] = {400, 401, 402, 403, 404};
+    assert(rbInsertBatch(tree, keys, 5, 1));
+    checkLayout(tree, layout);
+
+    // a lone child sits half the separation to the side
+    redBlackTree *small = initializeTree();
+    treeLayout *smallLayout = tlCreate(small);
+    rbInsert(small, 1);
+    rbInsert(small, 2);
+    assert(tlUpdate(smallLayout));
+    assert(tlNode(smallLayout, small->root)->offset == TL_SEPARATION / 2);
+    assert(tlNode(smallLayout, small->root)->maxX == TL_SEPARATION / 2);
+    tlDestroy(smallLayout);
+    assert(small->observer == NULL);
+    destroyTree(small);
+
+    tlDestroy(layout);
+    destroyTree(tree);
+
+    printf("testTreeLayout passed.\n");
+}
+
+void testEventLog() {
+    redBlackTree *tree = initializeTree();
+    treeLayout *layout = tlCreate(tree);
+    eventLog *log = elCreate(tree, 100);
+    assert(log != NULL && log->mask == 127 && elWritten(log) == 0);
+
+    // 10 becomes the BLACK root: it is linked in and recolored
+    rbInsert(tree, 10);
+    elEvent events[128];
+    assert(elRead(log, 0, events, 128) == 2);
+    assert(events[0].event == RB_NODE_LINKED && events[0].key == 10 && events[0].color == RED);
+    assert(events[1].event == RB_NODE_RECOLORED && events[1].key == 10 && events[1].color == BLACK);
+
+    // 20 is compared with the root on the way down, and 30 then rotates 10 left
+    rbInsert(tree, 20);
+    const uint64_t before = elWritten(log);
+    rbInsert(tree, 30);
+    const size_t count = elRead(log, before, events, 128);
+    assert(events[0].event == RB_NODE_COMPARED && events[0].key == 10);
+    assert(events[1].event == RB_NODE_COMPARED && events[1].key == 20);
+    assert(events[2].event == RB_NODE_LINKED && events[2].key == 30);
+    bool rotated = false;
+    for (size_t i = 0; i < count; i++) {
+        rotated = rotated || (events[i].event == RB_ROTATED_LEFT && events[i].key == 10);
+    }
+    assert(rotated && tree->root->key == 20);
+
+    // the layout behind the log heard about the rotation as well
+    assert(tlUpdate(layout));
+    assert(tlNode(layout, tree->root)->offset == TL_SEPARATION / 2 && tlNode(layout, tree->root)->height == 2);
+
+    // the search path of a deletion, and the release of the node
+    const uint64_t deletion = elWritten(log);
+    rbDelete(tree, rbTreeSearch(tree, 30));
+    assert(elRead(log, deletion, events, 128) >= 3);
+    assert(events[0].event == RB_NODE_COMPARED && events[0].key == 20);
+    assert(events[1].event == RB_NODE_COMPARED && events[1].key == 30);
+
+    // events that were overwritten can not be read any more
+    for (int i = 0; i < 100; i++) {
+        rbInsert(tree, 100 + i);
+    }
+    assert(elWritten(log) > 128);
+    assert(elRead(log, 0, events, 128) == 0);
+    assert(elRead(log, elWritten(log) - 128, events, 128) == 128);
+
+    // the layout is the observer again
+    elDestroy(log);
+    assert(tree->observerContext == layout);
+    tlDestroy(layout);
+    assert(tree->observer == NULL);
+    destroyTree(tree);
+
+    printf("testEventLog passed.\n");
+}
+
+void testSelectRank() {
+    redBlackTree *tree = initializeTree();
+
+    assert(rbSelect(tree, 1) == tree->nil);
+    assert(rbRank(tree, 10) == 0);
+
+    // even keys 0..198 in a scrambled order
+    for (int i = 0; i < 100; i++) {
+        rbInsert(tree, ((i * 37) % 100) * 2);
+    }
+    checkTree(tree);
+
+    for (size_t k = 1; k <= 100; k++) {
+        treeNode *node = rbSelect(tree, k);
+        assert(node->key == (int)(k - 1) * 2);
+        assert(rbRank(tree, node->key) == k);
+    }
+    assert(rbSelect(tree, 0) == tree->nil);
+    assert(rbSelect(tree, 101) == tree->nil);
+
+    // absent keys rank like their predecessor
+    assert(rbRank(tree, -1) == 0);
+    assert(rbRank(tree, 51) == 26);
+    assert(rbRank(tree, 1000) == 100);
+
+    // sizes stay exact through deletions
+    for (int key = 0; key < 200; key += 6) {
+        rbDelete(tree, rbTreeSearch(tree, key));
+    }
+    checkTree(tree);
+    assert(size(tree, tree->root) == 66);
+    assert(rbSelect(tree, 1)->key == 2);
+    assert(rbRank(tree, 11) == 4); // 2, 4, 8 and 10 remain at or below 11
+
+    destroyTree(tree);
+
+    printf("testSelectRank passed.\n");
+}
+
+void testBuildFromSorted() {
+    int keys[300];
+
+    // every size up to 300 gives a valid tree holding exactly the given keys
+    for (size_t count = 0; count <= 300; count++) {
+        for (size_t i = 0; i < count; i++) {
+            keys[i] = (int)i * 3 - 100;
+        }
+
+        redBlackTree *tree = rbBuildFromSorted(keys, count);
+        assert(tree != NULL);
+        checkTree(tree);
+        assert(size(tree, tree->root) == (int)count);
+
+        for (size_t i = 0; i < count; i++) {
+            assert(rbSelect(tree, i + 1)->key == keys[i]);
+        }
+
+        // the built tree keeps working with the regular operations
+        rbInsert(tree, 7);
+        if (count > 0) {
+            rbDelete(tree, rbMinimum(tree, tree->root));
+        }
+        checkTree(tree);
+
+        destroyTree(tree);
+    }
+
+    printf("testBuildFromSorted passed.\n");
+}
+
+void testBuildFromUnsorted() {
+    int keys[] = {5, -3, 2000000000, 5, 0, -2000000000, 42, 17, -3, 8};
+    const size_t count = sizeof(keys) / sizeof(keys[0]);
+
+    redBlackTree *tree = rbBuildFromSorted(keys, count);
+    assert(tree != NULL);
+    checkTree(tree);
+
+    // the input array itself is left alone
+    assert(keys[0] == 5 && keys[1] == -3);
+
+    assert(rbSortKeys(keys, count));
+    for (size_t i = 0; i < count; i++) {
+        assert(rbSelect(tree, i + 1)->key == keys[i]);
+        if (i > 0) {
+            assert(keys[i - 1] <= keys[i]);
+        }
+    }
+    assert(keys[0] == -2000000000 && keys[count - 1] == 2000000000);
+
+    destroyTree(tree);
+
+    printf("testBuildFromUnsorted passed.\n");
+}
+
+// same checks as checkSubtree(), for the index based arrayTree
+static int checkArraySubtree(const arrayTree *tree, uint32_t node) {
+    if (node == AT_NIL) {
+        return 0;
+    }
+
+    const arrayNode *n = tree->nodes;
+    if (atColor(tree, node) == RED) {
+        assert(atColor(tree, n[node].left) == BLACK);
+        assert(atColor(tree, n[node].right) == BLACK);
+    }
+    if (n[node].left != AT_NIL) {
+        assert(atParent(tree, n[node].left) == node);
+        assert(n[n[node].left].key <= n[node].key);
+    }
+    if (n[node].right != AT_NIL) {
+        assert(atParent(tree, n[node].right) == node);
+        assert(n[n[node].right].key >= n[node].key);
+    }
+
+    int leftBlackHeight = checkArraySubtree(tree, n[node].left);
+    int rightBlackHeight = checkArraySubtree(tree, n[node].right);
+    assert(leftBlackHeight == rightBlackHeight);
+
+    return leftBlackHeight + (atColor(tree, node) == BLACK ? 1 : 0);
+}
+
+void testArrayTree() {
+    arrayTree *tree = atInitializeTree();
+    assert(sizeof(arrayNode) == 16);
+    assert(atTreeSearch(tree, 1) == AT_NIL);
+
+    unsigned int state = 99;
+    int keys[3000];
+    for (int i = 0; i < 3000; i++) {
+        state = state * 1103515245 + 12345;
+        keys[i] = (int)(state >> 8) % 10000 - 5000;
+        assert(atInsert(tree, keys[i]) != AT_NIL);
+    }
+    assert(atColor(tree, tree->root) == BLACK);
+    checkArraySubtree(tree, tree->root);
+    assert(tree->count == 3000);
+
+    int min = keys[0];
+    int max = keys[0];
+    for (int i = 0; i < 3000; i++) {
+        min = (keys[i] < min) ? keys[i] : min;
+        max = (keys[i] > max) ? keys[i] : max;
+        assert(tree->nodes[atTreeSearch(tree, keys[i])].key == keys[i]);
+    }
+    assert(tree->nodes[atMinimum(tree, tree->root)].key == min);
+    assert(tree->nodes[atMaximum(tree, tree->root)].key == max);
+
+    // delete two thirds, then refill the freed slots
+    const uint32_t used = tree->used;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 3 != 0) {
+            atDelete(tree, atTreeSearch(tree, keys[i]));
+        }
+    }
+    checkArraySubtree(tree, tree->root);
+    assert(tree->count == 1000);
+
+    for (int i = 0; i < 2000; i++) {
+        atInsert(tree, i);
+    }
+    checkArraySubtree(tree, tree->root);
+    assert(tree->used == used);
+
+    atDestroyTree(tree);
+
+    printf("testArrayTree passed.\n");
+}
+
+// same checks as checkSubtree(), for the parent-less topDownTree
+static int checkTopDownSubtree(const tdNode *node) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    if (node->color == RED) {
+        assert(node->link[0] == NULL || node->link[0]->color == BLACK);
+        assert(node->link[1] == NULL || node->link[1]->color == BLACK);
+    }
+    assert(node->link[0] == NULL || node->link[0]->key <= node->key);
+    assert(node->link[1] == NULL || node->link[1]->key >= node->key);
+
+    int leftBlackHeight = checkTopDownSubtree(node->link[0]);
+    int rightBlackHeight = checkTopDownSubtree(node->link[1]);
+    assert(leftBlackHeight == rightBlackHeight);
+
+    return leftBlackHeight + (node->color == BLACK ? 1 : 0);
+}
+
+void testTopDownTree() {
+    topDownTree *tree = tdInitializeTree();
+    assert(tdMinimum(tree) == NULL);
+    assert(!tdDelete(tree, 1));
+
+    unsigned int state = 7;
+    int keys[3000];
+    for (int i = 0; i < 3000; i++) {
+        state = state * 1103515245 + 12345;
+        keys[i] = (int)(state >> 8) % 2000; // plenty of duplicates
+        tdInsert(tree, keys[i]);
+        assert(tree->root->color == BLACK);
+    }
+    checkTopDownSubtree(tree->root);
+    assert(tree->count == 3000);
+
+    int min = keys[0];
+    int max = keys[0];
+    for (int i = 0; i < 3000; i++) {
+        min = (keys[i] < min) ? keys[i] : min;
+        max = (keys[i] > max) ? keys[i] : max;
+        assert(tdTreeSearch(tree, keys[i])->key == keys[i]);
+    }
+    assert(tdMinimum(tree)->key == min);
+    assert(tdMaximum(tree)->key == max);
+    assert(tdTreeSearch(tree, 2000) == NULL);
+
+    // every deletion removes exactly one copy of its key
+    for (int i = 0; i < 3000; i += 2) {
+        assert(tdDelete(tree, keys[i]));
+        checkTopDownSubtree(tree->root);
+    }
+    assert(tree->count == 1500);
+    assert(!tdDelete(tree, -1));
+    for (int i = 1; i < 3000; i += 2) {
+        assert(tdTreeSearch(tree, keys[i]) != NULL);
+    }
+
+    for (int i = 1; i < 3000; i += 2) {
+        assert(tdDelete(tree, keys[i]));
+    }
+    assert(tree->root == NULL);
+    assert(tree->count == 0);
+
+    tdDestroyTree(tree);
+
+    printf("testTopDownTree passed.\n");
+}
+
+// returns the black height of an intMap subtree and adds its node count to *count
+static int checkMapSubtree(const intMap *map, const intMapNode *node, size_t *count) {
+    if (node == map->nil) {
+        return 0;
+    }
+
+    if (node->color == RED) {
+        assert(node->left->color == BLACK);
+        assert(node->right->color == BLACK);
+    }
+    if (node->left != map->nil) {
+        assert(node->left->parent == node);
+        assert(node->left->key < node->key);
+    }
+    if (node->right != map->nil) {
+        assert(node->right->parent == node);
+        assert(node->right->key > node->key);
+    }
+    (*count)++;
+
+    int leftBlackHeight = checkMapSubtree(map, node->left, count);
+    int rightBlackHeight = checkMapSubtree(map, node->right, count);
+    assert(leftBlackHeight == rightBlackHeight);
+
+    return leftBlackHeight + (node->color == BLACK ? 1 : 0);
+}
+
+void testGenericMap() {
+    intMap *map = intMapInitialize();
+    assert(intMapGet(map, 1) == NULL);
+    assert(!intMapRemove(map, 1));
+
+    // keys are unique, a second put replaces the value
+    for (int i = 0; i < 2000; i++) {
+        assert(intMapPut(map, (i * 7) % 2000, i * 0.5));
+    }
+    for (int i = 0; i < 2000; i += 2) {
+        assert(!intMapPut(map, i, -1.0));
+    }
+    assert(map->count == 2000);
+
+    for (int i = 0; i < 2000; i++) {
+        const double *value = intMapGet(map, i);
+        assert(value != NULL);
+        if (i % 2 == 0) {
+            assert(*value == -1.0);
+        } else {
+            assert(intMapFind(map, i)->key == i);
+        }
+    }
+
+    for (int i = 0; i < 2000; i += 3) {
+        assert(intMapRemove(map, i));
+        assert(intMapGet(map, i) == NULL);
+    }
+    size_t count = 0;
+    checkMapSubtree(map, map->root, &count);
+    assert(count == map->count);
+    assert(map->root->color == BLACK);
+
+    intMapDestroy(map);
+
+    // string keys go through strcmp(), compare by content rather than address
+    stringMap *words = stringMapInitialize();
+    const char *keys[] = {"pear", "apple", "fig", "kiwi", "plum"};
+    for (int i = 0; i < 5; i++) {
+        stringMapPut(words, keys[i], i);
+    }
+    char lookup[8];
+    strcpy(lookup, "fig"); // flawfinder: ignore
+    assert(*stringMapGet(words, lookup) == 2);
+    assert(stringMapGet(words, "grape") == NULL);
+    assert(stringMapRemove(words, "apple"));
+    assert(words->count == 4);
+
+    stringMapDestroy(words);
+
+    printf("testGenericMap passed.\n");
+}
+
+// returns the black height of a persistentTree subtree and adds its node count to *count
+static int checkPersistentSubtree(const ptNode *node, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    assert(node->refs >= 1);
+    if (node->color == RED) {
+        assert(node->link[0] == NULL || node->link[0]->color == BLACK);
+        assert(node->link[1] == NULL || node->link[1]->color == BLACK);
+    }
+    assert(node->link[0] == NULL || node->link[0]->key <= node->key);
+    assert(node->link[1] == NULL || node->link[1]->key >= node->key);
+    (*count)++;
+
+    int leftBlackHeight = checkPersistentSubtree(node->link[0], count);
+    int rightBlackHeight = checkPersistentSubtree(node->link[1], count);
+    assert(leftBlackHeight == rightBlackHeight);
+
+    return leftBlackHeight + (node->color == BLACK ? 1 : 0);
+}
+
+static void checkPersistentTree(const persistentTree *tree) {
+    size_t count = 0;
+    checkPersistentSubtree(tree->root, &count);
+    assert(count == tree->count);
+    assert(tree->root == NULL || tree->root->color == BLACK);
+}
+
+// nodes handed out by the pool shared by all versions of a tree
+static size_t persistentNodesInUse(const ptPool *pool) {
+    size_t capacity = 0;
+    for (const ptSlab *slab = pool->slabs; slab != NULL; slab = slab->next) {
+        capacity += slab->capacity;
+    }
+    return capacity - pool->available;
+}
+
+void testPersistentTree() {
+    persistentTree *tree = ptInitializeTree();
+    assert(!ptDelete(tree, 1));
+
+    for (int i = 0; i < 1000; i++) {
+        ptInsert(tree, i);
+    }
+    checkPersistentTree(tree);
+    assert(persistentNodesInUse(tree->pool) == 1000);
+
+    // a snapshot shares every node, and one change to either version only copies a path
+    persistentTree *snapshot = ptSnapshot(tree);
+    ptInsert(tree, 1000);
+    assert(persistentNodesInUse(tree->pool) < 1000 + 64);
+
+    for (int i = 1001; i < 1500; i++) {
+        ptInsert(tree, i);
+    }
+    for (int i = 0; i < 500; i += 2) {
+        assert(ptDelete(tree, i));
+    }
+    assert(!ptDelete(tree, 0));
+    checkPersistentTree(tree);
+    checkPersistentTree(snapshot);
+    assert(tree->count == 1250);
+    assert(snapshot->count == 1000);
+
+    // the snapshot still sees exactly what the tree held when it was taken
+    for (int i = 0; i < 1500; i++) {
+        assert((ptTreeSearch(snapshot, i) != NULL) == (i < 1000));
+        assert((ptTreeSearch(tree, i) != NULL) == (i >= 500 || i % 2 == 1));
+    }
+
+    // emptying a third version with duplicates leaves the other two alone
+    persistentTree *copy = ptSnapshot(snapshot);
+    for (int i = 0; i < 1000; i++) {
+        ptInsert(copy, i % 10);
+    }
+    for (int i = 999; i >= 0; i--) {
+        assert(ptDelete(copy, i));
+        assert(ptDelete(copy, i % 10));
+    }
+    checkPersistentTree(copy);
+    assert(copy->root == NULL);
+    checkPersistentTree(snapshot);
+    assert(snapshot->count == 1000);
+
+    // releasing the original first must not free the nodes the other versions still use
+    ptRelease(tree);
+    for (int i = 0; i < 1000; i++) {
+        assert(ptTreeSearch(snapshot, i)->key == i);
+    }
+    ptRelease(copy);
+    assert(persistentNodesInUse(snapshot->pool) == 1000);
+    ptRelease(snapshot);
+
+    printf("testPersistentTree passed.\n");
+}
+
+// the multiples of 4 below 4000 stay in the tree, odd keys are never inserted
+static void *readConcurrentTree(void *argument) {
+    concurrentTree *tree = (concurrentTree*)argument;
+    for (int round = 0; round < 200; round++) {
+        for (int key = 0; key < 4000; key += 4) {
+            assert(ctContains(tree, key));
+            assert(!ctContains(tree, key + 1));
+        }
+    }
+    return NULL;
+}
+
+void testConcurrentTree() {
+    concurrentTree *tree = ctInitializeTree();
+    for (int key = 0; key < 4000; key += 4) {
+        ctInsert(tree, key);
+    }
+
+    pthread_t readers[3];
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, readConcurrentTree, tree);
+    }
+
+    // meanwhile, keys 2 mod 4 come and go, rotating the nodes the readers are walking through
+    for (int round = 0; round < 20; round++) {
+        for (int key = 2; key < 4000; key += 4) {
+            ctInsert(tree, key);
+        }
+        for (int key = 2; key < 4000; key += 4) {
+            assert(ctDelete(tree, key));
+        }
+    }
+    assert(!ctDelete(tree, 1));
+
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    checkTree(tree->tree);
+    assert(size(tree->tree, tree->tree->root) == 1000);
+
+    ctDestroyTree(tree);
+
+    printf("testConcurrentTree passed.\n");
+}
+
 int main()
 {
     // insertion tests
@@ -216,8 +1691,36 @@ int main()
     // deletion tests
     testBasicDeletion();
     testRootDeletetion();
+    testDeletionKeepsProperties();
+    testEraseRange();
+    testDeleteBatch();
+    testSplitJoin();
+    testSetOperations();
+    testInsertBatch();
+    testSnapshot();
+    testWriteAheadLog();
     // auxiliary test
+    testModifications();
+    testTreeLayout();
+    testEventLog();
     testSearch();
+    testSearchBatch();
+    testStats();
     testSizeHeight(); 
+    testDeepSubtree();
+    testBlackHeight();
+    testSelectRank();
+    testRangeQueries();
+    // bulk loading tests
+    testBuildFromSorted();
+    testBuildFromUnsorted();
+    // node pool tests
+    testNodeRecycling();
+    // tree variant tests
+    testArrayTree();
+    testTopDownTree();
+    testConcurrentTree();
+    testPersistentTree();
+    testGenericMap();
     return 0;
 }
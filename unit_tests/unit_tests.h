@@ -1,7 +1,7 @@
 #ifndef UNIT_TESTS
 #define UNIT_TESTS
 
-/* NOTE: unit tests are for testing the Red-Black Tree itself, not the GUI. GUI elements should be commented from red_black_tree.c before running these tests. */
+/* NOTE: unit tests are for testing the Red-Black Tree itself, not the GUI. red_black_tree.c does not depend on GTK, so no GUI elements need to be linked. */
 
 // ensure that the tree correctly maintains the minimum and maximum elements
 void testInsertMaxMin();
@@ -18,9 +18,84 @@ void testBasicDeletion();
 // ensure that the tree maintains properties after deleting the root with 1 and 2 children
 void testRootDeletion();
 
+// ensure rbEraseRange() deletes exactly the keys in the range, duplicates included, and keeps the tree valid
+void testEraseRange();
+
+// ensure rbDeleteBatch() deletes every node with one of the keys, ignoring repeats and missing keys
+void testDeleteBatch();
+
+// ensure rbSplit() and rbJoin() divide and reassemble a tree, and refuse to join overlapping trees
+void testSplitJoin();
+
+// ensure rbUnion(), rbIntersect() and rbDifference() give the right multiset, on one thread and on several
+void testSetOperations();
+
+// ensure rbInsertBatch() inserts unsorted keys with duplicates, whether the batch is large or small next to the tree
+void testInsertBatch();
+
+// ensure a saved tree can be searched through its mapped snapshot and loaded back, and corrupt files are refused
+void testSnapshot();
+
+// ensure the write-ahead log recovers the tree after a close, a torn frame and a checkpoint that stopped halfway
+void testWriteAheadLog();
+
+// ensure tree->modifications changes with every insertion, deletion and bulk operation, and with nothing else
+void testModifications();
+
+// ensure the tidy layout never puts two nodes of a level too close, and that updating it after changes matches a layout from scratch
+void testTreeLayout();
+
+// ensure the event log records the steps of an insertion in order, passes them on to the layout and drops old events
+void testEventLog();
+
 // ensure search function can properly find values and returns nil when necessary
 void testSearch();
 
+// ensure rbTreeSearchBatch() returns the same nodes as rbTreeSearch() for hits, misses and partial groups
+void testSearchBatch();
+
+// ensure the RB_ENABLE_STATS counters record rotations, fixup cases and search path lengths (and read zero without it)
+void testStats();
+
 // ensure the size() and height() functions return the correct values
 void testSizeHeight();
+
+// ensure height() and destroyTreeHelper() handle subtrees far deeper than the stack could recurse
+void testDeepSubtree();
+
+// ensure rbBlackHeight() follows every insertion and deletion, and rbHeightBound() bounds height()
+void testBlackHeight();
+
+// ensure rbSelect() and rbRank() agree with the sorted order and the subtree sizes survive deletions
+void testSelectRank();
+
+// ensure the bounds, rbNext()/rbPrev() and rbRange() follow the sorted order, duplicates included
+void testRangeQueries();
+
+// ensure rbBuildFromSorted() produces a valid tree with the right keys for every size up to a few levels
+void testBuildFromSorted();
+
+// ensure rbBuildFromSorted() sorts unsorted input (including negatives and duplicates) with rbSortKeys()
+void testBuildFromUnsorted();
+
+// ensure deleted nodes are reused by later insertions and the pool grows past one slab
+void testNodeRecycling();
+
+// ensure the Red-Black properties hold after every deletion of a large pseudo random tree
+void testDeletionKeepsProperties();
+
+// ensure the index based arrayTree keeps the Red-Black properties through insertions, deletions and slot reuse
+void testArrayTree();
+
+// ensure the single pass insert and delete of topDownTree keep the Red-Black properties with duplicate keys
+void testTopDownTree();
+
+// ensure ctContains() gives correct answers while another thread inserts and deletes, and the tree stays valid
+void testConcurrentTree();
+
+// ensure changes to a persistentTree version copy only a path and are never seen by its snapshots
+void testPersistentTree();
+
+// ensure maps generated by rb_map.h store, replace and remove values for int and string keys
+void testGenericMap();
 #endif